@@ -0,0 +1,212 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+
+/**
+ * @file   mola-app-fe-lidar-benchmark.cpp
+ * @brief  Throughput and accuracy of LidarOdometry parameter variants
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+
+#include <mrpt/3rdparty/tclap/CmdLine.h>
+#include <mrpt/core/exceptions.h>
+#include <mrpt/core/format.h>
+#include <mrpt/system/string_utils.h>
+
+#include <algorithm>
+#include <iostream>
+
+#include "replay_harness.h"
+
+// Declare supported cli switches ===========
+static TCLAP::CmdLine cmd("mola-app-fe-lidar-benchmark");
+
+static TCLAP::ValueArg<std::string> arg_kitti_dir(
+    "k", "kitti-dir",
+    "Directory with a KITTI-like sequence: `velodyne/*.bin` and `times.txt`",
+    true, "", "./sequences/00", cmd);
+
+static TCLAP::ValueArg<std::string> arg_gt_poses(
+    "g", "gt-poses",
+    "Ground truth poses (KITTI format), in the same frame than the "
+    "point clouds after applying --lidar-pose. Without them, only the "
+    "throughput is measured.",
+    false, "", "./poses/00.txt", cmd);
+
+static TCLAP::ValueArg<std::string> arg_params_file(
+    "c", "config-file",
+    "Baseline YAML config file, with a top-level `params` entry", true, "",
+    "config.yml", cmd);
+
+static TCLAP::MultiArg<std::string> arg_variants(
+    "v", "variant",
+    "A variant of the baseline, as `NAME=VALUE[,NAME=VALUE...]` overriding "
+    "entries of `params`, e.g. `enable_fast_path=false`. Can be "
+    "repeated. Parameters only affecting KFs or loop closures are rejected "
+    "if the baseline sets `odometry_only: true`.",
+    false, "NAME=VALUE[,...]", cmd);
+
+static TCLAP::ValueArg<unsigned int> arg_runs(
+    "r", "runs",
+    "Runs per variant. The median throughput is reported (the estimated "
+    "trajectory is deterministic).",
+    false, 3, "3", cmd);
+
+static TCLAP::ValueArg<unsigned int> arg_max_scans(
+    "", "max-scans", "Use only the first N scans of the sequence (0=all)",
+    false, 0, "0", cmd);
+
+static TCLAP::ValueArg<std::string> arg_lidar_pose(
+    "", "lidar-pose",
+    "4x4 homogeneous matrix of the LiDAR sensor in the vehicle frame, in "
+    "Matlab format (see mola-app-fe-lidar-align)",
+    false, "", "[1 0 0 0;0 1 0 0;0 0 1 0;0 0 0 1]", cmd);
+
+namespace
+{
+struct Variant
+{
+    std::string                                      name;
+    std::vector<std::pair<std::string, std::string>> overrides;
+    mola::replay::Result                             result;
+};
+
+Variant parse_variant(const std::string& s)
+{
+    Variant v;
+    v.name = s;
+
+    std::vector<std::string> parts;
+    mrpt::system::tokenize(s, ",", parts);
+    for (const auto& part : parts)
+    {
+        const auto eq = part.find('=');
+        if (eq == std::string::npos || eq == 0)
+            THROW_EXCEPTION_FMT("Malformed --variant: `%s`", s.c_str());
+        const auto name = mrpt::system::trim(part.substr(0, eq));
+        v.overrides.emplace_back(name, mrpt::system::trim(part.substr(eq + 1)));
+    }
+    return v;
+}
+
+// Keep the YAML type of values: bools and numbers are not strings.
+void set_param(
+    mrpt::containers::yaml& cfg, const std::string& name,
+    const std::string& value)
+{
+    if (value == "true" || value == "false")
+    {
+        cfg["params"][name] = (value == "true");
+        return;
+    }
+    try
+    {
+        size_t       pos;
+        const double d = std::stod(value, &pos);
+        if (pos == value.size())
+        {
+            cfg["params"][name] = d;
+            return;
+        }
+    }
+    catch (const std::exception&)
+    {
+    }
+    cfg["params"][name] = value;
+}
+
+void do_benchmark()
+{
+    // Load dataset:
+    mrpt::poses::CPose3D sensor_pose;
+    if (arg_lidar_pose.isSet())
+    {
+        mrpt::math::CMatrixDouble44 HM;
+        if (!HM.fromMatlabStringFormat(arg_lidar_pose.getValue()))
+            THROW_EXCEPTION("Malformed --lidar-pose matrix");
+        sensor_pose = mrpt::poses::CPose3D(HM);
+    }
+    std::cout << "Loading dataset...\n";
+    const auto seq = mola::replay::load_kitti_sequence(
+        arg_kitti_dir.getValue(), arg_gt_poses.getValue(), sensor_pose,
+        arg_max_scans.getValue());
+    std::cout << "Done. " << seq.scans.size() << " scans.\n";
+
+    const auto cfg_file = arg_params_file.getValue();
+    ASSERT_FILE_EXISTS_(cfg_file);
+    const auto base_cfg = mrpt::containers::yaml::FromFile(cfg_file);
+
+    std::vector<Variant> variants(1);
+    variants[0].name = "baseline";
+    for (const auto& s : arg_variants.getValue())
+        variants.push_back(parse_variant(s));
+
+    // Reject useless variants before spending any time on the others:
+    for (const auto& v : variants)
+    {
+        auto cfg = base_cfg;
+        for (const auto& kv : v.overrides) set_param(cfg, kv.first, kv.second);
+        for (const auto& kv : v.overrides)
+            mola::replay::ensure_parameter_has_effect(cfg, kv.first);
+    }
+
+    // Sequentially, so runs do not compete for cores or memory bandwidth:
+    for (auto& v : variants)
+    {
+        auto cfg = base_cfg;
+        for (const auto& kv : v.overrides) set_param(cfg, kv.first, kv.second);
+
+        std::vector<double> throughputs;
+        for (unsigned int r = 0; r < std::max(1U, arg_runs.getValue()); r++)
+        {
+            std::cout << "Running `" << v.name << "` (" << r + 1 << ")...\n";
+            v.result = mola::replay::run(cfg, seq);
+            throughputs.push_back(v.result.scans_per_second);
+        }
+        std::nth_element(
+            throughputs.begin(), throughputs.begin() + throughputs.size() / 2,
+            throughputs.end());
+        v.result.scans_per_second = throughputs[throughputs.size() / 2];
+    }
+
+    // Report, relative to the baseline:
+    const auto& base = variants[0].result;
+    std::cout << "\n"
+              << mrpt::format(
+                     "%-40s %10s %8s %12s %12s\n", "variant", "scans/s",
+                     "speedup", "rpe_rmse[m]", "rpe_diff[m]");
+    for (const auto& v : variants)
+    {
+        const auto& r = v.result;
+        std::cout << mrpt::format(
+            "%-40s %10.2f %8.3f ", v.name.c_str(), r.scans_per_second,
+            r.scans_per_second / std::max(1e-9, base.scans_per_second));
+        if (r.rpe_rmse >= 0 && base.rpe_rmse >= 0)
+            std::cout << mrpt::format(
+                "%12.5f %+12.5f\n", r.rpe_rmse, r.rpe_rmse - base.rpe_rmse);
+        else
+            std::cout << mrpt::format("%12s %12s\n", "n/a", "n/a");
+    }
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        // Parse arguments:
+        if (!cmd.parse(argc, argv)) return 1;  // should exit.
+
+        do_benchmark();
+        return 0;
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exit due to exception:\n"
+                  << mrpt::exception_to_str(e) << std::endl;
+        return 1;
+    }
+}
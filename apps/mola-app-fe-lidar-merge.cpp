@@ -0,0 +1,518 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+
+/**
+ * @file   mola-app-fe-lidar-merge.cpp
+ * @brief  Offline merging of map snapshots from several mapping sessions
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+
+#include <mola-fe-lidar/LidarOdometry.h>
+#include <mola-fe-lidar/MapSnapshot.h>
+#include <mola-kernel/yaml_helpers.h>
+#include <mrpt/3rdparty/tclap/CmdLine.h>
+#include <mrpt/containers/yaml.h>
+#include <mrpt/core/WorkerThreadsPool.h>
+#include <mrpt/core/bits_math.h>
+#include <mrpt/core/exceptions.h>
+#include <mrpt/poses/Lie/SE.h>
+#include <mrpt/system/filesystem.h>
+
+#include <nanoflann.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <future>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <tuple>
+
+// Declare supported cli switches ===========
+static TCLAP::CmdLine cmd("mola-app-fe-lidar-merge");
+
+static TCLAP::MultiArg<std::string> arg_inputs(
+    "i", "input",
+    "Map snapshot file (see LidarOdometry::saveMapSnapshot()). Repeat once "
+    "per session. The first one defines the frame of the merged map.",
+    true, "session.map", cmd);
+
+static TCLAP::ValueArg<std::string> arg_params_file(
+    "c", "config-file",
+    "LidarOdometry YAML config file, whose LoopClosure ICP settings are "
+    "used to align KFs between sessions",
+    true, "", "config.yml", cmd);
+
+static TCLAP::ValueArg<std::string> arg_output(
+    "o", "output", "Output merged map snapshot file", true, "",
+    "merged.map", cmd);
+
+static TCLAP::ValueArg<unsigned int> arg_threads(
+    "t", "threads", "Number of parallel ICP threads (0=all cores)", false, 0,
+    "0", cmd);
+
+static TCLAP::ValueArg<unsigned int> arg_ring_key_candidates(
+    "", "ring-key-candidates",
+    "Per KF, number of KFs of other sessions preselected by their "
+    "descriptor ring key",
+    false, 20, "20", cmd);
+
+static TCLAP::ValueArg<unsigned int> arg_top_k(
+    "k", "top-k",
+    "Per KF, number of preselected KFs with the best descriptor distance "
+    "checked with ICP",
+    false, 3, "3", cmd);
+
+static TCLAP::ValueArg<double> arg_max_descriptor_distance(
+    "", "max-descriptor-distance",
+    "Descriptor distances above this [0,1] are never checked with ICP",
+    false, 0.3, "0.3", cmd);
+
+static TCLAP::ValueArg<double> arg_min_goodness(
+    "", "min-goodness", "Minimum ICP goodness to accept an alignment", false,
+    0.6, "0.6", cmd);
+
+static TCLAP::ValueArg<unsigned int> arg_min_support(
+    "", "min-support",
+    "Minimum number of mutually-consistent KF alignments to link two "
+    "sessions",
+    false, 3, "3", cmd);
+
+static TCLAP::ValueArg<double> arg_consensus_xyz(
+    "", "consensus-xyz",
+    "Max. translation between consistent session transforms [m]", false, 1.0,
+    "1.0", cmd);
+
+static TCLAP::ValueArg<double> arg_consensus_rot(
+    "", "consensus-rot",
+    "Max. rotation between consistent session transforms [deg]", false, 5.0,
+    "5.0", cmd);
+
+static TCLAP::ValueArg<double> arg_dedup_distance(
+    "", "dedup-distance",
+    "KFs closer than this to an already merged KF of another session are "
+    "dropped [m]",
+    false, 2.0, "2.0", cmd);
+
+namespace
+{
+using mola::MapSnapshot;
+
+struct Session
+{
+    std::string                     file;
+    MapSnapshot                     map;
+    std::vector<std::vector<float>> ring_keys;
+};
+
+// A KF of session `si` to align against a KF of an earlier session `sj`:
+struct AlignTask
+{
+    size_t si, kf_i, sj, kf_j;
+    double yaw{0};  //!< descriptor-based initial guess [rad]
+
+    bool                 accepted{false};
+    double               goodness{0};
+    mrpt::poses::CPose3D T_j_i;  //!< frame of session `si` wrt `sj`
+};
+
+mrpt::poses::CPose3D inverse_of(mrpt::poses::CPose3D p)
+{
+    p.inverse();
+    return p;
+}
+
+// nanoflann adaptor for the ring keys of one session:
+struct RingKeys
+{
+    const std::vector<std::vector<float>>& keys;
+    size_t                                 dim;
+
+    size_t kdtree_get_point_count() const { return keys.size(); }
+    float  kdtree_get_pt(size_t idx, size_t d) const { return keys[idx][d]; }
+    template <class BBOX>
+    bool kdtree_get_bbox(BBOX&) const
+    {
+        return false;
+    }
+};
+using ring_key_tree_t = nanoflann::KDTreeSingleIndexAdaptor<
+    nanoflann::L2_Simple_Adaptor<float, RingKeys>, RingKeys, -1, size_t>;
+
+std::vector<Session> load_sessions(mrpt::WorkerThreadsPool& pool)
+{
+    const auto&          files = arg_inputs.getValue();
+    std::vector<Session> sessions(files.size());
+
+    std::vector<std::future<void>> futs;
+    for (size_t s = 0; s < files.size(); s++)
+    {
+        sessions[s].file = files[s];
+        futs.emplace_back(pool.enqueue([&sessions, s]() {
+            auto& ses = sessions[s];
+            ASSERT_FILE_EXISTS_(ses.file);
+            ses.map.load(ses.file);
+
+            for (auto& kf : ses.map.keyframes)
+            {
+                // Snapshots of older versions may lack descriptors:
+                if (kf.descriptor.empty())
+                    kf.descriptor =
+                        mola::PlaceDescriptor::FromPointCloud(*kf.pc);
+                ses.ring_keys.push_back(kf.descriptor.ringKey());
+            }
+        }));
+    }
+    for (auto& f : futs) f.get();
+
+    for (const auto& ses : sessions)
+        std::cout << "Loaded `" << ses.file << "`: " << ses.map.keyframes.size()
+                  << " KFs\n";
+    return sessions;
+}
+
+// Place recognition: ring-key preselection, then full descriptor distance.
+std::vector<AlignTask> find_candidates(
+    const std::vector<Session>& sessions, mrpt::WorkerThreadsPool& pool)
+{
+    const size_t n_ring = std::max(1U, arg_ring_key_candidates.getValue());
+    const size_t top_k  = std::max(1U, arg_top_k.getValue());
+    const double max_desc_dist = arg_max_descriptor_distance.getValue();
+
+    // One KD-tree over the ring keys of each session, so the preselection
+    // is O(log N) per KF instead of a scan over all KFs of other sessions:
+    size_t dim = 0;
+    for (const auto& ses : sessions)
+        for (const auto& k : ses.ring_keys)
+        {
+            if (!dim) dim = k.size();
+            ASSERT_EQUAL_(k.size(), dim);
+        }
+    if (!dim) return {};
+
+    std::vector<std::unique_ptr<RingKeys>>        ring_keys;
+    std::vector<std::unique_ptr<ring_key_tree_t>> trees;
+    for (const auto& ses : sessions)
+    {
+        ring_keys.emplace_back(new RingKeys{ses.ring_keys, dim});
+        trees.emplace_back(new ring_key_tree_t(
+            static_cast<int>(dim), *ring_keys.back(),
+            nanoflann::KDTreeSingleIndexAdaptorParams(10)));
+        if (!ses.ring_keys.empty()) trees.back()->buildIndex();
+    }
+
+    std::vector<std::vector<AlignTask>> per_session(sessions.size());
+    std::vector<std::future<void>>      futs;
+
+    for (size_t si = 1; si < sessions.size(); si++)
+    {
+        futs.emplace_back(pool.enqueue([&, si]() {
+            const auto& kfs_i = sessions[si].map.keyframes;
+
+            std::vector<size_t> knn_idx(n_ring);
+            std::vector<float>  knn_dist2(n_ring);
+            for (size_t a = 0; a < kfs_i.size(); a++)
+            {
+                // (ring key distance, session, kf index):
+                std::vector<std::tuple<double, size_t, size_t>> pre;
+                for (size_t sj = 0; sj < si; sj++)
+                {
+                    if (sessions[sj].ring_keys.empty()) continue;
+
+                    const size_t n = trees[sj]->knnSearch(
+                        sessions[si].ring_keys[a].data(), n_ring,
+                        knn_idx.data(), knn_dist2.data());
+                    for (size_t k = 0; k < n; k++)
+                        pre.emplace_back(knn_dist2[k], sj, knn_idx[k]);
+                }
+
+                const size_t n_pre = std::min(n_ring, pre.size());
+                std::partial_sort(
+                    pre.begin(), pre.begin() + n_pre, pre.end());
+
+                std::vector<std::pair<double, AlignTask>> cands;
+                for (size_t p = 0; p < n_pre; p++)
+                {
+                    const auto sj = std::get<1>(pre[p]);
+                    const auto b  = std::get<2>(pre[p]);
+
+                    AlignTask t;
+                    t.si   = si;
+                    t.kf_i = a;
+                    t.sj   = sj;
+                    t.kf_j = b;
+                    const double d =
+                        sessions[sj].map.keyframes[b].descriptor.distance(
+                            kfs_i[a].descriptor, &t.yaw);
+                    if (d <= max_desc_dist) cands.emplace_back(d, t);
+                }
+                std::sort(
+                    cands.begin(), cands.end(),
+                    [](const auto& x, const auto& y) {
+                        return x.first < y.first;
+                    });
+                if (cands.size() > top_k) cands.resize(top_k);
+
+                for (const auto& c : cands)
+                    per_session[si].push_back(c.second);
+            }
+        }));
+    }
+    for (auto& f : futs) f.get();
+
+    std::vector<AlignTask> tasks;
+    for (auto& v : per_session) tasks.insert(tasks.end(), v.begin(), v.end());
+    return tasks;
+}
+
+// Runs all the ICP alignments in parallel. Each thread has its own module
+// instance, since ICP objects are not meant to be shared among threads.
+void run_alignments(
+    const std::vector<Session>& sessions, std::vector<AlignTask>& tasks,
+    const std::string& str_params, mrpt::WorkerThreadsPool& pool,
+    size_t num_threads)
+{
+    std::atomic<size_t> next_task{0}, done{0};
+
+    std::vector<std::future<void>> futs;
+    for (size_t t = 0; t < num_threads; t++)
+    {
+        futs.emplace_back(pool.enqueue([&]() {
+            mola::LidarOdometry module;
+            module.initialize(str_params);
+
+            const auto kind = mola::LidarOdometry::AlignKind::LoopClosure;
+            const auto icp_params = module.params_.icp.at(kind).icpParameters;
+
+            for (size_t idx = next_task++; idx < tasks.size();
+                 idx        = next_task++)
+            {
+                auto&       task = tasks[idx];
+                const auto& kf_i = sessions[task.si].map.keyframes[task.kf_i];
+                const auto& kf_j = sessions[task.sj].map.keyframes[task.kf_j];
+
+                mola::LidarOdometry::ICP_Input icp_in;
+                icp_in.align_kind = kind;
+                icp_in.from_pc    = kf_j.pc;
+                icp_in.to_pc      = kf_i.pc;
+                icp_in.icp_params = icp_params;
+                icp_in.init_guess_to_wrt_from =
+                    mrpt::math::TPose3D(0, 0, 0, task.yaw, 0, 0);
+                icp_in.debug_str = "merge";
+
+                mola::LidarOdometry::ICP_Output icp_out;
+                module.run_one_icp(icp_in, icp_out);
+
+                task.goodness = icp_out.goodness;
+                task.accepted = icp_out.goodness >= arg_min_goodness.getValue();
+                if (task.accepted)
+                {
+                    // kf_i wrt kf_j, then the frame of session i wrt j:
+                    const auto rel = icp_out.found_pose_to_wrt_from.mean;
+                    task.T_j_i = kf_j.pose + rel + inverse_of(kf_i.pose);
+                }
+
+                const auto n = ++done;
+                if (n % 100 == 0 || n == tasks.size())
+                    std::cout << "ICP: " << n << "/" << tasks.size() << "\n";
+            }
+        }));
+    }
+    for (auto& f : futs) f.get();
+}
+
+bool consistent(const mrpt::poses::CPose3D& a, const mrpt::poses::CPose3D& b)
+{
+    const auto   delta = a - b;
+    const double rot =
+        mrpt::poses::Lie::SE<3>::log(delta).blockCopy<3, 1>(3, 0).norm();
+    return delta.norm() <= arg_consensus_xyz.getValue() &&
+           rot <= mrpt::DEG2RAD(arg_consensus_rot.getValue());
+}
+
+struct SessionLink
+{
+    size_t               si, sj;
+    mrpt::poses::CPose3D T_j_i;  //!< frame of session `si` wrt `sj`
+    size_t               support{0};
+};
+
+// Per session pair, the accepted transform with the most consistent ones.
+std::vector<SessionLink> find_session_links(const std::vector<AlignTask>& tasks)
+{
+    std::map<std::pair<size_t, size_t>, std::vector<const AlignTask*>> groups;
+    for (const auto& t : tasks)
+        if (t.accepted) groups[{t.si, t.sj}].push_back(&t);
+
+    std::vector<SessionLink> links;
+    for (const auto& g : groups)
+    {
+        const auto& ts = g.second;
+
+        SessionLink best;
+        for (const auto* a : ts)
+        {
+            size_t support = 0;
+            for (const auto* b : ts)
+                if (consistent(a->T_j_i, b->T_j_i)) support++;
+            if (support <= best.support) continue;
+
+            best.si      = g.first.first;
+            best.sj      = g.first.second;
+            best.T_j_i   = a->T_j_i;
+            best.support = support;
+        }
+        std::cout << "Sessions #" << g.first.second << " <-> #"
+                  << g.first.first << ": " << ts.size()
+                  << " accepted alignments, consensus support="
+                  << best.support << "\n";
+
+        if (best.support >= arg_min_support.getValue()) links.push_back(best);
+    }
+    return links;
+}
+
+// Maximum-support spanning tree from session #0 (Prim's algorithm). Returns
+// the pose of each session frame wrt session #0, if connected.
+std::vector<std::optional<mrpt::poses::CPose3D>> session_poses(
+    size_t num_sessions, const std::vector<SessionLink>& links)
+{
+    std::vector<std::optional<mrpt::poses::CPose3D>> poses(num_sessions);
+    poses.at(0) = mrpt::poses::CPose3D::Identity();
+
+    for (;;)
+    {
+        const SessionLink* best = nullptr;
+        for (const auto& l : links)
+        {
+            if (poses[l.si].has_value() == poses[l.sj].has_value()) continue;
+            if (!best || l.support > best->support) best = &l;
+        }
+        if (!best) break;
+
+        if (poses[best->sj])
+            poses[best->si] = *poses[best->sj] + best->T_j_i;
+        else
+            poses[best->sj] = *poses[best->si] + inverse_of(best->T_j_i);
+    }
+    return poses;
+}
+
+void do_merge()
+{
+    size_t num_threads = arg_threads.getValue();
+    if (num_threads == 0)
+        num_threads = std::max(1U, std::thread::hardware_concurrency());
+    mrpt::WorkerThreadsPool pool(num_threads);
+
+    // Load params:
+    const auto cfg_file = arg_params_file.getValue();
+    ASSERT_FILE_EXISTS_(cfg_file);
+    auto cfg = mrpt::containers::yaml::FromFile(cfg_file);
+
+    // The module instances are only used to run ICPs: no warm-up, and
+    // nothing but odometry (there is no back-end nor world model here):
+    cfg["params"]["odometry_only"]  = true;
+    cfg["params"]["warmup_enabled"] = false;
+
+    const std::string str_params = mola::yaml2string(cfg);
+
+    auto sessions = load_sessions(pool);
+    ASSERT_(!sessions.empty());
+
+    auto tasks = find_candidates(sessions, pool);
+    std::cout << "Place recognition: " << tasks.size()
+              << " inter-session candidates to check with ICP.\n";
+
+    run_alignments(sessions, tasks, str_params, pool, num_threads);
+
+    const auto links = find_session_links(tasks);
+    const auto poses = session_poses(sessions.size(), links);
+
+    // Transform all KFs to the frame of session #0, dropping those KFs
+    // already covered by a KF of another session:
+    const double dedup = arg_dedup_distance.getValue();
+    const auto   cell  = [dedup](double v) {
+        return static_cast<int64_t>(std::floor(v / dedup));
+    };
+    std::map<std::tuple<int64_t, int64_t, int64_t>, std::vector<size_t>> grid;
+
+    MapSnapshot merged;
+    size_t      dropped = 0;
+
+    for (size_t s = 0; s < sessions.size(); s++)
+    {
+        if (!poses[s])
+        {
+            std::cerr << "Warning: session `" << sessions[s].file
+                      << "` could not be linked to the others; skipping it.\n";
+            continue;
+        }
+        for (auto& kf : sessions[s].map.keyframes)
+        {
+            kf.session = static_cast<uint32_t>(s);
+            kf.pose    = *poses[s] + kf.pose;
+
+            const auto x = cell(kf.pose.x()), y = cell(kf.pose.y()),
+                       z = cell(kf.pose.z());
+
+            bool duplicated = false;
+            for (int64_t dx = -1; dx <= 1 && !duplicated; dx++)
+                for (int64_t dy = -1; dy <= 1 && !duplicated; dy++)
+                    for (int64_t dz = -1; dz <= 1 && !duplicated; dz++)
+                    {
+                        const auto it = grid.find({x + dx, y + dy, z + dz});
+                        if (it == grid.end()) continue;
+                        for (const auto idx : it->second)
+                        {
+                            const auto& o = merged.keyframes[idx];
+                            if (o.session != kf.session &&
+                                o.pose.distanceTo(kf.pose) < dedup)
+                            {
+                                duplicated = true;
+                                break;
+                            }
+                        }
+                    }
+            if (duplicated)
+            {
+                dropped++;
+                continue;
+            }
+
+            grid[{x, y, z}].push_back(merged.keyframes.size());
+            merged.keyframes.push_back(std::move(kf));
+        }
+    }
+
+    merged.save(arg_output.getValue());
+    std::cout << "Merged map: " << merged.keyframes.size() << " KFs ("
+              << dropped << " duplicated ones dropped), written to `"
+              << arg_output.getValue() << "`\n";
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        // Parse arguments:
+        if (!cmd.parse(argc, argv)) return 1;  // should exit.
+
+        do_merge();
+        return 0;
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exit due to exception:\n"
+                  << mrpt::exception_to_str(e) << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,366 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+
+/**
+ * @file   mola-app-fe-lidar-tuner.cpp
+ * @brief  Offline tuning of LidarOdometry parameters: throughput vs accuracy
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+
+#include <mrpt/3rdparty/tclap/CmdLine.h>
+#include <mrpt/core/WorkerThreadsPool.h>
+#include <mrpt/core/exceptions.h>
+#include <mrpt/core/format.h>
+#include <mrpt/random.h>
+#include <mrpt/system/filesystem.h>
+#include <mrpt/system/string_utils.h>
+
+#include <cmath>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+#include "replay_harness.h"
+
+// Declare supported cli switches ===========
+static TCLAP::CmdLine cmd("mola-app-fe-lidar-tuner");
+
+static TCLAP::ValueArg<std::string> arg_kitti_dir(
+    "k", "kitti-dir",
+    "Directory with a KITTI-like sequence: `velodyne/*.bin` and `times.txt`",
+    true, "", "./sequences/00", cmd);
+
+static TCLAP::ValueArg<std::string> arg_gt_poses(
+    "g", "gt-poses",
+    "Ground truth poses (KITTI format), in the same frame than the "
+    "point clouds after applying --lidar-pose",
+    true, "", "./poses/00.txt", cmd);
+
+static TCLAP::ValueArg<std::string> arg_params_file(
+    "c", "config-file",
+    "Base YAML config file, with a top-level `params` entry. Each tuned "
+    "parameter `NAME` must appear in it as the placeholder `${NAME}`",
+    true, "", "config.yml", cmd);
+
+static TCLAP::MultiArg<std::string> arg_search(
+    "p", "param",
+    "A parameter to tune, as `NAME:MIN:MAX` (real values) or "
+    "`NAME:MIN:MAX:int` (integer values). Can be repeated. Parameters "
+    "only affecting KFs or loop closures are rejected if the config file "
+    "sets `odometry_only: true`.",
+    true, "NAME:MIN:MAX[:int]", cmd);
+
+static TCLAP::ValueArg<std::string> arg_out_dir(
+    "o", "output-dir", "Directory where to write the Pareto front configs",
+    false, "tuner-output", "tuner-output", cmd);
+
+static TCLAP::ValueArg<unsigned int> arg_num_configs(
+    "n", "num-configs", "Number of random configurations to start with",
+    false, 27, "27", cmd);
+
+static TCLAP::ValueArg<unsigned int> arg_eta(
+    "", "eta", "Successive halving: keep 1/eta configurations per round",
+    false, 3, "3", cmd);
+
+static TCLAP::ValueArg<unsigned int> arg_min_scans(
+    "", "min-scans", "Successive halving: scans replayed in the first round",
+    false, 100, "100", cmd);
+
+static TCLAP::ValueArg<unsigned int> arg_max_scans(
+    "", "max-scans", "Use only the first N scans of the sequence (0=all)",
+    false, 0, "0", cmd);
+
+static TCLAP::ValueArg<unsigned int> arg_threads(
+    "t", "threads",
+    "Number of configurations evaluated in parallel. Use 1 for the most "
+    "accurate throughput figures.",
+    false, 1, "1", cmd);
+
+static TCLAP::ValueArg<unsigned int> arg_seed(
+    "", "seed", "Random seed", false, 1234, "1234", cmd);
+
+static TCLAP::ValueArg<std::string> arg_lidar_pose(
+    "", "lidar-pose",
+    "4x4 homogeneous matrix of the LiDAR sensor in the vehicle frame, in "
+    "Matlab format (see mola-app-fe-lidar-align)",
+    false, "", "[1 0 0 0;0 1 0 0;0 0 1 0;0 0 0 1]", cmd);
+
+namespace
+{
+struct ParamRange
+{
+    std::string name;
+    double      min{0}, max{1};
+    bool        is_int{false};
+};
+
+struct Candidate
+{
+    std::map<std::string, double> values;
+    std::string                   cfg_text;
+    /** Result with the largest number of scans this candidate reached */
+    mola::replay::Result result;
+};
+
+ParamRange parse_param_range(const std::string& s)
+{
+    std::vector<std::string> parts;
+    mrpt::system::tokenize(s, ":", parts);
+    if (parts.size() != 3 && parts.size() != 4)
+        THROW_EXCEPTION_FMT("Malformed --param: `%s`", s.c_str());
+
+    ParamRange r;
+    r.name   = parts[0];
+    r.min    = std::stod(parts[1]);
+    r.max    = std::stod(parts[2]);
+    r.is_int = (parts.size() == 4 && parts[3] == "int");
+    ASSERT_LE_(r.min, r.max);
+    return r;
+}
+
+std::string substitute(
+    std::string text, const std::map<std::string, double>& values,
+    const std::vector<ParamRange>& ranges)
+{
+    for (const auto& r : ranges)
+    {
+        const std::string key = "${" + r.name + "}";
+        const double      v   = values.at(r.name);
+        const std::string val =
+            r.is_int ? std::to_string(static_cast<long long>(v))
+                     : mrpt::format("%g", v);
+
+        for (size_t pos = text.find(key); pos != std::string::npos;
+             pos        = text.find(key, pos + val.size()))
+            text.replace(pos, key.size(), val);
+    }
+    return text;
+}
+
+// a dominates b: not worse in both objectives, and better in at least one
+bool dominates(const mola::replay::Result& a, const mola::replay::Result& b)
+{
+    return a.scans_per_second >= b.scans_per_second &&
+           a.rpe_rmse <= b.rpe_rmse &&
+           (a.scans_per_second > b.scans_per_second || a.rpe_rmse < b.rpe_rmse);
+}
+
+// Non-dominated sorting of the candidates `idxs`: rank 0 is the Pareto
+// front. Returns one rank per entry in `idxs`.
+std::vector<size_t> pareto_ranks(
+    const std::vector<Candidate>& cands, const std::vector<size_t>& idxs)
+{
+    const size_t        N = idxs.size();
+    std::vector<size_t> rank(N, 0);
+    std::vector<bool>   assigned(N, false);
+    size_t              nAssigned = 0;
+
+    for (size_t r = 0; nAssigned < N; r++)
+    {
+        std::vector<size_t> front;
+        for (size_t i = 0; i < N; i++)
+        {
+            if (assigned[i]) continue;
+            bool dominated = false;
+            for (size_t j = 0; j < N && !dominated; j++)
+                dominated =
+                    !assigned[j] && j != i &&
+                    dominates(cands[idxs[j]].result, cands[idxs[i]].result);
+            if (!dominated) front.push_back(i);
+        }
+        for (const auto i : front)
+        {
+            rank[i]     = r;
+            assigned[i] = true;
+            nAssigned++;
+        }
+    }
+    return rank;
+}
+
+void evaluate_all(
+    std::vector<Candidate>& cands, const std::vector<size_t>& idxs,
+    const mola::replay::Sequence& seq, size_t num_scans,
+    mrpt::WorkerThreadsPool& pool)
+{
+    std::vector<std::future<void>> futs;
+    for (const auto i : idxs)
+    {
+        auto& c = cands[i];
+        futs.emplace_back(pool.enqueue([&c, &seq, num_scans]() {
+            try
+            {
+                c.result = mola::replay::run(
+                    mrpt::containers::yaml::FromText(c.cfg_text), seq,
+                    num_scans);
+                if (c.result.rpe_rmse < 0)
+                    c.result.rpe_rmse = std::numeric_limits<double>::max();
+            }
+            catch (const std::exception& e)
+            {
+                std::cerr << "Configuration failed, discarding it:\n"
+                          << mrpt::exception_to_str(e) << "\n";
+                c.result                  = mola::replay::Result();
+                c.result.rpe_rmse         = std::numeric_limits<double>::max();
+                c.result.scans_per_second = 0;
+            }
+        }));
+    }
+    for (auto& f : futs) f.get();
+}
+
+void do_tune()
+{
+    std::vector<ParamRange> ranges;
+    for (const auto& s : arg_search.getValue())
+        ranges.push_back(parse_param_range(s));
+
+    // Load base config:
+    const auto cfg_file = arg_params_file.getValue();
+    ASSERT_FILE_EXISTS_(cfg_file);
+    std::string base_cfg;
+    {
+        std::ifstream     f(cfg_file);
+        std::stringstream ss;
+        ss << f.rdbuf();
+        base_cfg = ss.str();
+    }
+    for (const auto& r : ranges)
+        if (base_cfg.find("${" + r.name + "}") == std::string::npos)
+            THROW_EXCEPTION_FMT(
+                "Placeholder `${%s}` not found in the config file.",
+                r.name.c_str());
+    {
+        const auto cfg = mrpt::containers::yaml::FromText(base_cfg);
+        for (const auto& r : ranges)
+            mola::replay::ensure_parameter_has_effect(cfg, r.name);
+    }
+
+    // Load dataset:
+    mrpt::poses::CPose3D sensor_pose;
+    if (arg_lidar_pose.isSet())
+    {
+        mrpt::math::CMatrixDouble44 HM;
+        if (!HM.fromMatlabStringFormat(arg_lidar_pose.getValue()))
+            THROW_EXCEPTION("Malformed --lidar-pose matrix");
+        sensor_pose = mrpt::poses::CPose3D(HM);
+    }
+    std::cout << "Loading dataset...\n";
+    const auto seq = mola::replay::load_kitti_sequence(
+        arg_kitti_dir.getValue(), arg_gt_poses.getValue(), sensor_pose,
+        arg_max_scans.getValue());
+    const size_t N = seq.scans.size();
+    std::cout << "Done. " << N << " scans.\n";
+
+    // Random initial population:
+    auto& rng = mrpt::random::getRandomGenerator();
+    rng.randomize(arg_seed.getValue());
+
+    std::vector<Candidate> cands(arg_num_configs.getValue());
+    for (auto& c : cands)
+    {
+        for (const auto& r : ranges)
+        {
+            double v = rng.drawUniform(r.min, r.max);
+            if (r.is_int) v = std::round(v);
+            c.values[r.name] = v;
+        }
+        c.cfg_text = substitute(base_cfg, c.values, ranges);
+    }
+
+    mrpt::WorkerThreadsPool pool(std::max(1U, arg_threads.getValue()));
+    const size_t            eta = std::max(2U, arg_eta.getValue());
+
+    // Successive halving: evaluate all survivors with an increasing number
+    // of scans, keeping the best 1/eta of them by Pareto rank each round.
+    // Discarded candidates keep their last result, so the final Pareto front
+    // is built from every candidate, at the largest budget it reached:
+    std::vector<size_t> alive(cands.size());
+    for (size_t i = 0; i < alive.size(); i++) alive[i] = i;
+
+    for (size_t budget = std::min<size_t>(arg_min_scans.getValue(), N);;
+         budget        = std::min(budget * eta, N))
+    {
+        std::cout << "Evaluating " << alive.size() << " configurations with "
+                  << budget << " scans...\n";
+        evaluate_all(cands, alive, seq, budget, pool);
+
+        if (budget >= N || alive.size() <= 1) break;
+
+        const auto          ranks = pareto_ranks(cands, alive);
+        std::vector<size_t> order(alive.size());
+        for (size_t i = 0; i < order.size(); i++) order[i] = i;
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return ranks[a] != ranks[b] ? ranks[a] < ranks[b]
+                                        : cands[alive[a]].result.rpe_rmse <
+                                              cands[alive[b]].result.rpe_rmse;
+        });
+
+        const size_t        nKeep = std::max<size_t>(1, alive.size() / eta);
+        std::vector<size_t> survivors;
+        for (size_t i = 0; i < nKeep; i++) survivors.push_back(alive[order[i]]);
+        alive = std::move(survivors);
+    }
+
+    // Output the Pareto front:
+    std::vector<size_t> all(cands.size());
+    for (size_t i = 0; i < all.size(); i++) all[i] = i;
+    const auto ranks   = pareto_ranks(cands, all);
+    const auto out_dir = arg_out_dir.getValue();
+    mrpt::system::createDirectory(out_dir);
+
+    std::ofstream summary(out_dir + "/pareto_front.yaml");
+    summary << "# Pareto front of scans/s vs relative translation error\n"
+               "pareto_front:\n";
+
+    size_t idx = 0;
+    for (size_t i = 0; i < cands.size(); i++)
+    {
+        if (ranks[i] != 0) continue;
+        const auto& c = cands[i];
+        const auto  fil_name =
+            mrpt::format("pareto_%02u.yaml", static_cast<unsigned>(idx++));
+
+        std::ofstream f(out_dir + "/" + fil_name);
+        f << c.cfg_text;
+
+        summary << "  - file: " << fil_name << "\n"
+                << "    scans_per_second: " << c.result.scans_per_second
+                << "\n"
+                << "    rpe_rmse: " << c.result.rpe_rmse << "\n"
+                << "    num_scans: " << c.result.num_scans << "\n"
+                << "    values:\n";
+        for (const auto& kv : c.values)
+            summary << "      " << kv.first << ": " << kv.second << "\n";
+
+        std::cout << fil_name << ": " << c.result.scans_per_second
+                  << " scans/s, rpe_rmse=" << c.result.rpe_rmse << " m ("
+                  << c.result.num_scans << " scans)\n";
+    }
+    std::cout << "Pareto front written to: " << out_dir << "\n";
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        // Parse arguments:
+        if (!cmd.parse(argc, argv)) return 1;  // should exit.
+
+        do_tune();
+        return 0;
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exit due to exception:\n"
+                  << mrpt::exception_to_str(e) << std::endl;
+        return 1;
+    }
+}
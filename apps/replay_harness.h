@@ -0,0 +1,331 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   replay_harness.h
+ * @brief  Offline replay of lidar datasets through LidarOdometry, for the
+ *         tuning and benchmarking apps.
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+#pragma once
+
+#include <mola-fe-lidar/LidarOdometry.h>
+#include <mola-kernel/WorldModel.h>
+#include <mola-kernel/entities/entities-common.h>
+#include <mola-kernel/interfaces/BackEndBase.h>
+#include <mola-kernel/yaml_helpers.h>
+#include <mrpt/containers/yaml.h>
+#include <mrpt/core/exceptions.h>
+#include <mrpt/maps/CPointsMapXYZI.h>
+#include <mrpt/math/CMatrixFixed.h>
+#include <mrpt/obs/CObservationPointCloud.h>
+#include <mrpt/poses/CPose3D.h>
+#include <mrpt/system/CDirectoryExplorer.h>
+#include <mrpt/system/filesystem.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace mola::replay
+{
+/** A lidar sequence in KITTI format: one `.bin` file per scan, optional
+ * `times.txt` (one timestamp per line, in seconds) and optional ground truth
+ * poses (one row-major 3x4 matrix per line). */
+struct Sequence
+{
+    std::vector<mrpt::obs::CObservationPointCloud::Ptr> scans;
+    /** Ground truth poses, one per scan, or empty if not available. Must be
+     * given in the same frame than the point clouds (see `sensor_pose`). */
+    std::vector<mrpt::poses::CPose3D> gt_poses;
+};
+
+/** Loads up to `max_scans` scans (0=all) from `<dir>/velodyne/`, or from
+ * `<dir>` if there is no such subdirectory. Point clouds are transformed by
+ * `sensor_pose` into the vehicle frame. */
+inline Sequence load_kitti_sequence(
+    const std::string& dir, const std::string& gt_poses_file,
+    const mrpt::poses::CPose3D& sensor_pose, size_t max_scans = 0)
+{
+    Sequence seq;
+
+    std::string scans_dir = dir + "/velodyne";
+    if (!mrpt::system::directoryExists(scans_dir)) scans_dir = dir;
+
+    std::vector<std::string> files;
+    {
+        mrpt::system::CDirectoryExplorer::TFileInfoList lst;
+        mrpt::system::CDirectoryExplorer::explore(
+            scans_dir, FILE_ATTRIB_ARCHIVE, lst);
+        for (const auto& f : lst)
+            if (mrpt::system::extractFileExtension(f.name) == "bin")
+                files.push_back(f.wholePath);
+        std::sort(files.begin(), files.end());
+    }
+    ASSERTMSG_(!files.empty(), "No `*.bin` files found in: " + scans_dir);
+    if (max_scans && files.size() > max_scans) files.resize(max_scans);
+
+    std::vector<double> times;
+    {
+        std::ifstream f(dir + "/times.txt");
+        double        t;
+        while (f >> t) times.push_back(t);
+    }
+
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        auto pc = mrpt::maps::CPointsMapXYZI::Create();
+        pc->loadFromKittiVelodyneFile(files[i]);
+        pc->changeCoordinatesReference(sensor_pose);
+
+        auto obs         = mrpt::obs::CObservationPointCloud::Create();
+        obs->pointcloud  = pc;
+        obs->sensorLabel = "lidar";
+        obs->timestamp   = mrpt::Clock::fromDouble(
+            i < times.size() ? times[i] : 0.1 * static_cast<double>(i));
+        seq.scans.push_back(obs);
+    }
+
+    if (!gt_poses_file.empty())
+    {
+        std::ifstream f(gt_poses_file);
+        ASSERTMSG_(f.is_open(), "Cannot open: " + gt_poses_file);
+        mrpt::math::CMatrixDouble44 HM;
+        HM.setIdentity();
+        while (seq.gt_poses.size() < seq.scans.size())
+        {
+            for (int r = 0; r < 3; r++)
+                for (int c = 0; c < 4; c++) f >> HM(r, c);
+            if (!f) break;
+            seq.gt_poses.emplace_back(HM);
+        }
+        ASSERTMSG_(
+            seq.gt_poses.size() == seq.scans.size(),
+            "Ground truth file has less poses than scans.");
+    }
+
+    return seq;
+}
+
+struct Result
+{
+    size_t num_scans{0};
+    size_t num_poses{0};  //!< Scans with an odometry output
+    double scans_per_second{.0};
+    /** RMSE of the relative translation error over `rpe_delta` scans [m],
+     * or <0 if there is no ground truth. */
+    double rpe_rmse{-1};
+};
+
+/** Minimal back-end for the offline replays: KFs and factors are stored in
+ * the world model as they arrive, with no optimization at all. The pose of
+ * each new KF is the dead-reckoning of the first factor reaching it, which
+ * is enough for the front-end to find nearby KFs and loop closures. */
+class StubBackEnd : public mola::BackEndBase
+{
+   public:
+    explicit StubBackEnd(const mola::WorldModel::Ptr& wm) : wm_(wm) {}
+
+    void initialize(const std::string&) override {}
+    void spinOnce() override {}
+
+    ProposeKF_Output doAddKeyFrame(const ProposeKF_Input& i) override
+    {
+        std::lock_guard<std::mutex> lck(mtx_);
+
+        mola::Entity e;
+        if (root_id_ == mola::INVALID_ID)
+        {
+            mola::RefPose3 ref;
+            ref.timestamp_ = i.timestamp;
+            e              = std::move(ref);
+        }
+        else
+        {
+            mola::RelDynPose3KF kf;
+            kf.timestamp_ = i.timestamp;
+            kf.base_id_   = root_id_;
+            e             = std::move(kf);
+        }
+
+        wm_->entities_lock_for_write();
+        const mola::id_t id = wm_->entity_emplace_back(std::move(e));
+        wm_->entities_unlock_for_write();
+
+        if (root_id_ == mola::INVALID_ID) root_id_ = id;
+        if (id == root_id_) with_pose_.insert(id);
+
+        ProposeKF_Output o;
+        o.success   = true;
+        o.new_kf_id = id;
+        return o;
+    }
+
+    AddFactor_Output doAddFactor(mola::Factor& f) override
+    {
+        std::lock_guard<std::mutex> lck(mtx_);
+
+        if (const auto* fp = std::get_if<mola::FactorRelativePose3>(&f);
+            fp && with_pose_.count(fp->from_kf_) &&
+            !with_pose_.count(fp->to_kf_))
+        {
+            wm_->entities_lock_for_write();
+            const auto from = mrpt::poses::CPose3D(
+                mola::entity_get_pose(wm_->entity_by_id(fp->from_kf_)));
+            mola::entity_update_pose(
+                wm_->entity_by_id(fp->to_kf_),
+                (from + mrpt::poses::CPose3D(fp->rel_pose_)).asTPose());
+            wm_->entities_unlock_for_write();
+            with_pose_.insert(fp->to_kf_);
+        }
+
+        wm_->factors_lock_for_write();
+        const mola::fid_t fid = wm_->factor_push_back(f);
+        wm_->factors_unlock_for_write();
+
+        AddFactor_Output o;
+        o.success       = true;
+        o.new_factor_id = fid;
+        return o;
+    }
+
+    void doAdvertiseUpdatedLocalization(
+        AdvertiseUpdatedLocalization_Input) override
+    {
+    }
+
+   private:
+    mola::WorldModel::Ptr wm_;
+    std::mutex            mtx_;
+    mola::id_t            root_id_{mola::INVALID_ID};
+    std::set<mola::id_t>  with_pose_;
+};
+
+/** True for the LidarOdometry parameters that only affect KFs, the local
+ * graph, loop closures or the back-end factors, hence have no effect at all
+ * if the replayed config sets `odometry_only: true`. */
+inline bool is_mapping_only_parameter(const std::string& name)
+{
+    static const std::vector<std::string> prefixes = {
+        "kf_",
+        "global_map_",
+        "pcm_",
+        "factor_",
+        "viz_decor_",
+        "memory_",
+        "loop_closure_",
+        "icp_settings_loop_closure",
+        "min_dist_xyz_between_keyframes",
+        "min_rotation_between_keyframes",
+        "min_icp_goodness",  // also min_icp_goodness_lc
+        "min_dist_to_matching",
+        "max_dist_to_matching",
+        "max_dist_to_loop_closure",
+        "max_nearby_align_checks",
+        "enable_fast_path_nearby",
+        "min_topo_dist_to_consider_loopclosure",
+        "nearby_kfs_time_budget",
+        "max_KFs_local_graph",
+        "debug_save_extra_edges",
+        "debug_save_loop_closures"};
+
+    for (const auto& p : prefixes)
+        if (name.compare(0, p.size(), p) == 0) return true;
+    return false;
+}
+
+/** Throws if `name` would have no effect when running `cfg` with run(), i.e.
+ * it is a mapping-only parameter and `cfg` is odometry-only. See
+ * is_mapping_only_parameter() */
+inline void ensure_parameter_has_effect(
+    const mrpt::containers::yaml& cfg, const std::string& name)
+{
+    const bool odom_only =
+        cfg.has("params") &&
+        cfg["params"].getOrDefault<bool>("odometry_only", false);
+
+    if (odom_only && is_mapping_only_parameter(name))
+        THROW_EXCEPTION_FMT(
+            "Parameter `%s` only affects KFs or loop closures, which are not "
+            "created with `odometry_only: true`: it would have no effect.",
+            name.c_str());
+}
+
+/** Runs the first `num_scans` (0=all) scans of `seq` through a LidarOdometry
+ * instance and evaluates its throughput and accuracy. Unless `cfg` is
+ * odometry-only, KFs, nearby checks and loop closures are processed as
+ * usual, against a fresh WorldModel and a StubBackEnd. `cfg` must contain
+ * the top-level `params` entry. */
+inline Result run(
+    const mrpt::containers::yaml& cfg, const Sequence& seq,
+    size_t num_scans = 0, size_t rpe_delta = 10)
+{
+    // Declared before the module, so they outlive its worker threads:
+    auto wm = std::make_shared<mola::WorldModel>();
+    wm->initialize("params: {}\n");
+    auto backend = std::make_shared<StubBackEnd>(wm);
+
+    mola::LidarOdometry module;
+    module.attachOfflineServices(backend, wm);
+    module.initialize(mola::yaml2string(cfg));
+
+    std::map<mrpt::Clock::time_point, mrpt::poses::CPose3D> estimates;
+    module.subscribeToOdometry(
+        [&estimates](const mola::LidarOdometry::OdometryUpdate& u) {
+            estimates[u.timestamp] = mrpt::poses::CPose3D(u.pose);
+        });
+
+    const size_t N = num_scans ? std::min(num_scans, seq.scans.size())
+                               : seq.scans.size();
+
+    const auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < N; i++)
+    {
+        mrpt::obs::CObservation::Ptr o = seq.scans[i];
+        module.processObservationNow(o);
+    }
+    const auto t1 = std::chrono::steady_clock::now();
+
+    Result r;
+    r.num_scans = N;
+    r.num_poses = estimates.size();
+    r.scans_per_second =
+        N / std::max(1e-9, std::chrono::duration<double>(t1 - t0).count());
+
+    if (seq.gt_poses.empty() || N <= rpe_delta) return r;
+
+    double sum_sq = 0;
+    size_t n      = 0;
+    for (size_t i = 0; i + rpe_delta < N; i++)
+    {
+        const auto it_i = estimates.find(seq.scans[i]->timestamp);
+        const auto it_j = estimates.find(seq.scans[i + rpe_delta]->timestamp);
+        if (it_i == estimates.end() || it_j == estimates.end()) continue;
+
+        const auto gt_rel  = seq.gt_poses[i + rpe_delta] - seq.gt_poses[i];
+        const auto est_rel = it_j->second - it_i->second;
+        const auto err     = est_rel - gt_rel;
+
+        sum_sq += mrpt::square(err.norm());
+        n++;
+    }
+    if (n == 0) return r;
+    r.rpe_rmse = std::sqrt(sum_sq / n);
+    // Penalize configurations that drop scans:
+    r.rpe_rmse *= static_cast<double>(N - rpe_delta) / n;
+
+    return r;
+}
+
+}  // namespace mola::replay
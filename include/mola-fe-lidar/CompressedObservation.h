@@ -0,0 +1,67 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   CompressedObservation.h
+ * @brief  Compact storage of raw observations, for later re-processing
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+#pragma once
+
+#include <mrpt/obs/CObservation.h>
+#include <mrpt/serialization/CSerializable.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace mola
+{
+/** A raw observation in compressed form, stored as a KF annotation.
+ *
+ * Point clouds (CObservationPointCloud with a CSimplePointsMap or
+ * CPointsMapXYZI) are quantized to a fixed step, delta-encoded in sensor
+ * order and zlib-compressed; intensities are kept as-is. The error of each
+ * coordinate is bounded by half the quantization step. Any other
+ * observation type, or a quantization of zero, is serialized and
+ * zlib-compressed losslessly.
+ */
+class CompressedObservation : public mrpt::serialization::CSerializable
+{
+    DEFINE_SERIALIZABLE(CompressedObservation, mola)
+
+   public:
+    /** Compresses `o`. `quantization` [m] is the step for point
+     * coordinates (0=lossless). */
+    static Ptr Compress(const mrpt::obs::CObservation& o, double quantization);
+
+    /** Rebuilds the original observation (up to the quantization error) */
+    mrpt::obs::CObservation::Ptr decompress() const;
+
+    /** Size of the compressed data [bytes] */
+    size_t compressedBytes() const { return header_.size() + payload_.size(); }
+    /** Size of the payload before zlib compression [bytes] */
+    size_t uncompressedBytes() const { return header_.size() + payload_raw_; }
+
+   private:
+    enum class Method : uint8_t
+    {
+        Lossless = 0,
+        QuantizedPoints
+    };
+
+    Method   method_{Method::Lossless};
+    double   quantization_{.0};
+    uint32_t num_points_{0};
+    bool     has_intensity_{false};
+    /** Only for QuantizedPoints: the serialized observation, without its
+     * points */
+    std::vector<uint8_t> header_;
+    /** zlib-compressed data, and its uncompressed size */
+    std::vector<uint8_t> payload_;
+    uint64_t             payload_raw_{0};
+};
+
+}  // namespace mola
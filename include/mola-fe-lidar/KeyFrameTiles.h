@@ -0,0 +1,105 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   KeyFrameTiles.h
+ * @brief  Spatial index of KFs in 2D tiles, with a resident tile set
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+#pragma once
+
+#include <mola-kernel/id.h>
+#include <mrpt/math/TPoint3D.h>
+#include <mrpt/poses/CPose3D.h>
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace mola
+{
+/** Organizes KFs by space in a fixed-size grid of square tiles on the XY
+ * plane, so that the cost of finding KFs near the vehicle does not depend on
+ * the map size.
+ *
+ * Tiles around the vehicle (within `load_radius` of their center) are
+ * "resident": their KF data is expected to be in memory. Tiles farther
+ * than `unload_radius` (hysteresis) stop being resident. This class only
+ * tracks the residency; the caller actually loads or unloads the KF data
+ * with the ids returned by updateResidency().
+ *
+ * Not thread-safe: only used from the odometry thread.
+ */
+class KeyFrameTiles
+{
+   public:
+    struct Parameters
+    {
+        /** Tile side length, and residency radii (see class docs) [m] */
+        double tile_size{100.0};
+        double load_radius{150.0};
+        double unload_radius{250.0};
+    };
+
+    using tile_key_t = std::pair<int32_t, int32_t>;
+
+    /** Adds a new KF with its global pose. Its tile becomes resident. */
+    void insert(id_t id, const mrpt::poses::CPose3D& pose, const Parameters& p);
+
+    /** KFs whose tiles became resident or stopped being so */
+    struct ResidencyChange
+    {
+        std::vector<id_t> load, unload;
+    };
+
+    /** Updates the resident tiles for the vehicle at `pos` */
+    ResidencyChange updateResidency(
+        const mrpt::math::TPoint3D& pos, const Parameters& p);
+
+    /** KFs in resident tiles closer than `radius` to `pos`, with their
+     * global poses */
+    std::vector<std::pair<id_t, mrpt::poses::CPose3D>> residentKeyFramesNear(
+        const mrpt::math::TPoint3D& pos, double radius,
+        const Parameters& p) const;
+
+    /** All KFs (resident or not) closer than `radius` to `pos`, with their
+     * global poses */
+    std::vector<std::pair<id_t, mrpt::poses::CPose3D>> keyFramesNear(
+        const mrpt::math::TPoint3D& pos, double radius,
+        const Parameters& p) const;
+
+    /** Global pose of a KF, if it exists */
+    std::optional<mrpt::poses::CPose3D> keyFramePose(id_t id) const;
+
+    bool   isResident(id_t id) const;
+    size_t tileCount() const { return tiles_.size(); }
+    size_t residentTileCount() const { return resident_.size(); }
+    size_t keyFrameCount() const { return kfs_.size(); }
+
+    void clear();
+
+   private:
+    struct KeyFrame
+    {
+        mrpt::poses::CPose3D pose;
+        tile_key_t           tile;
+    };
+
+    std::map<id_t, KeyFrame>             kfs_;
+    std::map<tile_key_t, std::set<id_t>> tiles_;
+    std::set<tile_key_t>                 resident_;
+
+    static tile_key_t tileOf(double x, double y, const Parameters& p);
+
+    static double distanceToTileCenter(
+        const tile_key_t& k, const mrpt::math::TPoint3D& pos,
+        const Parameters& p);
+};
+
+}  // namespace mola
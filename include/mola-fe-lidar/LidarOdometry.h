@@ -12,16 +12,35 @@
 #pragma once
 
 #include <mrpt/core/WorkerThreadsPool.h>
+#include <mola-fe-lidar/KeyFrameTiles.h>
+#include <mola-fe-lidar/LockProfiler.h>
+#include <mola-fe-lidar/LoopClosureVerifier.h>
+#include <mola-fe-lidar/MapSnapshot.h>
+#include <mola-fe-lidar/OdometryHypotheses.h>
+#include <mola-fe-lidar/StallWatchdog.h>
+#include <mola-fe-lidar/TiledVoxelMap.h>
+#include <mola-fe-lidar/TwistKalmanFilter.h>
+#include <mola-fe-lidar/WheelOdometryBuffer.h>
 #include <mola-kernel/interfaces/FrontEndBase.h>
 #include <mola-lidar-segmentation/LidarFilterBase.h>
 #include <mp2p_icp/ICP.h>
+#include <mrpt/containers/yaml.h>
 #include <mrpt/graphs/CNetworkOfPoses.h>
 #include <mrpt/maps/CPointsMap.h>
-
+#include <mrpt/math/CMatrixFixed.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <limits>
 #include <mutex>
 
 namespace mola
 {
+class OdometryFastPathBase;
+
 /** A front-end for Lidar/point-cloud odometry & SLAM.
  *
  * \ingroup mola_fe_lidar_icp_grp */
@@ -31,13 +50,24 @@ class LidarOdometry : public FrontEndBase
 
    public:
     LidarOdometry();
-    virtual ~LidarOdometry() override = default;
+    virtual ~LidarOdometry() override;
 
     // See docs in base class
     void initialize(const std::string& cfg_block) override;
     void spinOnce() override;
     void onNewObservation(CObservation::Ptr& o) override;
 
+    /** Synchronous version of onNewObservation(), for offline replay tools:
+     * processes the observation in the caller thread, no matter its sensor
+     * label. Do not mix with onNewObservation(). */
+    void processObservationNow(CObservation::Ptr& o);
+
+    /** For offline replay tools, where there is no MOLA launcher to find
+     * other modules: use this back-end and world model. Must be called
+     * before initialize(). */
+    void attachOfflineServices(
+        const BackEndBase::Ptr& backend, const WorldModel::Ptr& wm);
+
     /** Re-initializes the front-end */
     void reset();
 
@@ -50,6 +80,97 @@ class LidarOdometry : public FrontEndBase
 
     struct Parameters
     {
+        /** Odometry-only mode: no back-end nor world model are required, and
+         * no KFs, render decorations or past-KF checks are ever created.
+         * Poses are only published via subscribeToOdometry(), including the
+         * filtered point clouds if `odometry_publish_clouds` is true. */
+        bool odometry_only{false};
+        bool odometry_publish_clouds{false};
+
+        /** If enabled, and the point cloud filter and `icp_settings_with_vel`
+         * match one of the specialized pipelines (see OdometryFastPath.h),
+         * the per-scan filter and odometry ICP use it instead of the
+         * dynamically-configured mp2p_icp pipeline.
+         * Settings with `use_scale_outlier_detector` or `use_robust_kernel`
+         * never match, since the fast path would give different results
+         * (params/icp-settings-fast.yaml is the shipped matching one). */
+        bool enable_fast_path{true};
+
+        /** Like `enable_fast_path`, for the NearbyAlign ICPs, if
+         * `icp_settings_without_vel` matches. Only used if
+         * `enable_fast_path` is also true. */
+        bool enable_fast_path_nearby{false};
+
+        /** Kalman filter over the vehicle twist, used to predict the
+         * initial guess of the next lidar odometry ICP. Only alignments with
+         * goodness >= `twist_kf_min_goodness` and non-degenerate update it.
+         * `twist_kf` is loaded from the `twist_kf_*` yaml entries
+         * (rotational sigmas in degrees there). */
+        double                        twist_kf_min_goodness{0.6};
+        TwistKalmanFilter::Parameters twist_kf;
+
+        /** If not empty, CObservationOdometry observations with this sensor
+         * label are buffered, and the wheel odometry increment between
+         * scans (interpolated at the scan timestamps) is used as the ICP
+         * initial guess instead of the twist filter prediction. Poses are
+         * assumed to be in the same vehicle frame than the point clouds.
+         * `wheel_odometry` is loaded from the `wheel_odometry_*` entries. */
+        std::string                     wheel_odometry_label;
+        WheelOdometryBuffer::Parameters wheel_odometry;
+
+        /** Multi-hypothesis odometry for ambiguous scenes (see
+         * OdometryHypotheses): a degenerate lidar odometry alignment spawns
+         * alternative hypotheses. Then, all of them are aligned in parallel
+         * in the past-KF pool against the last KF, until they are pruned,
+         * merged or collapsed. No KFs are created while several hypotheses
+         * are alive. `multi_hypothesis` is loaded from the
+         * `multi_hypothesis_*` entries (rotational sigma in degrees there).
+         * Requires `degeneracy_check`. */
+        bool                           multi_hypothesis_enabled{false};
+        OdometryHypotheses::Parameters multi_hypothesis;
+
+        /** Run synthetic scans through the filter and all ICP pipelines at
+         * the end of initialize(), so the first real scans do not pay for
+         * thread start-up and lazy allocations. */
+        bool         warmup_enabled{true};
+        unsigned int warmup_num_points{20000};
+
+        /** Stall watchdog: tasks in the odometry thread or the past-KF
+         * pool without progress for longer than these timeouts [s] are
+         * reported with their trace. If `watchdog_degrade_to_odometry_only`,
+         * a stalled odometry thread or a back-end not replying to a new KF
+         * switches the module into odometry-only mode, so poses keep being
+         * published (see isDegraded()). KF creation resumes once the thread
+         * makes progress again and the back-end replies (a late reply still
+         * gets its point cloud and factor from the last KF). */
+        bool   watchdog_enabled{true};
+        double watchdog_odometry_timeout{5.0};
+        double watchdog_past_kf_timeout{30.0};
+        bool   watchdog_degrade_to_odometry_only{false};
+
+        /** Memory budget for the front-end state [MiB] (0=unlimited). When
+         * exceeded, the following actions are taken in order, escalating to
+         * the next one each scan while the budget is still exceeded:
+         * (1) drop KF render decorations, (2) decimate KF point clouds by
+         * `memory_kf_decimation`, (3) unload (spill to disk) the clouds of
+         * KFs out of the local graph, (4) evict half of the local graph,
+         * keeping at least `max_nearby_align_checks`+1 KFs. Each action is
+         * taken once, when entering its level. The level goes back down one
+         * step per scan while usage is below `memory_budget_hysteresis`
+         * times the budget (leaving level 4 restores the local graph size).
+         * Usage is always reported as `memory.*` profiler measures. */
+        unsigned int memory_budget_mb{0};
+        double       memory_budget_hysteresis{0.8};
+        unsigned int memory_kf_decimation{2};
+
+        /** Collect wait/hold time statistics of the front-end locks and
+         * the world-model locks taken by this module. A report with the
+         * `lock_report_top_sections` most contended ones is logged on
+         * destruction, or see lockContentionReport(). Disabled by default,
+         * since it adds clock reads to every lock taken. */
+        bool         profile_locks{false};
+        unsigned int lock_report_top_sections{10};
+
         /** Minimum time (seconds) between scans for being attempted to be
          * aligned. Scans faster than this rate will be just silently ignored.
          */
@@ -90,6 +211,12 @@ class LidarOdometry : public FrontEndBase
         unsigned int max_nearby_align_checks{2};
         unsigned int min_topo_dist_to_consider_loopclosure{20};
 
+        /** Time budget for evaluating candidate KFs in each
+         * checkForNearbyKFs() call [s] (0=unlimited). Candidates are
+         * evaluated in order of expected value (loop closures first); those
+         * left when it runs out are evaluated in the next calls. */
+        double nearby_kfs_time_budget{0.02};
+
         unsigned int max_KFs_local_graph{50000};
 
         /** ICP parameters for the case of having, or not, a good velocity
@@ -104,6 +231,134 @@ class LidarOdometry : public FrontEndBase
 
         std::map<AlignKind, ICP_case> icp;
 
+        /** If enabled, the raw observation of each KF is compressed (see
+         * CompressedObservation) in a background thread, and stored as the
+         * `raw-observation` KF annotation in the world model. It is then
+         * spilled to disk if `kf_raw_obs_unload`, so it does not take
+         * memory until loaded for re-processing.
+         * `kf_raw_obs_quantization` is the max. point error x2 [m]
+         * (0=lossless). Disabled by default: it costs one compression per
+         * KF and disk space, only useful for later re-processing. */
+        bool   kf_store_raw_observations{false};
+        double kf_raw_obs_quantization{0.002};
+        bool   kf_raw_obs_unload{true};
+
+        /** Maintain a global voxel map (see TiledVoxelMap) in a background
+         * thread, updated with each new KF and re-transformed as the
+         * back-end refines the KF poses. Changed tiles are published via
+         * subscribeToGlobalMap(). `global_map` is loaded from the
+         * `global_map_*` entries. If `global_map_layers` is not empty, it is
+         * a comma-separated list of the only KF point layers to insert.
+         * With each new KF, only the poses of the KFs with new factors, plus
+         * `global_map_max_pose_refresh` others (round-robin), are refreshed
+         * from the back-end, so the cost does not grow with the map size. */
+        bool                      global_map_enabled{false};
+        TiledVoxelMap::Parameters global_map;
+        std::string               global_map_layers;
+        unsigned int              global_map_max_pose_refresh{50};
+
+        /** Spatial organization of KFs in tiles (see KeyFrameTiles): the
+         * clouds of KFs in tiles left behind are spilled to disk, those of
+         * tiles the vehicle approaches are loaded back in the background,
+         * and KFs out of the local graph in resident tiles are also loop
+         * closure candidates. `kf_tiles` is loaded from the `kf_tiles_size`,
+         * `kf_tiles_load_radius` and `kf_tiles_unload_radius` entries. */
+        bool                      kf_tiles_enabled{false};
+        KeyFrameTiles::Parameters kf_tiles;
+
+        /** Predictive prefetch: the unloaded KF clouds closer than
+         * `max_dist_to_loop_closure` to the vehicle poses predicted with
+         * the current twist for the next `kf_prefetch_horizon` seconds
+         * (at `kf_prefetch_samples` instants) are loaded in the background,
+         * so checkForNearbyKFs() does not load them in the critical path.
+         * Up to `kf_prefetch_max_per_scan` KFs are requested per scan.
+         * The hit rate is reported as the profiler user measure
+         * `kf_prefetch.hit_rate` (only accesses after the background load
+         * finished are hits). KFs loaded ahead and not used within
+         * `kf_prefetch_horizon` seconds expire and can be unloaded again
+         * (counted in `kf_prefetch.expired`). */
+        bool         kf_prefetch_enabled{false};
+        double       kf_prefetch_horizon{3.0};
+        unsigned int kf_prefetch_samples{6};
+        unsigned int kf_prefetch_max_per_scan{20};
+
+        /** If enabled, per-point normals are estimated once for each new KF
+         * (from local covariances of its `knn` nearest neighbors) and stored
+         * as plane patches in the KF pointcloud_t, so they are reused in all
+         * future alignments by mola::Matcher_Point2CachedPlane (see
+         * icp-settings-point2plane.yaml) and by the alignment Hessian used
+         * for the degeneracy check and factor noise.
+         * If `kf_normals_layers` is not empty, it is a comma-separated list
+         * of the only point layers to process.
+         */
+        bool         kf_compute_normals{false};
+        unsigned int kf_normals_knn{10};
+        unsigned int kf_normals_decimation{1};
+        double       kf_normals_max_e0_e1{0.1};
+        std::string  kf_normals_layers;
+
+        /** If enabled, the strongest returns of each scan (intensity >=
+         * `reflectors_min_intensity`, closer than `reflectors_max_range`,
+         * one per voxel of `reflectors_voxel_size` and up to
+         * `reflectors_max_points`) are added after filtering as the
+         * `reflectors` point layer: lane markings, signs... which help in
+         * feature-poor places. Only for observations with intensity
+         * (CPointsMapXYZI). The fast paths weight its pairings by
+         * `reflectors_weight` (the per-scan odometry uses one with the
+         * default settings); the generic mp2p_icp pipeline, used for
+         * the other alignments, matches it as any other layer.
+         */
+        bool         reflectors_enabled{false};
+        double       reflectors_min_intensity{0.6};
+        double       reflectors_max_range{60.0};
+        double       reflectors_voxel_size{0.2};
+        unsigned int reflectors_max_points{1000};
+        double       reflectors_weight{4.0};
+
+        /** Degeneracy detection: after each ICP, the eigenvalues of the
+         * translational and rotational blocks of the point-to-plane Hessian
+         * (normalized by the number of pairings) are compared against these
+         * thresholds. Degenerate alignments never create KFs nor extra
+         * edges, and trigger a fallback to the motion prior along the
+         * unobservable directions during odometry. The thresholds depend
+         * on the sensor and the point cloud filter: tune them before
+         * enabling it. */
+        bool         degeneracy_check{false};
+        double       degeneracy_min_eig_xyz{0.02};
+        double       degeneracy_min_eig_rot{0.5};
+        unsigned int degeneracy_max_points_per_layer{300};
+        double       degeneracy_max_pair_distance{1.0};
+
+        /** If enabled, the noise of FactorRelativePose3 factors is derived
+         * from the ICP information matrix (see ICP_Output::information),
+         * with std. deviations clamped to [min,max], or the max. ones if
+         * not available. Otherwise, the fixed `factor_sigma_xyz` and
+         * `factor_sigma_rot` are used (rotations in rad here, degrees in
+         * the yaml file). */
+        bool   factor_noise_from_information{true};
+        double factor_sigma_xyz{0.10};
+        double factor_sigma_rot{mrpt::DEG2RAD(1.0)};
+        double factor_sigma_xyz_min{0.01}, factor_sigma_xyz_max{1.0};
+        double factor_sigma_rot_min{mrpt::DEG2RAD(0.1)};
+        double factor_sigma_rot_max{mrpt::DEG2RAD(10.0)};
+        /** Lower bound for the point-to-plane residual std. deviation [m] */
+        double icp_residual_min_sigma{0.02};
+
+        /** Pairwise consistency (PCM) verification of loop closures: if
+         * enabled, loop closures passing the ICP tests are buffered, and
+         * only the largest mutually-consistent set is sent to the back-end,
+         * once `pcm_batch_size` candidates are buffered or the oldest one
+         * has waited for `pcm_max_wait` seconds.
+         * `pcm` is loaded from `pcm_max_error_xyz`, `pcm_max_error_rot`
+         * (degrees) and `pcm_min_clique_size` in the yaml file.
+         * Note that with `pcm_min_clique_size` >= 2, a loop closure not
+         * confirmed by another one within `pcm_max_wait` is dropped.
+         */
+        bool                            pcm_enabled{false};
+        unsigned int                    pcm_batch_size{3};
+        double                          pcm_max_wait{30.0};
+        LoopClosureVerifier::Parameters pcm;
+
         /** Generate render visualization decoration for every N keyframes */
         int   viz_decor_decimation{5};
         float viz_decor_pointsize{2.0f};
@@ -116,6 +371,98 @@ class LidarOdometry : public FrontEndBase
     /** Algorithm parameters */
     Parameters params_;
 
+    /** Hot-reload: parses and validates a new YAML parameter block (same
+     * format than for initialize()) in a background thread. On success,
+     * the new parameters, ICP and filter instances are swapped in atomically
+     * before the next processed scan. Past-KF tasks already queued finish
+     * with the parameters they were enqueued with.
+     * Missing optional entries keep their current values.
+     * \return A future with `true` if the new parameters were accepted.
+     */
+    std::future<bool> reloadParameters(const std::string& cfg_block);
+
+    /** Published for each processed scan, in all modes */
+    struct OdometryUpdate
+    {
+        mrpt::Clock::time_point timestamp{};
+        /** Vehicle pose wrt the first scan, by integration of odometry */
+        mrpt::math::TPose3D  pose;
+        mrpt::math::TTwist3D twist;
+        double               icp_goodness{.0};
+        /** Filtered point cloud (only if `odometry_publish_clouds`) */
+        mp2p_icp::pointcloud_t::Ptr pointcloud;
+    };
+    using odometry_callback_t = std::function<void(const OdometryUpdate&)>;
+
+    /** Registers a callback to be invoked (from the odometry thread) with
+     * each new odometry estimate. It must return quickly. */
+    void subscribeToOdometry(const odometry_callback_t& callback);
+
+    /** Published with the global map tiles changed by a new KF. See
+     * Parameters::global_map_enabled */
+    struct GlobalMapUpdate
+    {
+        std::vector<TiledVoxelMap::TileSnapshot::ConstPtr> changed_tiles;
+    };
+    using global_map_callback_t = std::function<void(const GlobalMapUpdate&)>;
+
+    /** Registers a callback to be invoked (from the global map thread) with
+     * the changed tiles after each new KF. It must return quickly. */
+    void subscribeToGlobalMap(const global_map_callback_t& callback);
+
+    /** Latest version of all global map tiles, e.g. for a new subscriber */
+    std::vector<TiledVoxelMap::TileSnapshot::ConstPtr> globalMapTiles() const
+    {
+        return global_map_.allTiles();
+    }
+
+    /** Estimated memory held by the front-end, per data structure [bytes]
+     */
+    struct MemoryUsage
+    {
+        size_t kf_clouds{0};
+        size_t decorations{0};
+        size_t checked_KF_pairs{0};
+        size_t local_graph{0};
+        size_t queued_observations{0};
+        size_t global_map{0};
+
+        size_t total() const
+        {
+            return kf_clouds + decorations + checked_KF_pairs + local_graph +
+                   queued_observations + global_map;
+        }
+    };
+
+    /** Latest memory usage estimate, updated after each scan */
+    MemoryUsage memoryUsage() const
+    {
+        std::lock_guard<std::mutex> lck(memory_usage_mtx_);
+        return memory_usage_;
+    }
+
+    /** Writes all the KFs created so far, with their latest global poses,
+     * point clouds and place descriptors, to a map snapshot file for
+     * offline merging with other sessions (see mola-app-fe-lidar-merge).
+     * The list of KFs is taken in the odometry thread, between two scans;
+     * their clouds are loaded (without loading them back into the world
+     * model) and written in worker_pool_spill_.
+     * \return A future with `true` on success (`false` without a world
+     * model, e.g. in `odometry_only` mode).
+     */
+    std::future<bool> saveMapSnapshot(const std::string& file);
+
+    /** True if the watchdog switched to odometry-only mode (temporarily,
+     * see Parameters::watchdog_degrade_to_odometry_only) */
+    bool isDegraded() const { return degraded_; }
+
+    /** Returns a human-readable report of the most contended locks. See
+     * Parameters::profile_locks */
+    std::string lockContentionReport(size_t top_n = 10) const
+    {
+        return lock_profiler_.report(top_n);
+    }
+
     using topological_dist_t = std::size_t;
 
     struct ICP_Input
@@ -129,16 +476,85 @@ class LidarOdometry : public FrontEndBase
         mrpt::math::TPose3D         init_guess_to_wrt_from;
         mp2p_icp::Parameters        icp_params;
 
+        /** Whether ICP_Output::information will be used (it is only
+         * computed if so, and `factor_noise_from_information`) */
+        bool need_information{true};
+
         /** used to identity where does this request come from */
         std::string debug_str;
     };
+    /** Eigen-analysis of the alignment Hessian (see degeneracy_check) */
+    struct ICP_Degeneracy
+    {
+        /** Ascending eigenvalues of the translational and rotational
+         * blocks, normalized by the number of pairings */
+        std::array<double, 3> eig_xyz{{.0, .0, .0}}, eig_rot{{.0, .0, .0}};
+
+        /** Eigenvectors (columns) matching eig_xyz and eig_rot */
+        mrpt::math::CMatrixDouble33 eigvec_xyz, eigvec_rot;
+
+        size_t num_pairings{0};
+        bool   evaluated{false};
+        bool   is_degenerate{false};
+    };
+
     struct ICP_Output
     {
         double                          goodness{.0};
         mrpt::poses::CPose3DPDFGaussian found_pose_to_wrt_from;
+        ICP_Degeneracy                  degeneracy;
+
+        /** Information matrix of the solution in the SE(3) tangent space
+         * [x y z rx ry rz], from the point-to-plane Hessian at the final
+         * pairings. Only valid if has_information==true. */
+        mrpt::math::CMatrixDouble66 information;
+        bool                        has_information{false};
     };
+    /** Runs one ICP with the parameters in effect */
     void run_one_icp(const ICP_Input& in, ICP_Output& out);
 
+    /** Fills in out.degeneracy (unless already evaluated) and
+     * out.information (if needed, see ICP_Input::need_information) from the
+     * Hessian at the ICP solution */
+    void evaluateAlignmentHessian(
+        const ICP_Input& in, ICP_Output& out, const Parameters& p);
+
+    /** Sends a new SE(3) factor to the back-end and appends it to the local
+     * pose-graph. Variances <0 mean "unknown" (see setFactorNoise()).
+     * Does not block: the back-end reply is checked asynchronously in
+     * worker_pool_backend_replies_ (see awaitBackendReply()). */
+    void addRelativePoseFactor(
+        id_t from_id, id_t to_id, const mrpt::poses::CPose3D& rel_pose,
+        double var_xyz, double var_rot, const Parameters& p);
+
+    /** Runs PCM over all buffered loop closures and submits the accepted
+     * ones. Invoked from the past-KFs worker pool. */
+    void verifyPendingLoopClosures(const Parameters& p);
+
+    LoopClosureVerifier lc_verifier_;
+    std::mutex          lc_verifier_mtx_;
+    /** A timeout flush of lc_verifier_ is queued (see spinOnce()) */
+    std::atomic_bool lc_flush_in_flight_{false};
+
+    /** Sets the noise model of a factor from an accumulated translational
+     * and rotational variance, or the max. sigmas if <0 (unknown) */
+    void setFactorNoise(
+        mola::FactorRelativePose3& f, double var_xyz, double var_rot,
+        const Parameters& p) const;
+
+    /** A KF to be checked for an extra edge or loop closure against the
+     * latest KF, in checkForNearbyKFs() */
+    struct NearbyKFCandidate
+    {
+        id_t                kf_id{mola::INVALID_ID};
+        double              eucl_dist{.0};
+        topological_dist_t  topo_dist{0};
+        bool                is_loop_closure{false};
+        /** Out of the local graph, from the resident KF tiles */
+        bool                from_tiles{false};
+        mrpt::math::TPose3D init_guess;
+    };
+
     /** All variables that hold the algorithm state */
     struct MethodState
     {
@@ -146,9 +562,13 @@ class LidarOdometry : public FrontEndBase
         mp2p_icp::pointcloud_t::Ptr              last_points{};
         mrpt::math::TTwist3D                     last_iter_twist;
         bool                                     last_iter_twist_is_good{false};
+        TwistKalmanFilter                        twist_kf;
         id_t                                     last_kf{mola::INVALID_ID};
         mrpt::poses::CPose3D                     accum_since_last_kf{};
+        mrpt::poses::CPose3D                     odom_pose{};
         lidar_segmentation::LidarFilterBase::Ptr pc_filter;
+        /** nullptr if disabled or not available for the current params */
+        std::shared_ptr<OdometryFastPathBase> fast_path, fast_path_nearby;
 
         // An auxiliary (local) pose-graph to use Dijkstra and find guesses
         // for ICP against nearby past KFs:
@@ -162,18 +582,211 @@ class LidarOdometry : public FrontEndBase
         LocalPoseGraph local_pose_graph;
 
         int kf_decor_decim_cnt{-1};
+
+        /** Accumulated variances of the odometry increments since the last
+         * KF, translational [m^2] and rotational [rad^2]. <0: unknown */
+        double accum_var_xyz_since_last_kf{.0};
+        double accum_var_rot_since_last_kf{.0};
+
+        /** Whether the latest lidar odometry alignment was degenerate */
+        bool last_icp_degenerate{false};
+
+        /** See Parameters::multi_hypothesis_enabled. The best hypothesis
+         * pose is always odom_pose. While ambiguous, all hypotheses are
+         * aligned against the anchor cloud, at its odom pose: the last KF
+         * cloud (only kept if enabled) or, if none nearby, the last scan
+         * before the ambiguity. */
+        OdometryHypotheses          hypotheses;
+        mp2p_icp::pointcloud_t::Ptr last_kf_points, hypotheses_anchor_points;
+        mrpt::poses::CPose3D        last_kf_pose, hypotheses_anchor_pose;
+
+        /** Memory accounting (see Parameters::memory_budget_mb) */
+        std::map<id_t, size_t> kf_cloud_bytes, kf_decor_bytes;
+        std::set<id_t>         kf_decimated;
+        /** Unloaded KFs, with their cloud bytes while loaded */
+        std::map<id_t, size_t> kf_unloaded;
+        /** KFs requested to be loaded back in the background and not used
+         * yet, with the observation time of the request, and cache
+         * statistics of accesses to unloaded KFs (see kf_prefetch_enabled)
+         */
+        std::map<id_t, mrpt::Clock::time_point> kf_loaded_ahead;
+        size_t                 kf_prefetch_hits{0}, kf_prefetch_misses{0};
+        size_t                 last_obs_bytes{0};
+        int                    memory_pressure_level{0};
+        /** Lowered by graph eviction under memory pressure */
+        size_t local_graph_max_kfs{std::numeric_limits<size_t>::max()};
+
+        /** Candidates of checkForNearbyKFs() for the KF `from_id`, sorted
+         * by expected value, and the next one to evaluate (see
+         * Parameters::nearby_kfs_time_budget). Also, the checks already
+         * dispatched for `from_id`, over all calls (at most
+         * `max_nearby_align_checks` nearby ones and one loop closure). */
+        struct NearbyKFsCursor
+        {
+            id_t                           from_id{mola::INVALID_ID};
+            std::vector<NearbyKFCandidate> pending;
+            size_t                         next{0};
+            size_t                         nearby_dispatched{0};
+            bool                           loop_closure_dispatched{false};
+        };
+        NearbyKFsCursor nearby_kfs_cursor;
     };
 
     const MethodState& state() const { return state_; }
     MethodState        stateCopy() const { return state_; }
 
    private:
+    /** Parameter loading shared by initialize() and reloadParameters() */
+    void loadParameters(
+        const mrpt::containers::yaml& cfg, Parameters& p,
+        lidar_segmentation::LidarFilterBase::Ptr& out_filter);
+    /** Throws if the parameters are not consistent */
+    static void validateParameters(const Parameters& p);
+
+    /** Parameters, together with the instances built from them */
+    struct ParameterSet
+    {
+        Parameters                               params;
+        lidar_segmentation::LidarFilterBase::Ptr pc_filter;
+        std::shared_ptr<OdometryFastPathBase>    fast_path, fast_path_nearby;
+    };
+    std::shared_ptr<ParameterSet> pending_params_;
+    /** The set in effect. Threads other than the odometry one never read
+     * params_, but keep a reference to this set instead, so a swap never
+     * changes the parameters in the middle of their tasks. */
+    std::shared_ptr<const ParameterSet> active_params_;
+    /** Protects pending_params_, active_params_ and the swap of params_ */
+    mutable std::mutex params_swap_mtx_;
+    /** Number of tasks enqueued into worker_pool_past_KFs_ not finished yet
+     * (reported as the `past_KFs.tasks_in_flight` user measure) */
+    std::atomic<int> past_KF_tasks_in_flight_{0};
+
+    /** The parameter set in effect, for any thread */
+    std::shared_ptr<const ParameterSet> activeParameters() const;
+
+    /** Swaps in the pending parameters, if any. Only called from the
+     * odometry thread, between scans. */
+    void applyPendingParameters();
+
+    /** Enqueues a task into worker_pool_past_KFs_, keeping track of it. It
+     * is invoked with the parameter set in effect when it was enqueued. */
+    void enqueuePastKFTask(std::function<void(const ParameterSet&)> task);
+
+    /** run_one_icp() with the given parameter set */
+    void run_one_icp(
+        const ICP_Input& in, ICP_Output& out, const ParameterSet& ps);
+
+    mutable LockProfiler lock_profiler_;
+
+    StallWatchdog    watchdog_;
+    std::atomic_bool degraded_{false};
+
+    /** A new KF requested to the back-end, with what we attach to it once
+     * it replies: its cloud, and the odometry since the previous KF. */
+    struct ProposedKeyFrame
+    {
+        std::future<BackEndBase::ProposeKF_Output> reply;
+        CObservation::Ptr                          obs;
+        mp2p_icp::pointcloud_t::Ptr                points;
+        mrpt::poses::CPose3D                       pose;
+        mrpt::poses::CPose3D                       accum;
+        double accum_var_xyz{.0}, accum_var_rot{.0};
+    };
+
+    /** Degraded mode state, see checkDegradedModeRecovery() */
+    std::chrono::steady_clock::time_point degraded_since_{};
+    ProposedKeyFrame                      degraded_pending_kf_;
+    std::mutex                            degraded_mtx_;
+
+    MemoryUsage        memory_usage_;
+    mutable std::mutex memory_usage_mtx_;
+
+    /** Updates the memory usage estimate and, if over budget, frees memory.
+     * Only called from the odometry thread. */
+    void enforceMemoryBudget();
+    MemoryUsage computeMemoryUsage() const;
+    void        memoryDropDecorations();
+    void        memoryDecimateKFClouds();
+    void        memoryUnloadKFClouds();
+    void        memoryEvictLocalGraph();
+
+    /** See Parameters::wheel_odometry_label */
+    WheelOdometryBuffer wheel_odometry_;
+
+    /** Buffers `o` if it is a wheel odometry reading.
+     * Runs in the caller thread, with activeParameters().
+     * \return true if `o` was consumed */
+    bool handleWheelOdometry(const CObservation::Ptr& o);
+
+    /** See Parameters::warmup_enabled */
+    void             warmUp();
+    std::atomic_bool warming_up_{false};
+
+    /** Arrival of the first observation to process, and whether the first
+     * pose was already published (`startup_to_first_pose` measure) */
+    std::chrono::steady_clock::time_point first_obs_time_{};
+    std::atomic_bool                      first_obs_seen_{false};
+    bool                                  first_pose_reported_{false};
+
+    /** Stops creating KFs until checkDegradedModeRecovery() sees the
+     * cause gone, if so configured in `p`. `pending_kf` is the addKeyFrame()
+     * request the back-end did not reply to, if that was the cause. */
+    void enterDegradedMode(
+        const std::string& reason, const Parameters& p,
+        ProposedKeyFrame pending_kf = {});
+
+    /** Stores the cloud of the new KF `kf_out` in the world model and adds
+     * the factor from the last KF to it. Odometry thread only. */
+    void attachKeyFrame(
+        const BackEndBase::ProposeKF_Output& kf_out,
+        const ProposedKeyFrame&              pkf);
+
+    /** In degraded mode, attaches the KF the back-end replied late to,
+     * once the reply arrived. Odometry thread only. */
+    void attachLateKeyFrame();
+
+    /** Leaves degraded mode if, after `watchdog_odometry_timeout`, the
+     * odometry thread is not stalled and the back-end replied. */
+    void checkDegradedModeRecovery(const Parameters& p);
+
+    /** Thread for parsing and validating hot-reloaded parameters */
+    mrpt::WorkerThreadsPool worker_pool_reload_{1};
+
     /** The worker thread pool with 1 thread for processing incomming scans */
     mrpt::WorkerThreadsPool worker_pool_{1};
 
+    /** KFs in MethodState::kf_loaded_ahead whose clouds were already
+     * loaded by the background task (set from worker_pool_past_KFs_) */
+    std::set<id_t> kf_loaded_in_background_;
+    std::mutex     kf_loaded_in_background_mtx_;
+
     /** Worker thread to align a new KF against past KFs:*/
     mrpt::WorkerThreadsPool worker_pool_past_KFs_{1};
 
+    /** Threads for the per-KF normals estimation (see
+     * Parameters::kf_compute_normals). Not shared with the past-KF pool, so
+     * the odometry thread never waits behind queued loop closure ICPs. */
+    mrpt::WorkerThreadsPool worker_pool_normals_{1};
+
+    /** Thread to compress and store KF raw observations */
+    mrpt::WorkerThreadsPool worker_pool_compress_{1};
+
+    /** Compresses `o` in worker_pool_compress_ and attaches it to the KF */
+    void storeRawObservation(id_t kf_id, const CObservation::Ptr& o);
+
+    /** Thread where replies from the back-end are awaited and checked, so
+     * the odometry and past-KF threads never block on them */
+    mrpt::WorkerThreadsPool worker_pool_backend_replies_{1};
+
+    /** Number of back-end requests sent and not replied yet */
+    std::atomic<int> backend_requests_in_flight_{0};
+
+    /** Checks in worker_pool_backend_replies_ that the back-end accepted a
+     * factor, logging an error otherwise */
+    void awaitBackendReply(
+        std::future<BackEndBase::AddFactor_Output>&& fut,
+        const std::string&                           what);
+
     MethodState     state_;
     WorldModel::Ptr worldmodel_;
 
@@ -182,13 +795,145 @@ class LidarOdometry : public FrontEndBase
     void doProcessNewObservation(CObservation::Ptr& o);
     void checkForNearbyKFs();
 
+    /** Replaces the components of `icp_pose` that are unobservable
+     * according to `dg` by those of the motion prior */
+    mrpt::poses::CPose3D fuseWithMotionPrior(
+        const mrpt::poses::CPose3D& icp_pose,
+        const mrpt::poses::CPose3D& prior, const ICP_Degeneracy& dg) const;
+
+    /** An alignment of one alternative odometry hypothesis */
+    struct HypothesisAlignment
+    {
+        /** Index in state_.hypotheses */
+        size_t               parent{0};
+        mrpt::poses::CPose3D prior;
+        /** Aligned against the anchor cloud instead of the last scan */
+        bool anchored{false};
+        ICP_Input            in;
+        ICP_Output           out;
+        /** Not valid if run in the calling thread */
+        std::future<void> done;
+    };
+    using hypothesis_alignments_t =
+        std::vector<std::shared_ptr<HypothesisAlignment>>;
+
+    /** If there are several hypotheses, launches the alignments of all of
+     * them against the anchor cloud. Empty if disabled or not ambiguous. */
+    hypothesis_alignments_t launchHypothesisAlignments(
+        const ICP_Input& main_in, bool has_wheel_prior);
+    void startHypothesisAlignments(hypothesis_alignments_t& jobs);
+
+    /** Waits for `jobs`, spawns new hypotheses if the main alignment was
+     * degenerate, and updates state_.hypotheses.
+     * \return The relative pose of the (new) best hypothesis wrt the
+     * current odom_pose. */
+    mrpt::poses::CPose3D updateHypotheses(
+        hypothesis_alignments_t& jobs, const ICP_Input& main_in,
+        const ICP_Output& main_out, const mrpt::poses::CPose3D& main_increment);
+
+    /** Retrieves from the world model the clouds of d.from_id and d.to_id,
+     * loading them from disk if needed */
+    void readKFPointClouds(ICP_Input& d);
+
+    /** See Parameters::kf_tiles_enabled. Only used in the odometry thread */
+    KeyFrameTiles kf_tiles_;
+
+    /** Loads/unloads KF clouds as the vehicle moves across tiles */
+    void updateKFTileResidency();
+
+    /** Loads the clouds of unloaded KFs near the predicted trajectory. See
+     * Parameters::kf_prefetch_enabled */
+    void prefetchKFClouds();
+
+    /** Loads the clouds of these unloaded KFs in a past-KF worker thread */
+    void loadKFCloudsInBackground(const std::vector<id_t>& ids);
+
+    /** Drops the KFs loaded ahead and not used within
+     * `kf_prefetch_horizon`, so they can be unloaded again */
+    void expireKFsLoadedAhead();
+
+    /** Accounts for an access to the cloud of a KF, for the prefetch cache
+     * statistics and the memory budget */
+    void accountKFCloudAccess(id_t id);
+
+    /** Spills the clouds of these KFs to disk (except those in the local
+     * graph, or already unloaded) in worker_pool_spill_. The bookkeeping
+     * in state_ is updated right away. */
+    void unloadKFClouds(const std::vector<id_t>& ids);
+
+    /** KFs queued to be spilled. Removed if loaded back before that. */
+    std::set<id_t> kf_spill_pending_;
+    std::mutex     kf_spill_pending_mtx_;
+    /** Thread writing KF clouds to disk (and decimating them, see
+     * memoryDecimateKFClouds()), so the odometry thread never does.
+     * Declared after the data it uses, so it is stopped first. */
+    mrpt::WorkerThreadsPool worker_pool_spill_{1};
+
+    /** Appends per-point normals (as plane patches) to a new KF cloud */
+    void estimateKFNormals(mp2p_icp::pointcloud_t& pc);
+
+    /** Adds the `reflectors` layer to a filtered cloud. See
+     * Parameters::reflectors_enabled */
+    void addReflectorsLayer(
+        const mrpt::obs::CObservation& o, mp2p_icp::pointcloud_t& pc);
+
     /** Invoked from doProcessNewObservation() whenever a new KF is created,
      * to check for additional edges apart of the "odometry edge", to increase
      * the quality of the estimation by increasing the pose-graph density.
      */
-    void doCheckForNonAdjacentKFs(ICP_Input::Ptr d);
-
-    std::mutex local_pose_graph_mtx;
+    void doCheckForNonAdjacentKFs(ICP_Input::Ptr d, const ParameterSet& ps);
+
+    /** The local pose-graph (state_.local_pose_graph) is only accessed from
+     * the odometry thread. Other threads append new edges to this log,
+     * merged at the next checkForNearbyKFs(), and read node poses from the
+     * snapshot published after each Dijkstra run (RCU-like).
+     * @{ */
+    struct PendingEdge
+    {
+        id_t                 from_id{mola::INVALID_ID};
+        id_t                 to_id{mola::INVALID_ID};
+        mrpt::poses::CPose3D rel_pose;
+    };
+    std::vector<PendingEdge> local_pose_graph_log_;
+    std::mutex               local_pose_graph_log_mtx_;
+    /** Swapped with local_pose_graph_log_ on each merge, so both keep
+     * the capacity reserved in warmUp() */
+    std::vector<PendingEdge> local_pose_graph_log_merged_;
+
+    using kf_poses_t = std::map<id_t, mrpt::poses::CPose3D>;
+    /** KF poses wrt the latest KF. Access with std::atomic_load/store */
+    std::shared_ptr<const kf_poses_t> local_pose_graph_snapshot_;
+
+    /** Moves all pending edges into the local pose-graph */
+    void mergeLocalPoseGraphLog();
+    /** @} */
+
+    std::vector<odometry_callback_t> odometry_subscribers_;
+    std::mutex                       odometry_subscribers_mtx_;
+
+    /** See Parameters::global_map_enabled */
+    TiledVoxelMap                      global_map_;
+    std::vector<global_map_callback_t> global_map_subscribers_;
+    std::mutex                         global_map_subscribers_mtx_;
+    /** KFs with new factors since the last updateGlobalMap(), and the next
+     * KF id of the round-robin pose refresh */
+    std::set<id_t> global_map_dirty_kfs_;
+    id_t           global_map_refresh_next_{0};
+    std::mutex     global_map_dirty_mtx_;
+    /** Declared after the data it uses, so it is stopped first */
+    mrpt::WorkerThreadsPool worker_pool_global_map_{1};
+
+    /** Inserts a new KF into the global map, updates the poses of some of
+     * the rest from the back-end (see global_map_max_pose_refresh), and
+     * publishes the changed tiles. Runs in worker_pool_global_map_. */
+    void updateGlobalMap(
+        id_t new_kf_id, const mp2p_icp::pointcloud_t::Ptr& pc,
+        const TiledVoxelMap::Parameters& p, const std::string& layers,
+        size_t max_pose_refresh);
+
+    void publishOdometry(
+        const mrpt::Clock::time_point& timestamp, double icp_goodness,
+        const mp2p_icp::pointcloud_t::Ptr& pc);
 
     // Debug aux variables:
     std::atomic<unsigned int> debug_dump_icp_file_counter{0};
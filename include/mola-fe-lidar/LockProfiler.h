@@ -0,0 +1,151 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   LockProfiler.h
+ * @brief  Wait/hold time statistics of instrumented locks
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+#pragma once
+
+#include <mola-kernel/WorldModel.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <type_traits>
+
+namespace mola
+{
+/** Collects, for each named critical section, the distribution of the time
+ * spent waiting to acquire it and holding it, and the call sites holding it.
+ * Thread-safe. Feed it through ProfiledLockGuard.
+ */
+class LockProfiler
+{
+   public:
+    /** Histograms have one bin per power of two, in microseconds */
+    static constexpr size_t NUM_BINS = 24;
+
+    struct Distribution
+    {
+        std::array<uint64_t, NUM_BINS> bins{};
+        double                         sum{.0}, max{.0};
+
+        void   add(double seconds);
+        /** Approximate quantile (0<=q<=1), from the histogram [s] */
+        double quantile(double q, uint64_t count) const;
+    };
+
+    struct Stats
+    {
+        uint64_t     count{0};
+        Distribution wait, hold;
+        /** Total hold time per call site ("file:line") [s] */
+        std::map<std::string, double> hold_by_site;
+    };
+
+    std::atomic_bool enabled{false};
+
+    void record(
+        const char* section, const char* file, int line, double wait_s,
+        double hold_s);
+
+    /** Sections sorted by decreasing total wait time, up to `top_n` */
+    std::string report(size_t top_n = 10) const;
+
+    bool empty() const;
+    void clear();
+
+   private:
+    mutable std::mutex           mtx_;
+    std::map<std::string, Stats> stats_;
+};
+
+/** Like std::lock_guard, recording wait and hold times into a LockProfiler.
+ * LOCKABLE is any type with lock() and unlock(). Use the
+ * MOLA_PROFILED_LOCK() macro to fill in the call site. */
+template <class LOCKABLE>
+class ProfiledLockGuard
+{
+   public:
+    using clock = std::chrono::steady_clock;
+
+    ProfiledLockGuard(
+        LockProfiler& prof, LOCKABLE& m, const char* section, const char* file,
+        int line)
+        : prof_(prof), m_(m), section_(section), file_(file), line_(line)
+    {
+        if (!prof_.enabled)
+        {
+            m_.lock();
+            return;
+        }
+        const auto t0 = clock::now();
+        m_.lock();
+        acquired_ = clock::now();
+        wait_     = std::chrono::duration<double>(acquired_ - t0).count();
+        active_   = true;
+    }
+
+    ~ProfiledLockGuard()
+    {
+        if (!active_)
+        {
+            m_.unlock();
+            return;
+        }
+        const double hold =
+            std::chrono::duration<double>(clock::now() - acquired_).count();
+        m_.unlock();
+        prof_.record(section_, file_, line_, wait_, hold);
+    }
+
+    ProfiledLockGuard(const ProfiledLockGuard&) = delete;
+    ProfiledLockGuard& operator=(const ProfiledLockGuard&) = delete;
+
+   private:
+    LockProfiler&     prof_;
+    LOCKABLE&         m_;
+    const char*       section_;
+    const char*       file_;
+    int               line_;
+    clock::time_point acquired_{};
+    double            wait_{.0};
+    bool              active_{false};
+};
+
+/** Lockable adaptors for the WorldModel reader/writer locks */
+struct WorldModelEntitiesReadLock
+{
+    WorldModel& wm;
+    void        lock() { wm.entities_lock_for_read(); }
+    void        unlock() { wm.entities_unlock_for_read(); }
+};
+struct WorldModelEntitiesWriteLock
+{
+    WorldModel& wm;
+    void        lock() { wm.entities_lock_for_write(); }
+    void        unlock() { wm.entities_unlock_for_write(); }
+};
+struct WorldModelFactorsReadLock
+{
+    WorldModel& wm;
+    void        lock() { wm.factors_lock_for_read(); }
+    void        unlock() { wm.factors_unlock_for_read(); }
+};
+
+}  // namespace mola
+
+/** Declares a ProfiledLockGuard named VAR for the lockable MUTEX (an
+ * lvalue) */
+#define MOLA_PROFILED_LOCK(VAR, PROFILER, MUTEX, SECTION)                 \
+    mola::ProfiledLockGuard<std::remove_reference_t<decltype(MUTEX)>> VAR( \
+        PROFILER, MUTEX, SECTION, __FILE__, __LINE__)
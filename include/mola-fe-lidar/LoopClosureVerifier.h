@@ -0,0 +1,88 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   LoopClosureVerifier.h
+ * @brief  Pairwise consistency maximization (PCM) for loop closure batches
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+#pragma once
+
+#include <mola-kernel/interfaces/FrontEndBase.h>
+#include <mrpt/core/Clock.h>
+#include <mrpt/core/bits_math.h>
+#include <mrpt/poses/CPose3D.h>
+
+#include <map>
+#include <set>
+#include <vector>
+
+namespace mola
+{
+/** Buffers candidate loop closures and only releases those belonging to the
+ * largest pairwise-consistent subset.
+ *
+ * Two loop closures z_i=(a_i -> b_i) and z_j=(a_j -> b_j) are consistent if
+ * the cycle they close through the odometry estimate:
+ *
+ *   z_i (+) T(b_i,b_j) (+) z_j^-1 (+) T(a_j,a_i)
+ *
+ * is close enough to the identity. Consistency defines an undirected graph,
+ * whose maximum clique is the accepted set.
+ */
+class LoopClosureVerifier
+{
+   public:
+    struct Parameters
+    {
+        /** Max. cycle error to consider two closures consistent */
+        double max_error_xyz{1.0};  //!< [m]
+        double max_error_rot{mrpt::DEG2RAD(5.0)};  //!< [rad]
+
+        /** Minimum size of the consistent set to be accepted */
+        unsigned int min_clique_size{2};
+    };
+
+    struct Candidate
+    {
+        id_t                 from_id{mola::INVALID_ID};
+        id_t                 to_id{mola::INVALID_ID};
+        mrpt::poses::CPose3D rel_pose;  //!< "to" wrt "from"
+        double               var_xyz{-1}, var_rot{-1};
+        mrpt::Clock::time_point added_at{};
+    };
+
+    Parameters params;
+
+    void   add(const Candidate& c);
+    size_t size() const { return candidates_.size(); }
+    bool   empty() const { return candidates_.empty(); }
+    void   clear() { candidates_.clear(); }
+
+    /** Age of the oldest buffered candidate [s], or 0 if empty */
+    double oldestAge() const;
+
+    /** KF ids involved in all buffered candidates */
+    std::set<id_t> involvedKFs() const;
+
+    /** Evaluates the whole buffer against the given KF pose estimates (all
+     * of them in any common frame), returns the maximal consistent set (if
+     * large enough, otherwise an empty set), and clears the buffer.
+     * Candidates involving KFs without a pose estimate are discarded. */
+    std::vector<Candidate> verify(
+        const std::map<id_t, mrpt::poses::CPose3D>& kf_poses);
+
+   private:
+    std::vector<Candidate> candidates_;
+};
+
+/** Exact maximum clique of an undirected graph given as an adjacency matrix
+ * (adj[i][j]==true if i and j are connected), by branch and bound with a
+ * greedy coloring upper bound. Suitable for small graphs (tens of nodes).
+ */
+std::vector<size_t> maximum_clique(const std::vector<std::vector<bool>>& adj);
+
+}  // namespace mola
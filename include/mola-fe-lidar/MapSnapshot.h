@@ -0,0 +1,53 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   MapSnapshot.h
+ * @brief  On-disk snapshot of the KFs of a front-end map
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+#pragma once
+
+#include <mola-fe-lidar/PlaceDescriptor.h>
+#include <mola-kernel/id.h>
+#include <mp2p_icp/pointcloud.h>
+#include <mrpt/poses/CPose3D.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mola
+{
+/** All the KFs of one (or several merged) mapping sessions, with their
+ * global poses, point clouds and place descriptors, as written by
+ * LidarOdometry::saveMapSnapshot() and read by mola-app-fe-lidar-merge.
+ *
+ * Files are gzip-compressed MRPT archives.
+ */
+struct MapSnapshot
+{
+    struct KeyFrame
+    {
+        /** KF id in its original session */
+        id_t id{mola::INVALID_ID};
+        /** Index of the source session (0 for a single session) */
+        uint32_t                    session{0};
+        mrpt::poses::CPose3D        pose;
+        mp2p_icp::pointcloud_t::Ptr pc;
+        /** Cached, so merging does not recompute them for every run */
+        PlaceDescriptor descriptor;
+    };
+
+    std::vector<KeyFrame> keyframes;
+
+    /** Throws on I/O errors */
+    void save(const std::string& file) const;
+    /** Throws on I/O errors or on an unknown file format */
+    void load(const std::string& file);
+};
+
+}  // namespace mola
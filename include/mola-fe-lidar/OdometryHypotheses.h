@@ -0,0 +1,135 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   OdometryHypotheses.h
+ * @brief  Set of competing lidar odometry trajectories, for ambiguous scenes
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+#pragma once
+
+#include <mrpt/poses/CPose3D.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace mola
+{
+/** Keeps a small set of odometry pose hypotheses for geometrically ambiguous
+ * environments (tunnels, repetitive corridors), where scan matching has
+ * several local minima along the weakly-observable directions.
+ *
+ * Each step, every hypothesis is extended with one or more candidate
+ * increments (ICP solutions from different seeds), scored by the ICP
+ * goodness and the consistency with a motion prior. For the scores to tell
+ * hypotheses apart, the caller must align each one against data seen from
+ * a different relative pose by each of them (e.g. the last KF), not only
+ * against the previous scan. Scores are accumulated with an exponential
+ * forgetting factor. Hypotheses falling too far behind the best one are
+ * pruned, and those converging to the same pose are merged, so the set
+ * collapses back to one hypothesis once the scene is unambiguous, or after
+ * `max_ambiguous_steps` in any case.
+ *
+ * This class only holds the bookkeeping; alignments are run by the caller.
+ */
+class OdometryHypotheses
+{
+   public:
+    struct Parameters
+    {
+        /** Maximum number of simultaneous hypotheses */
+        unsigned int max_hypotheses{4};
+
+        /** New hypotheses are seeded at +/- this distance along the least
+         * observable direction of a degenerate alignment [m] */
+        double spawn_offset{2.0};
+
+        /** Std. deviation of the motion prior, for scoring [m], [rad] */
+        double prior_sigma_xyz{1.0};
+        double prior_sigma_rot{0.02};
+
+        /** Weight of the ICP goodness (in [0,1]) in the step score */
+        double goodness_weight{10.0};
+
+        /** Forgetting factor of the accumulated scores, in (0,1] */
+        double score_decay{0.9};
+
+        /** Hypotheses with a score below the best one minus this are
+         * pruned */
+        double prune_margin{3.0};
+
+        /** Hypotheses closer than this are merged [m] */
+        double merge_distance{0.20};
+
+        /** After this many consecutive steps with several hypotheses, the
+         * set collapses to the best one (0=never) */
+        unsigned int max_ambiguous_steps{20};
+    };
+
+    struct Hypothesis
+    {
+        /** Accumulated odometry pose */
+        mrpt::poses::CPose3D pose;
+        /** Latest increment, used as constant-velocity prior */
+        mrpt::poses::CPose3D last_increment;
+        double               last_goodness{.0};
+        double               score{.0};
+        /** Unique id, kept by the descendants of this hypothesis */
+        uint32_t id{0};
+    };
+
+    /** One alignment result for the current step */
+    struct Candidate
+    {
+        /** Index of the hypothesis this increment extends */
+        size_t               parent{0};
+        mrpt::poses::CPose3D increment;
+        /** Prior increment to score the consistency with */
+        mrpt::poses::CPose3D prior;
+        double               goodness{.0};
+    };
+
+    /** Resets to one single hypothesis */
+    void reset(const mrpt::poses::CPose3D& pose);
+    void clear()
+    {
+        hyps_.clear();
+        ambiguous_steps_ = 0;
+    }
+
+    bool   empty() const { return hyps_.empty(); }
+    size_t size() const { return hyps_.size(); }
+    bool   ambiguous() const { return hyps_.size() > 1; }
+
+    /** The hypothesis with the highest score. Do not call if empty(). */
+    const Hypothesis& best() const { return hyps_.at(best_); }
+    size_t            bestIndex() const { return best_; }
+
+    const std::vector<Hypothesis>& hypotheses() const { return hyps_; }
+
+    /** Replaces the current hypotheses by their extensions with the given
+     * candidates, then merges, prunes and caps the set. Hypotheses without
+     * any candidate are dropped. */
+    void update(const std::vector<Candidate>& candidates, const Parameters& p);
+
+    /** Keeps the best hypothesis only */
+    void collapse();
+
+    /** Consecutive update() steps ending with several hypotheses */
+    unsigned int ambiguousSteps() const { return ambiguous_steps_; }
+
+    /** Score of one step: weighted goodness minus half the squared
+     * Mahalanobis distance to the motion prior */
+    static double stepScore(const Candidate& c, const Parameters& p);
+
+   private:
+    std::vector<Hypothesis> hyps_;
+    size_t                  best_{0};
+    uint32_t                next_id_{0};
+    unsigned int            ambiguous_steps_{0};
+};
+
+}  // namespace mola
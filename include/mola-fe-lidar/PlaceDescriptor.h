@@ -0,0 +1,51 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   PlaceDescriptor.h
+ * @brief  Compact, yaw-invariant appearance descriptor of a KF point cloud
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+#pragma once
+
+#include <mp2p_icp/pointcloud.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace mola
+{
+/** Polar grid (rings x sectors) around the KF origin with the maximum point
+ * height in each cell, in the spirit of "Scan Context" (Kim & Kim, 2018).
+ *
+ * The distance between two descriptors is minimized over all circular
+ * sector shifts, so it is invariant to the vehicle heading, and the best
+ * shift gives a coarse relative yaw to seed ICP.
+ */
+struct PlaceDescriptor
+{
+    uint16_t num_rings{20}, num_sectors{60};
+    /** Ring-major (rings x sectors) max. heights; empty if not computed */
+    std::vector<float> cells;
+
+    bool empty() const { return cells.empty(); }
+
+    /** Computes the descriptor from all the point layers of a KF cloud,
+     * only for points closer than `max_range` [m] in the XY plane */
+    static PlaceDescriptor FromPointCloud(
+        const mp2p_icp::pointcloud_t& pc, double max_range = 50.0);
+
+    /** Fraction of non-empty sectors per ring: a yaw-invariant summary,
+     * cheap to compare, to preselect candidates before distance() */
+    std::vector<float> ringKey() const;
+
+    /** Mean cosine distance between columns, in [0,1], for the best sector
+     * shift. If `yaw` is not null, it gets the heading of `o` wrt this
+     * descriptor for that shift [rad]. */
+    double distance(const PlaceDescriptor& o, double* yaw = nullptr) const;
+};
+
+}  // namespace mola
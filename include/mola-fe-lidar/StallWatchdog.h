@@ -0,0 +1,106 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   StallWatchdog.h
+ * @brief  Progress heartbeats and stall detection for worker thread tasks
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace mola
+{
+/** Keeps track of running tasks and the time of their last progress
+ * heartbeat, so tasks blocked for too long can be detected and reported.
+ *
+ * Tasks are registered with a Scope object. Code running inside a task
+ * reports progress with beat(), which also stores the stage name into a
+ * small per-task trace ring buffer. Thread-safe.
+ */
+class StallWatchdog
+{
+   public:
+    using clock     = std::chrono::steady_clock;
+    using task_id_t = uint64_t;
+
+    /** Length of the per-task trace ring buffer */
+    static constexpr size_t TRACE_LENGTH = 16;
+
+    struct TraceEntry
+    {
+        clock::time_point stamp{};
+        std::string       stage;
+    };
+
+    struct Task
+    {
+        std::string             pool, name;
+        clock::time_point       started{}, last_beat{};
+        std::string             stage;
+        std::vector<TraceEntry> trace;  //!< ring buffer, see trace_next
+        size_t                  trace_next{0};
+        bool                    reported{false};
+    };
+
+    /** Max. time without heartbeats for tasks of the given pool [s] */
+    void setThreshold(const std::string& pool, double seconds);
+
+    /** RAII registration of the task running in this thread */
+    class Scope
+    {
+       public:
+        Scope(StallWatchdog& wd, const std::string& pool, std::string name);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+       private:
+        StallWatchdog& wd_;
+        task_id_t      id_;
+        task_id_t      prev_id_;
+        StallWatchdog* prev_wd_;
+    };
+
+    /** Progress heartbeat from the task running in the calling thread, if
+     * any. `stage` must be a string literal or otherwise outlive the call. */
+    void beat(const char* stage);
+
+    struct Stall
+    {
+        Task   task;
+        double silent_for{.0};  //!< Time since the last heartbeat [s]
+    };
+
+    /** Returns tasks without heartbeats for longer than their pool
+     * threshold. Each stalled task is only returned once. */
+    std::vector<Stall> checkForStalls();
+
+    /** Human-readable state and trace of a stalled task */
+    static std::string dump(const Stall& s);
+
+    /** Number of tasks currently registered */
+    size_t runningTasks() const;
+
+    /** Number of running tasks of the given pool currently without
+     * heartbeats for longer than its threshold, reported or not. */
+    size_t stalledTasks(const std::string& pool) const;
+
+   private:
+    mutable std::mutex            mtx_;
+    std::map<task_id_t, Task>     tasks_;
+    std::map<std::string, double> thresholds_;
+    task_id_t                     next_id_{1};
+};
+
+}  // namespace mola
@@ -0,0 +1,122 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   TiledVoxelMap.h
+ * @brief  Incrementally-built global voxel map, split in 2D tiles
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+#pragma once
+
+#include <mola-kernel/id.h>
+#include <mrpt/maps/CPointsMap.h>
+#include <mrpt/maps/CSimplePointsMap.h>
+#include <mrpt/poses/CPose3D.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace mola
+{
+/** A global map of voxel centroids, built from KF clouds and their
+ * (changing) global poses, organized in square tiles on the XY plane.
+ *
+ * Each KF cloud is voxelized once, in its local frame, on insertion. Tiles
+ * keep the set of KFs with points inside them, and are only rebuilt (from
+ * those KFs) when one of them is inserted or its pose changes beyond a
+ * tolerance, so the cost of an update is proportional to the changed area.
+ * Rebuilt tiles are returned as immutable snapshots with an increasing
+ * version number. Thread-safe.
+ */
+class TiledVoxelMap
+{
+   public:
+    struct Parameters
+    {
+        double voxel_size{0.5};  //!< [m]
+        double tile_size{50.0};  //!< [m]
+
+        /** Smaller KF pose changes do not invalidate tiles [m], [rad] */
+        double pose_tolerance_xyz{0.05};
+        double pose_tolerance_rot{0.005};
+    };
+
+    using tile_key_t = std::pair<int32_t, int32_t>;
+
+    /** A published version of one tile */
+    struct TileSnapshot
+    {
+        using ConstPtr = std::shared_ptr<const TileSnapshot>;
+
+        tile_key_t key{0, 0};
+        uint64_t   version{0};
+        /** XY bounds [m] */
+        double min_x{0}, min_y{0}, max_x{0}, max_y{0};
+        /** Voxel centroids, in global coordinates (empty: removed tile) */
+        mrpt::maps::CSimplePointsMap::Ptr voxels;
+    };
+
+    /** Adds a new KF with its cloud in the KF local frame */
+    void insertKeyFrame(
+        id_t id, const mrpt::poses::CPose3D& pose,
+        const mrpt::maps::CPointsMap& local_cloud, const Parameters& p);
+
+    /** Updates a KF pose. Tiles are only invalidated if it changed beyond
+     * the tolerance. \return true if tiles were invalidated */
+    bool updateKeyFramePose(
+        id_t id, const mrpt::poses::CPose3D& pose, const Parameters& p);
+
+    /** Ids of all KFs in the map */
+    std::vector<id_t> keyFrames() const;
+
+    /** Up to `max_count` KF ids in increasing order, from the first one not
+     * below `first` and wrapping around, for round-robin visits */
+    std::vector<id_t> keyFramesFrom(id_t first, size_t max_count) const;
+
+    /** Rebuilds the tiles invalidated since the last call, and returns
+     * them */
+    std::vector<TileSnapshot::ConstPtr> flushChangedTiles(const Parameters& p);
+
+    /** The latest snapshot of all tiles, e.g. for a new subscriber */
+    std::vector<TileSnapshot::ConstPtr> allTiles() const;
+
+    /** Approximate memory footprint [bytes] */
+    size_t memoryBytes() const;
+
+    void clear();
+
+   private:
+    struct KeyFrame
+    {
+        mrpt::poses::CPose3D pose;
+        /** Voxelized cloud, in the KF frame */
+        mrpt::maps::CSimplePointsMap local;
+        std::set<tile_key_t>         tiles;
+    };
+    struct Tile
+    {
+        std::set<id_t>         kfs;
+        bool                   dirty{false};
+        TileSnapshot::ConstPtr snapshot;
+    };
+
+    mutable std::mutex         mtx_;
+    std::map<id_t, KeyFrame>   kfs_;
+    std::map<tile_key_t, Tile> tiles_;
+    uint64_t                   next_version_{1};
+
+    /** Recomputes the tiles touched by a KF, marking old and new as dirty */
+    void assignTiles(id_t id, KeyFrame& kf, const Parameters& p);
+    TileSnapshot::ConstPtr rebuildTile(
+        const tile_key_t& key, const Tile& t, const Parameters& p);
+};
+
+}  // namespace mola
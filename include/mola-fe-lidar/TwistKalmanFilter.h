@@ -0,0 +1,96 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   TwistKalmanFilter.h
+ * @brief  Kalman filter over the SE(3) twist, fed with ICP increments
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+#pragma once
+
+#include <mrpt/math/TTwist3D.h>
+#include <mrpt/poses/CPose3D.h>
+
+#include <array>
+
+namespace mola
+{
+/** Constant-velocity Kalman filter over the vehicle twist, expressed in the
+ * SE(3) tangent space [vx vy vz wx wy wz] (body frame). Measurements are
+ * relative poses between consecutive scans, mapped to a twist with the SE(3)
+ * logarithm.
+ *
+ * Process and measurement noises are diagonal and the observation model is
+ * the identity, so the filter reduces to 6 independent scalar filters.
+ * Measurements are gated with their Mahalanobis distance; after a number of
+ * consecutive rejections the filter is re-initialized from the measurement,
+ * so real abrupt maneuvers are eventually followed.
+ */
+class TwistKalmanFilter
+{
+   public:
+    struct Parameters
+    {
+        /** Process noise: std. deviation of accelerations, in m/s^2 and
+         * rad/s^2 */
+        double accel_sigma_xyz{2.0};
+        double accel_sigma_rot{1.0};
+
+        /** Std. deviation of the relative poses from ICP [m], [rad] */
+        double meas_sigma_xyz{0.05};
+        double meas_sigma_rot{0.01};
+
+        /** Chi-squared threshold for the 6-dof Mahalanobis gate (default:
+         * 99.9%) */
+        double gate_chi2{22.46};
+
+        /** Time steps outside (0, max_dt] seconds are ignored (longer ones
+         * reset the filter, see predict()) */
+        double max_dt{1.0};
+
+        unsigned int max_consecutive_rejects{3};
+    };
+
+    void reset() { *this = TwistKalmanFilter(); }
+
+    /** True once a measurement was accepted, and until the next reset(),
+     * i.e. while twist() is a usable estimate. */
+    bool initialized() const { return initialized_; }
+
+    /** Time update: increases the uncertainty for `dt` seconds. Gaps longer
+     * than `max_dt` reset() the filter, since the twist is stale by then.
+     * Other invalid `dt` values are ignored. */
+    void predict(double dt, const Parameters& p);
+
+    /** Predicted relative pose after `dt` seconds with the current twist.
+     * Identity if not initialized or `dt` is invalid. */
+    mrpt::poses::CPose3D predictRelativePose(
+        double dt, const Parameters& p) const;
+
+    /** Measurement update with the relative pose over the last `dt` seconds.
+     * \return false if rejected (invalid `dt` or outlier) */
+    bool correct(
+        const mrpt::poses::CPose3D& rel_pose, double dt, const Parameters& p);
+
+    mrpt::math::TTwist3D twist() const;
+
+    /** Mahalanobis distance^2 of the last measurement */
+    double lastMahalanobis2() const { return last_maha2_; }
+
+   private:
+    std::array<double, 6> x_{{.0, .0, .0, .0, .0, .0}};
+    std::array<double, 6> var_{{.0, .0, .0, .0, .0, .0}};
+    bool                  initialized_{false};
+    unsigned int          consecutive_rejects_{0};
+    double                last_maha2_{.0};
+
+    static bool valid_dt(double dt, const Parameters& p)
+    {
+        return dt > 0 && dt <= p.max_dt;
+    }
+};
+
+}  // namespace mola
@@ -0,0 +1,61 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   WheelOdometryBuffer.h
+ * @brief  Time-indexed buffer of wheel odometry readings, with interpolation
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+#pragma once
+
+#include <mrpt/core/Clock.h>
+#include <mrpt/poses/CPose3D.h>
+
+#include <map>
+#include <mutex>
+#include <optional>
+
+namespace mola
+{
+/** Keeps the latest wheel odometry readings (cumulative poses in the
+ * odometry frame) and returns the odometry-based relative motion between
+ * two arbitrary timestamps, interpolating in SE(3). Thread-safe.
+ */
+class WheelOdometryBuffer
+{
+   public:
+    struct Parameters
+    {
+        /** Readings older than this wrt the newest one are discarded [s] */
+        double max_age{10.0};
+        /** Max. time to extrapolate after the newest reading [s] */
+        double max_extrapolation{0.05};
+        /** Max. time gap between the readings used to interpolate [s] */
+        double max_gap{0.5};
+    };
+
+    void add(
+        const mrpt::Clock::time_point& t, const mrpt::poses::CPose3D& pose,
+        const Parameters& p);
+
+    /** Interpolated odometry pose at `t`, if available */
+    std::optional<mrpt::poses::CPose3D> poseAt(
+        const mrpt::Clock::time_point& t, const Parameters& p) const;
+
+    /** Relative motion from `t0` to `t1`, if available */
+    std::optional<mrpt::poses::CPose3D> relativeMotion(
+        const mrpt::Clock::time_point& t0, const mrpt::Clock::time_point& t1,
+        const Parameters& p) const;
+
+    void   clear();
+    size_t size() const;
+
+   private:
+    mutable std::mutex                                      mtx_;
+    std::map<mrpt::Clock::time_point, mrpt::poses::CPose3D> readings_;
+};
+
+}  // namespace mola
@@ -0,0 +1,168 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   AlignmentHessian.cpp
+ * @brief  Analytic point-to-plane Hessian of an ICP solution
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+
+#include "AlignmentHessian.h"
+#include "PointCloudNormals.h"
+
+#include <mrpt/core/bits_math.h>
+#include <mrpt/core/exceptions.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace mola;
+
+AlignmentHessian mola::alignment_hessian(
+    const mp2p_icp::pointcloud_t& pcs_from,
+    const mp2p_icp::pointcloud_t& pcs_to,
+    const mrpt::poses::CPose3D&   to_wrt_from,
+    const AlignmentHessianParameters& p)
+{
+    MRPT_START
+
+    ASSERT_GE_(p.knn, 3U);
+
+    AlignmentHessian ret;
+    ret.H.setZero();
+
+    const double max_dist_sqr = mrpt::square(p.max_pair_distance);
+
+    std::vector<size_t> nn_idx;
+    std::vector<float>  nn_dist_sqr;
+    LocalPlaneFit       fit;
+
+    for (const auto& layer_to : pcs_to.point_layers)
+    {
+        const auto it_from = pcs_from.point_layers.find(layer_to.first);
+        if (it_from == pcs_from.point_layers.end()) continue;
+        if (!layer_to.second || !it_from->second) continue;
+
+        const auto& pts_to   = *layer_to.second;
+        const auto& pts_from = *it_from->second;
+        if (pts_to.empty() || pts_from.size() < p.knn) continue;
+
+        const auto& xs = pts_to.getPointsBufferRef_x();
+        const auto& ys = pts_to.getPointsBufferRef_y();
+        const auto& zs = pts_to.getPointsBufferRef_z();
+
+        const auto& fxs = pts_from.getPointsBufferRef_x();
+        const auto& fys = pts_from.getPointsBufferRef_y();
+        const auto& fzs = pts_from.getPointsBufferRef_z();
+
+        const size_t N     = pts_to.size();
+        const size_t decim = std::max<size_t>(
+            1, p.max_points_per_layer ? N / p.max_points_per_layer : 1);
+
+        for (size_t i = 0; i < N; i += decim)
+        {
+            // Point in the "from" frame:
+            double gx, gy, gz;
+            to_wrt_from.composePoint(xs[i], ys[i], zs[i], gx, gy, gz);
+
+            // Use the normal cached in the KF (see estimateKFNormals()) at
+            // the closest point, if any, instead of fitting a new one:
+            const mp2p_icp::plane_patch_t* cached = nullptr;
+            if (!pcs_from.planes.empty())
+            {
+                pts_from.kdTreeNClosestPoint3DIdx(
+                    gx, gy, gz, 1, nn_idx, nn_dist_sqr);
+                if (nn_idx.empty() || nn_dist_sqr[0] > max_dist_sqr)
+                    continue;
+                const size_t j = nn_idx[0];
+                cached = find_plane_patch(
+                    pcs_from.planes, fxs[j], fys[j], fzs[j]);
+            }
+
+            double nx, ny, nz, r;
+            if (cached)
+            {
+                const auto& pl = cached->plane;
+                const auto  n  = pl.getNormalVector();
+                nx             = n[0];
+                ny             = n[1];
+                nz             = n[2];
+                r = pl.evaluatePoint(mrpt::math::TPoint3D(gx, gy, gz));
+            }
+            else
+            {
+                pts_from.kdTreeNClosestPoint3DIdx(
+                    gx, gy, gz, p.knn, nn_idx, nn_dist_sqr);
+                if (nn_idx.empty() || nn_dist_sqr[0] > max_dist_sqr)
+                    continue;
+
+                // Local plane fit around the paired point:
+                if (!fit_local_plane(pts_from, nn_idx, fit)) continue;
+                nx = fit.normal.x;
+                ny = fit.normal.y;
+                nz = fit.normal.z;
+                r  = nx * (gx - fit.mean.x) + ny * (gy - fit.mean.y) +
+                    nz * (gz - fit.mean.z);
+            }
+
+            // Jacobian of the point-to-plane error, for a left-perturbation
+            // of the pose: d(n'*g) = n'*dt + (g x n)'*dw
+            const double J[6] = {nx,
+                                 ny,
+                                 nz,
+                                 gy * nz - gz * ny,
+                                 gz * nx - gx * nz,
+                                 gx * ny - gy * nx};
+
+            for (int a = 0; a < 6; a++)
+                for (int b = a; b < 6; b++) ret.H(a, b) += J[a] * J[b];
+
+            ret.sum_sq_residuals += r * r;
+            ret.num_pairings++;
+            if (cached) ret.num_cached_normals++;
+        }
+    }
+
+    for (int a = 0; a < 6; a++)
+        for (int b = 0; b < a; b++) ret.H(a, b) = ret.H(b, a);
+
+    return ret;
+
+    MRPT_END
+}
+
+mrpt::math::CMatrixDouble66 mola::alignment_information(
+    const AlignmentHessian& ah, double min_sigma)
+{
+    double var = mrpt::square(min_sigma);
+    if (ah.num_pairings > 6)
+        mrpt::keep_max(var, ah.sum_sq_residuals / (ah.num_pairings - 6));
+
+    mrpt::math::CMatrixDouble66 I = ah.H;
+    I *= 1.0 / var;
+    return I;
+}
+
+std::pair<double, double> mola::information_to_max_sigmas(
+    const mrpt::math::CMatrixDouble66& I, double min_eig)
+{
+    mrpt::math::CMatrixDouble66 eig_vecs;
+    std::vector<double>         eig_vals;
+    I.eig_symmetric(eig_vecs, eig_vals);
+
+    // diag(cov) = sum_k v_ik^2 / lambda_k
+    double max_var[2] = {.0, .0};
+    for (int i = 0; i < 6; i++)
+    {
+        double var = 0;
+        for (int k = 0; k < 6; k++)
+            var += mrpt::square(eig_vecs(i, k)) /
+                   std::max(eig_vals[k], min_eig);
+
+        mrpt::keep_max(max_var[i < 3 ? 0 : 1], var);
+    }
+    return {std::sqrt(max_var[0]), std::sqrt(max_var[1])};
+}
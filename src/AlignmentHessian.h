@@ -0,0 +1,79 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   AlignmentHessian.h
+ * @brief  Analytic point-to-plane Hessian of an ICP solution
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+#pragma once
+
+#include <mp2p_icp/pointcloud.h>
+#include <mrpt/math/CMatrixFixed.h>
+#include <mrpt/poses/CPose3D.h>
+
+#include <utility>
+
+namespace mola
+{
+struct AlignmentHessianParameters
+{
+    /** Maximum number of points (per layer) to evaluate */
+    unsigned int max_points_per_layer{300};
+
+    /** Neighbors used to estimate the normal at each paired point, if it
+     * has no cached one */
+    unsigned int knn{5};
+
+    /** Pairings farther than this are ignored [m] */
+    double max_pair_distance{1.0};
+};
+
+struct AlignmentHessian
+{
+    /** Gauss-Newton approximation J^T*J of the point-to-plane cost at the
+     * solution, in the SE(3) tangent space [x y z rx ry rz] (same ordering
+     * than mrpt::poses::Lie::SE<3>) */
+    mrpt::math::CMatrixDouble66 H;
+
+    /** Number of pairings accumulated into H */
+    size_t num_pairings{0};
+
+    /** Sum of squared point-to-plane residuals [m^2] */
+    double sum_sq_residuals{.0};
+
+    /** How many of the pairings used a normal cached in `pcs_from.planes` */
+    size_t num_cached_normals{0};
+};
+
+/** Evaluates the Hessian of the point-to-plane alignment cost for the "to"
+ * cloud placed at `to_wrt_from` with respect to the "from" cloud.
+ * Only point layers existing in both clouds are used. The normal at each
+ * paired point in the "from" cloud is taken from `pcs_from.planes` if it
+ * holds one for that point (sorted with sort_plane_patches()), or is
+ * estimated from its `knn` neighbors otherwise.
+ * It is cheap (a few hundreds of KD-tree queries) and fully analytic.
+ */
+AlignmentHessian alignment_hessian(
+    const mp2p_icp::pointcloud_t& pcs_from,
+    const mp2p_icp::pointcloud_t& pcs_to,
+    const mrpt::poses::CPose3D&   to_wrt_from,
+    const AlignmentHessianParameters& p);
+
+/** Returns the information matrix of the alignment, i.e. the Hessian scaled
+ * by the inverse of the residual variance, which is estimated from the
+ * residuals themselves but never taken below `min_sigma` [m]. */
+mrpt::math::CMatrixDouble66 alignment_information(
+    const AlignmentHessian& ah, double min_sigma);
+
+/** Marginal standard deviations of a Gaussian in the SE(3) tangent space
+ * from its information matrix, as the largest one within the translational
+ * [m] and rotational [rad] blocks, respectively. Unobservable directions
+ * (eigenvalues below `min_eig`) are assigned a variance of 1/min_eig. */
+std::pair<double, double> information_to_max_sigmas(
+    const mrpt::math::CMatrixDouble66& I, double min_eig = 1e-6);
+
+}  // namespace mola
@@ -0,0 +1,220 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   CompressedObservation.cpp
+ * @brief  Compact storage of raw observations, for later re-processing
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+
+#include <mola-fe-lidar/CompressedObservation.h>
+#include <mrpt/io/CMemoryStream.h>
+#include <mrpt/io/zip.h>
+#include <mrpt/maps/CPointsMapXYZI.h>
+#include <mrpt/maps/CSimplePointsMap.h>
+#include <mrpt/obs/CObservationPointCloud.h>
+#include <mrpt/serialization/CArchive.h>
+#include <mrpt/serialization/stl_serialization.h>
+
+#include <cmath>
+#include <cstring>
+
+using namespace mola;
+
+// arguments: class_name, parent_class, class namespace
+IMPLEMENTS_SERIALIZABLE(
+    CompressedObservation, mrpt::serialization::CSerializable, mola)
+
+namespace
+{
+std::vector<uint8_t> serialize_to_bytes(
+    const mrpt::serialization::CSerializable& o)
+{
+    mrpt::io::CMemoryStream buf;
+    auto                    arch = mrpt::serialization::archiveFrom(buf);
+    arch << o;
+
+    const auto* data = static_cast<const uint8_t*>(buf.getRawBufferData());
+    return std::vector<uint8_t>(data, data + buf.getTotalBytesCount());
+}
+
+mrpt::serialization::CSerializable::Ptr deserialize_from_bytes(
+    const std::vector<uint8_t>& bytes)
+{
+    mrpt::io::CMemoryStream buf;
+    buf.assignMemoryNotOwn(bytes.data(), bytes.size());
+    auto arch = mrpt::serialization::archiveFrom(buf);
+    return arch.ReadObject();
+}
+
+template <typename T>
+void append_pod(std::vector<uint8_t>& out, const T& v)
+{
+    const auto n = out.size();
+    out.resize(n + sizeof(T));
+    std::memcpy(out.data() + n, &v, sizeof(T));
+}
+
+template <typename T>
+T read_pod(const std::vector<uint8_t>& in, size_t& pos)
+{
+    ASSERT_LE_(pos + sizeof(T), in.size());
+    T v;
+    std::memcpy(&v, in.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return v;
+}
+}  // namespace
+
+CompressedObservation::Ptr CompressedObservation::Compress(
+    const mrpt::obs::CObservation& o, double quantization)
+{
+    MRPT_START
+
+    using namespace mrpt::maps;
+
+    auto ret = CompressedObservation::Create();
+
+    const auto* obs_pc =
+        dynamic_cast<const mrpt::obs::CObservationPointCloud*>(&o);
+    const bool quantizable =
+        quantization > 0 && obs_pc && obs_pc->pointcloud &&
+        (IS_CLASS(*obs_pc->pointcloud, CSimplePointsMap) ||
+         IS_CLASS(*obs_pc->pointcloud, CPointsMapXYZI));
+
+    std::vector<uint8_t> raw;
+    if (!quantizable)
+    {
+        ret->method_ = Method::Lossless;
+        raw          = serialize_to_bytes(o);
+    }
+    else
+    {
+        ret->method_       = Method::QuantizedPoints;
+        ret->quantization_ = quantization;
+
+        // Everything but the points goes into the header:
+        mrpt::obs::CObservationPointCloud hdr = *obs_pc;
+        hdr.pointcloud.reset();
+        ret->header_ = serialize_to_bytes(hdr);
+
+        const auto& pc      = *obs_pc->pointcloud;
+        const auto  N       = pc.size();
+        const auto* pc_xyzi = dynamic_cast<const CPointsMapXYZI*>(&pc);
+
+        ret->num_points_    = static_cast<uint32_t>(N);
+        ret->has_intensity_ = pc_xyzi != nullptr;
+
+        // Planar layout (all x, then all y...) of quantized deltas in sensor
+        // order, which are small and compress well:
+        raw.reserve(N * (3 * sizeof(int32_t) + sizeof(float)));
+        for (const auto* coords :
+             {&pc.getPointsBufferRef_x(), &pc.getPointsBufferRef_y(),
+              &pc.getPointsBufferRef_z()})
+        {
+            int32_t prev = 0;
+            for (size_t i = 0; i < N; i++)
+            {
+                const auto q = static_cast<int32_t>(
+                    std::lround((*coords)[i] / quantization));
+                append_pod<int32_t>(raw, q - prev);
+                prev = q;
+            }
+        }
+        if (pc_xyzi)
+            for (size_t i = 0; i < N; i++)
+                append_pod<float>(raw, pc_xyzi->getPointIntensity(i));
+    }
+
+    ret->payload_raw_ = raw.size();
+    mrpt::io::zip::compress(raw, ret->payload_);
+    return ret;
+
+    MRPT_END
+}
+
+mrpt::obs::CObservation::Ptr CompressedObservation::decompress() const
+{
+    MRPT_START
+
+    using namespace mrpt::maps;
+
+    std::vector<uint8_t> raw;
+    mrpt::io::zip::decompress(
+        const_cast<uint8_t*>(payload_.data()), payload_.size(), raw,
+        payload_raw_);
+    ASSERT_EQUAL_(raw.size(), payload_raw_);
+
+    if (method_ == Method::Lossless)
+        return std::dynamic_pointer_cast<mrpt::obs::CObservation>(
+            deserialize_from_bytes(raw));
+
+    auto obs = std::dynamic_pointer_cast<mrpt::obs::CObservationPointCloud>(
+        deserialize_from_bytes(header_));
+    ASSERT_(obs);
+
+    CPointsMap::Ptr pc;
+    if (has_intensity_)
+        pc = CPointsMapXYZI::Create();
+    else
+        pc = CSimplePointsMap::Create();
+
+    const size_t N = num_points_;
+    pc->resize(N);
+
+    size_t             pos = 0;
+    std::vector<float> coords[3];
+    for (auto& c : coords)
+    {
+        c.resize(N);
+        int32_t q = 0;
+        for (size_t i = 0; i < N; i++)
+        {
+            q += read_pod<int32_t>(raw, pos);
+            c[i] = static_cast<float>(q * quantization_);
+        }
+    }
+    for (size_t i = 0; i < N; i++)
+        pc->setPointFast(i, coords[0][i], coords[1][i], coords[2][i]);
+
+    if (has_intensity_)
+    {
+        auto& pc_xyzi = dynamic_cast<CPointsMapXYZI&>(*pc);
+        for (size_t i = 0; i < N; i++)
+            pc_xyzi.setPointIntensity(i, read_pod<float>(raw, pos));
+    }
+    pc->mark_as_modified();
+
+    obs->pointcloud = pc;
+    return obs;
+
+    MRPT_END
+}
+
+uint8_t CompressedObservation::serializeGetVersion() const { return 0; }
+
+void CompressedObservation::serializeTo(
+    mrpt::serialization::CArchive& out) const
+{
+    out.WriteAs<uint8_t>(method_);
+    out << quantization_ << num_points_ << has_intensity_ << header_
+        << payload_ << payload_raw_;
+}
+
+void CompressedObservation::serializeFrom(
+    mrpt::serialization::CArchive& in, uint8_t version)
+{
+    switch (version)
+    {
+        case 0:
+            method_ = static_cast<Method>(in.ReadAs<uint8_t>());
+            in >> quantization_ >> num_points_ >> has_intensity_ >> header_ >>
+                payload_ >> payload_raw_;
+            break;
+        default:
+            MRPT_THROW_UNKNOWN_SERIALIZATION_VERSION(version);
+    };
+}
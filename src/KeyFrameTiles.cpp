@@ -0,0 +1,148 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   KeyFrameTiles.cpp
+ * @brief  Spatial index of KFs in 2D tiles, with a resident tile set
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+
+#include <mola-fe-lidar/KeyFrameTiles.h>
+
+#include <cmath>
+
+using namespace mola;
+
+KeyFrameTiles::tile_key_t KeyFrameTiles::tileOf(
+    double x, double y, const Parameters& p)
+{
+    return {static_cast<int32_t>(std::floor(x / p.tile_size)),
+            static_cast<int32_t>(std::floor(y / p.tile_size))};
+}
+
+double KeyFrameTiles::distanceToTileCenter(
+    const tile_key_t& k, const mrpt::math::TPoint3D& pos, const Parameters& p)
+{
+    const double cx = (k.first + 0.5) * p.tile_size;
+    const double cy = (k.second + 0.5) * p.tile_size;
+    return std::hypot(cx - pos.x, cy - pos.y);
+}
+
+void KeyFrameTiles::insert(
+    id_t id, const mrpt::poses::CPose3D& pose, const Parameters& p)
+{
+    const auto k = tileOf(pose.x(), pose.y(), p);
+    kfs_[id]     = {pose, k};
+    tiles_[k].insert(id);
+    resident_.insert(k);
+}
+
+KeyFrameTiles::ResidencyChange KeyFrameTiles::updateResidency(
+    const mrpt::math::TPoint3D& pos, const Parameters& p)
+{
+    ResidencyChange ret;
+
+    // Only the tiles in the bounding square of the load radius may enter:
+    const auto k0 = tileOf(pos.x - p.load_radius, pos.y - p.load_radius, p);
+    const auto k1 = tileOf(pos.x + p.load_radius, pos.y + p.load_radius, p);
+
+    for (auto it = tiles_.lower_bound({k0.first, k0.second});
+         it != tiles_.end() && it->first.first <= k1.first; ++it)
+    {
+        const auto& k = it->first;
+        if (k.second < k0.second || k.second > k1.second) continue;
+        if (resident_.count(k)) continue;
+        if (distanceToTileCenter(k, pos, p) > p.load_radius) continue;
+
+        resident_.insert(k);
+        ret.load.insert(ret.load.end(), it->second.begin(), it->second.end());
+    }
+
+    // Resident tiles are few: check them all for eviction.
+    for (auto it = resident_.begin(); it != resident_.end();)
+    {
+        if (distanceToTileCenter(*it, pos, p) <= p.unload_radius)
+        {
+            ++it;
+            continue;
+        }
+        const auto& ids = tiles_[*it];
+        ret.unload.insert(ret.unload.end(), ids.begin(), ids.end());
+        it = resident_.erase(it);
+    }
+    return ret;
+}
+
+std::vector<std::pair<id_t, mrpt::poses::CPose3D>>
+    KeyFrameTiles::residentKeyFramesNear(
+        const mrpt::math::TPoint3D& pos, double radius,
+        const Parameters& p) const
+{
+    const double half_diagonal = 0.5 * std::sqrt(2.0) * p.tile_size;
+
+    std::vector<std::pair<id_t, mrpt::poses::CPose3D>> ret;
+    for (const auto& k : resident_)
+    {
+        // Skip whole tiles out of range:
+        if (distanceToTileCenter(k, pos, p) > radius + half_diagonal)
+            continue;
+
+        const auto it = tiles_.find(k);
+        if (it == tiles_.end()) continue;
+        for (const auto id : it->second)
+        {
+            const auto& pose = kfs_.at(id).pose;
+            if (pose.translation().distanceTo(pos) <= radius)
+                ret.emplace_back(id, pose);
+        }
+    }
+    return ret;
+}
+
+std::vector<std::pair<id_t, mrpt::poses::CPose3D>>
+    KeyFrameTiles::keyFramesNear(
+        const mrpt::math::TPoint3D& pos, double radius,
+        const Parameters& p) const
+{
+    const auto k0 = tileOf(pos.x - radius, pos.y - radius, p);
+    const auto k1 = tileOf(pos.x + radius, pos.y + radius, p);
+
+    std::vector<std::pair<id_t, mrpt::poses::CPose3D>> ret;
+    for (auto it = tiles_.lower_bound(k0);
+         it != tiles_.end() && it->first.first <= k1.first; ++it)
+    {
+        const auto& k = it->first;
+        if (k.second < k0.second || k.second > k1.second) continue;
+
+        for (const auto id : it->second)
+        {
+            const auto& pose = kfs_.at(id).pose;
+            if (pose.translation().distanceTo(pos) <= radius)
+                ret.emplace_back(id, pose);
+        }
+    }
+    return ret;
+}
+
+std::optional<mrpt::poses::CPose3D> KeyFrameTiles::keyFramePose(id_t id) const
+{
+    const auto it = kfs_.find(id);
+    if (it == kfs_.end()) return {};
+    return it->second.pose;
+}
+
+bool KeyFrameTiles::isResident(id_t id) const
+{
+    const auto it = kfs_.find(id);
+    return it != kfs_.end() && resident_.count(it->second.tile) != 0;
+}
+
+void KeyFrameTiles::clear()
+{
+    kfs_.clear();
+    tiles_.clear();
+    resident_.clear();
+}
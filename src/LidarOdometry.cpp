@@ -16,14 +16,27 @@
  *
  */
 
+#include <mola-fe-lidar/CompressedObservation.h>
 #include <mola-fe-lidar/LidarOdometry.h>
+#include <mola-fe-lidar/LockProfiler.h>
+#include "AlignmentHessian.h"
+#include "Matcher_Point2CachedPlane.h"
+#include "OdometryFastPath.h"
+#include "PointCloudNormals.h"
+#include "ReflectorsLayer.h"
+#include <mola-kernel/entities/entities-common.h>
 #include <mola-kernel/yaml_helpers.h>
 #include <mola-lidar-segmentation/LidarFilterBase.h>
 #include <mrpt/config/CConfigFileMemory.h>
 #include <mrpt/containers/yaml.h>
+#include <mrpt/core/bits_math.h>
 #include <mrpt/core/initializer.h>
 #include <mrpt/maps/CColouredPointsMap.h>
+#include <mrpt/maps/CPointsMap.h>
+#include <mrpt/maps/CPointsMapXYZI.h>
+#include <mrpt/maps/CSimplePointsMap.h>
 #include <mrpt/obs/CObservationComment.h>
+#include <mrpt/obs/CObservationOdometry.h>
 #include <mrpt/obs/CObservationPointCloud.h>
 #include <mrpt/obs/CRawlog.h>
 #include <mrpt/opengl/COpenGLScene.h>
@@ -37,9 +50,40 @@
 #include <mrpt/system/filesystem.h>
 #include <mrpt/system/string_utils.h>
 
+#include <algorithm>
+#include <cmath>
+
 using namespace mola;
 
 static const std::string ANNOTATION_NAME_PC_LAYERS = "lidar-pointcloud-layers";
+static const std::string ANNOTATION_NAME_RAW_OBS   = "raw-observation";
+static const std::string LAYER_NAME_REFLECTORS     = "reflectors";
+
+// Memory accounting: x,y,z,intensity floats per raw point, and rough
+// per-element overhead of std::map/std::set nodes:
+static constexpr size_t BYTES_PER_RAW_POINT = 4 * sizeof(float);
+static constexpr size_t BYTES_PER_TREE_NODE = 32;
+
+static size_t pointcloud_bytes(const mp2p_icp::pointcloud_t& pc)
+{
+    size_t n = pc.planes.size() * sizeof(mp2p_icp::plane_patch_t);
+    for (const auto& layer : pc.point_layers)
+        if (layer.second) n += layer.second->size() * 3 * sizeof(float);
+    return n;
+}
+
+// Relative weights of point layers in the fast path solvers:
+static std::map<std::string, double> fast_path_layer_weights(
+    const LidarOdometry::Parameters& p)
+{
+    if (!p.reflectors_enabled) return {};
+    return {{LAYER_NAME_REFLECTORS, p.reflectors_weight}};
+}
+
+static unsigned int default_num_icp_threads()
+{
+    return std::max(2U, std::thread::hardware_concurrency() / 2);
+}
 
 // arguments: class_name, parent_class, class namespace
 IMPLEMENTS_MRPT_OBJECT(LidarOdometry, FrontEndBase, mola)
@@ -50,11 +94,21 @@ MRPT_INITIALIZER(do_register_LidarOdometry)
     MOLA_REGISTER_MODULE(LidarOdometry);
 
     // Register serializable classes:
-    // (None)
+    mrpt::rtti::registerClass(CLASS_ID(CompressedObservation));
+
+    // Register ICP matchers:
+    mrpt::rtti::registerClass(CLASS_ID(Matcher_Point2CachedPlane));
 }
 
 LidarOdometry::LidarOdometry() = default;
 
+LidarOdometry::~LidarOdometry()
+{
+    if (params_.profile_locks && !lock_profiler_.empty())
+        MRPT_LOG_INFO_STREAM(
+            lock_profiler_.report(params_.lock_report_top_sections));
+}
+
 static void load_icp_set_of_params(
     LidarOdometry::Parameters::ICP_case& out, const mrpt::containers::yaml& cfg)
 {
@@ -88,111 +142,1485 @@ static void load_icp_set_of_params(
     out.icp->initialize_quality_evaluators(cfg["quality"]);
 }
 
-void LidarOdometry::initialize(const std::string& cfg_block)
-{
-    MRPT_TRY_START
+void LidarOdometry::loadParameters(
+    const mrpt::containers::yaml& cfg, Parameters& p,
+    lidar_segmentation::LidarFilterBase::Ptr& out_filter)
+{
+    MRPT_START
+
+    YAML_LOAD_REQ(p, min_dist_xyz_between_keyframes, double);
+    YAML_LOAD_OPT_DEG(p, min_rotation_between_keyframes, double);
+
+    YAML_LOAD_OPT(p, odometry_only, bool);
+    YAML_LOAD_OPT(p, odometry_publish_clouds, bool);
+    YAML_LOAD_OPT(p, enable_fast_path, bool);
+    YAML_LOAD_OPT(p, enable_fast_path_nearby, bool);
+    YAML_LOAD_OPT(p, twist_kf_min_goodness, double);
+    {
+        auto& tk = p.twist_kf;
+
+        tk.accel_sigma_xyz = cfg.getOrDefault<double>(
+            "twist_kf_accel_sigma_xyz", tk.accel_sigma_xyz);
+        tk.accel_sigma_rot = mrpt::DEG2RAD(cfg.getOrDefault<double>(
+            "twist_kf_accel_sigma_rot", mrpt::RAD2DEG(tk.accel_sigma_rot)));
+        tk.meas_sigma_xyz = cfg.getOrDefault<double>(
+            "twist_kf_meas_sigma_xyz", tk.meas_sigma_xyz);
+        tk.meas_sigma_rot = mrpt::DEG2RAD(cfg.getOrDefault<double>(
+            "twist_kf_meas_sigma_rot", mrpt::RAD2DEG(tk.meas_sigma_rot)));
+        tk.gate_chi2 =
+            cfg.getOrDefault<double>("twist_kf_gate_chi2", tk.gate_chi2);
+        tk.max_dt = cfg.getOrDefault<double>("twist_kf_max_dt", tk.max_dt);
+        tk.max_consecutive_rejects = cfg.getOrDefault<unsigned int>(
+            "twist_kf_max_consecutive_rejects", tk.max_consecutive_rejects);
+    }
+
+    YAML_LOAD_OPT(p, wheel_odometry_label, std::string);
+    p.wheel_odometry.max_age = cfg.getOrDefault<double>(
+        "wheel_odometry_max_age", p.wheel_odometry.max_age);
+    p.wheel_odometry.max_extrapolation = cfg.getOrDefault<double>(
+        "wheel_odometry_max_extrapolation",
+        p.wheel_odometry.max_extrapolation);
+    p.wheel_odometry.max_gap = cfg.getOrDefault<double>(
+        "wheel_odometry_max_gap", p.wheel_odometry.max_gap);
+
+    YAML_LOAD_OPT(p, multi_hypothesis_enabled, bool);
+    {
+        auto& mh = p.multi_hypothesis;
+
+        mh.max_hypotheses = cfg.getOrDefault<unsigned int>(
+            "multi_hypothesis_max_hypotheses", mh.max_hypotheses);
+        mh.spawn_offset = cfg.getOrDefault<double>(
+            "multi_hypothesis_spawn_offset", mh.spawn_offset);
+        mh.prior_sigma_xyz = cfg.getOrDefault<double>(
+            "multi_hypothesis_prior_sigma_xyz", mh.prior_sigma_xyz);
+        mh.prior_sigma_rot = mrpt::DEG2RAD(cfg.getOrDefault<double>(
+            "multi_hypothesis_prior_sigma_rot",
+            mrpt::RAD2DEG(mh.prior_sigma_rot)));
+        mh.goodness_weight = cfg.getOrDefault<double>(
+            "multi_hypothesis_goodness_weight", mh.goodness_weight);
+        mh.score_decay = cfg.getOrDefault<double>(
+            "multi_hypothesis_score_decay", mh.score_decay);
+        mh.prune_margin = cfg.getOrDefault<double>(
+            "multi_hypothesis_prune_margin", mh.prune_margin);
+        mh.merge_distance = cfg.getOrDefault<double>(
+            "multi_hypothesis_merge_distance", mh.merge_distance);
+        mh.max_ambiguous_steps = cfg.getOrDefault<unsigned int>(
+            "multi_hypothesis_max_ambiguous_steps", mh.max_ambiguous_steps);
+    }
+
+    YAML_LOAD_OPT(p, warmup_enabled, bool);
+    YAML_LOAD_OPT(p, warmup_num_points, unsigned int);
+
+    YAML_LOAD_OPT(p, watchdog_enabled, bool);
+    YAML_LOAD_OPT(p, watchdog_odometry_timeout, double);
+    YAML_LOAD_OPT(p, watchdog_past_kf_timeout, double);
+    YAML_LOAD_OPT(p, watchdog_degrade_to_odometry_only, bool);
+
+    YAML_LOAD_OPT(p, memory_budget_mb, unsigned int);
+    YAML_LOAD_OPT(p, memory_budget_hysteresis, double);
+    YAML_LOAD_OPT(p, memory_kf_decimation, unsigned int);
+
+    YAML_LOAD_OPT(p, profile_locks, bool);
+    YAML_LOAD_OPT(p, lock_report_top_sections, unsigned int);
+
+    YAML_LOAD_OPT(p, min_time_between_scans, double);
+    YAML_LOAD_OPT(p, min_icp_goodness, double);
+    YAML_LOAD_OPT(p, min_icp_goodness_lc, double);
+    YAML_LOAD_OPT(p, decimate_to_point_count, unsigned int);
+
+    YAML_LOAD_OPT(p, min_dist_to_matching, double);
+    YAML_LOAD_OPT(p, max_dist_to_matching, double);
+    YAML_LOAD_OPT(p, max_dist_to_loop_closure, double);
+    YAML_LOAD_OPT(p, max_nearby_align_checks, unsigned int);
+    YAML_LOAD_OPT(p, min_topo_dist_to_consider_loopclosure, unsigned int);
+    YAML_LOAD_OPT(p, nearby_kfs_time_budget, double);
+    YAML_LOAD_OPT(p, loop_closure_montecarlo_samples, unsigned int);
+
+    YAML_LOAD_OPT(p, degeneracy_check, bool);
+    YAML_LOAD_OPT(p, degeneracy_min_eig_xyz, double);
+    YAML_LOAD_OPT(p, degeneracy_min_eig_rot, double);
+    YAML_LOAD_OPT(p, degeneracy_max_points_per_layer, unsigned int);
+    YAML_LOAD_OPT(p, degeneracy_max_pair_distance, double);
+
+    YAML_LOAD_OPT(p, factor_noise_from_information, bool);
+    YAML_LOAD_OPT(p, factor_sigma_xyz, double);
+    YAML_LOAD_OPT_DEG(p, factor_sigma_rot, double);
+    YAML_LOAD_OPT(p, factor_sigma_xyz_min, double);
+    YAML_LOAD_OPT(p, factor_sigma_xyz_max, double);
+    YAML_LOAD_OPT_DEG(p, factor_sigma_rot_min, double);
+    YAML_LOAD_OPT_DEG(p, factor_sigma_rot_max, double);
+    YAML_LOAD_OPT(p, icp_residual_min_sigma, double);
+
+    YAML_LOAD_OPT(p, pcm_enabled, bool);
+    YAML_LOAD_OPT(p, pcm_batch_size, unsigned int);
+    YAML_LOAD_OPT(p, pcm_max_wait, double);
+    p.pcm.max_error_xyz = cfg.getOrDefault<double>(
+        "pcm_max_error_xyz", p.pcm.max_error_xyz);
+    p.pcm.max_error_rot = mrpt::DEG2RAD(cfg.getOrDefault<double>(
+        "pcm_max_error_rot", mrpt::RAD2DEG(p.pcm.max_error_rot)));
+    p.pcm.min_clique_size = cfg.getOrDefault<unsigned int>(
+        "pcm_min_clique_size", p.pcm.min_clique_size);
+
+    YAML_LOAD_OPT(p, viz_decor_decimation, int);
+    YAML_LOAD_OPT(p, viz_decor_pointsize, float);
+
+    ENSURE_YAML_ENTRY_EXISTS(cfg, "icp_settings_with_vel");
+    load_icp_set_of_params(
+        p.icp[AlignKind::LidarOdometry], cfg["icp_settings_with_vel"]);
+    load_icp_set_of_params(
+        p.icp[AlignKind::NearbyAlign], cfg["icp_settings_without_vel"]);
+    load_icp_set_of_params(
+        p.icp[AlignKind::LoopClosure], cfg["icp_settings_loop_closure"]);
+
+    YAML_LOAD_OPT(p, kf_store_raw_observations, bool);
+    YAML_LOAD_OPT(p, kf_raw_obs_quantization, double);
+    YAML_LOAD_OPT(p, kf_raw_obs_unload, bool);
+
+    YAML_LOAD_OPT(p, kf_tiles_enabled, bool);
+    p.kf_tiles.tile_size =
+        cfg.getOrDefault<double>("kf_tiles_size", p.kf_tiles.tile_size);
+    p.kf_tiles.load_radius = cfg.getOrDefault<double>(
+        "kf_tiles_load_radius", p.kf_tiles.load_radius);
+    p.kf_tiles.unload_radius = cfg.getOrDefault<double>(
+        "kf_tiles_unload_radius", p.kf_tiles.unload_radius);
+    YAML_LOAD_OPT(p, kf_prefetch_enabled, bool);
+    YAML_LOAD_OPT(p, kf_prefetch_horizon, double);
+    YAML_LOAD_OPT(p, kf_prefetch_samples, unsigned int);
+    YAML_LOAD_OPT(p, kf_prefetch_max_per_scan, unsigned int);
+
+    YAML_LOAD_OPT(p, global_map_enabled, bool);
+    YAML_LOAD_OPT(p, global_map_layers, std::string);
+    YAML_LOAD_OPT(p, global_map_max_pose_refresh, unsigned int);
+    {
+        auto& gm = p.global_map;
+
+        gm.voxel_size =
+            cfg.getOrDefault<double>("global_map_voxel_size", gm.voxel_size);
+        gm.tile_size =
+            cfg.getOrDefault<double>("global_map_tile_size", gm.tile_size);
+        gm.pose_tolerance_xyz = cfg.getOrDefault<double>(
+            "global_map_pose_tolerance_xyz", gm.pose_tolerance_xyz);
+        gm.pose_tolerance_rot = mrpt::DEG2RAD(cfg.getOrDefault<double>(
+            "global_map_pose_tolerance_rot",
+            mrpt::RAD2DEG(gm.pose_tolerance_rot)));
+    }
+    YAML_LOAD_OPT(p, kf_compute_normals, bool);
+    YAML_LOAD_OPT(p, kf_normals_knn, unsigned int);
+    YAML_LOAD_OPT(p, kf_normals_decimation, unsigned int);
+    YAML_LOAD_OPT(p, kf_normals_max_e0_e1, double);
+    YAML_LOAD_OPT(p, kf_normals_layers, std::string);
+
+    YAML_LOAD_OPT(p, reflectors_enabled, bool);
+    YAML_LOAD_OPT(p, reflectors_min_intensity, double);
+    YAML_LOAD_OPT(p, reflectors_max_range, double);
+    YAML_LOAD_OPT(p, reflectors_voxel_size, double);
+    YAML_LOAD_OPT(p, reflectors_max_points, unsigned int);
+    YAML_LOAD_OPT(p, reflectors_weight, double);
+
+    YAML_LOAD_OPT(p, debug_save_lidar_odometry, bool);
+    YAML_LOAD_OPT(p, debug_save_extra_edges, bool);
+    YAML_LOAD_OPT(p, debug_save_loop_closures, bool);
+
+    // Create lidar segmentation algorithm:
+    {
+        std::string pointcloud_filter_class;
+        YAML_LOAD_REQ(pointcloud_filter_class, std::string);
+
+        ENSURE_YAML_ENTRY_EXISTS(cfg, "pointcloud_filter_params");
+        auto pc_params = cfg["pointcloud_filter_params"];
+
+        // Class factory:
+        auto ptrNew = mrpt::rtti::classFactory(pointcloud_filter_class);
+        out_filter =
+            mrpt::ptr_cast<lidar_segmentation::LidarFilterBase>::from(ptrNew);
+
+        if (!out_filter)
+            THROW_EXCEPTION_FMT(
+                "pointcloud_filter_class=`%s` is a non-registered or "
+                "incompatible class. Please, run: "
+                "`mola-cli --rtti-children-of "
+                "mola::lidar_segmentation::LidarFilterBase`"
+                "to see the list of known classes.",
+                pointcloud_filter_class.c_str());
+
+        // Same verbosity level:
+        out_filter->setMinLoggingLevel(this->getMinLoggingLevel());
+
+        // Initialize with YAML-based parameters:
+        out_filter->initialize(mola::yaml2string(pc_params));
+    }
+
+    MRPT_END
+}
+
+void LidarOdometry::validateParameters(const Parameters& p)
+{
+    MRPT_START
+
+    ASSERT_GE_(p.min_time_between_scans, .0);
+    ASSERT_GT_(p.min_dist_xyz_between_keyframes, .0);
+    ASSERT_(p.min_icp_goodness >= .0 && p.min_icp_goodness <= 1.0);
+    ASSERT_(p.min_icp_goodness_lc >= .0 && p.min_icp_goodness_lc <= 1.0);
+    ASSERT_LE_(p.min_dist_to_matching, p.max_dist_to_matching);
+    ASSERT_GE_(p.max_nearby_align_checks, 1U);
+    ASSERT_GE_(p.nearby_kfs_time_budget, .0);
+    ASSERT_GE_(p.pcm_batch_size, 1U);
+    ASSERT_GT_(p.watchdog_odometry_timeout, .0);
+    ASSERT_GT_(p.twist_kf.max_dt, .0);
+    ASSERT_GT_(p.twist_kf.meas_sigma_xyz, .0);
+    ASSERT_GT_(p.twist_kf.meas_sigma_rot, .0);
+    ASSERT_GT_(p.watchdog_past_kf_timeout, .0);
+    ASSERT_(
+        p.memory_budget_hysteresis > .0 && p.memory_budget_hysteresis < 1.0);
+    ASSERT_GE_(p.kf_raw_obs_quantization, .0);
+    if (p.kf_tiles_enabled || p.kf_prefetch_enabled)
+    {
+        ASSERT_GT_(p.kf_tiles.tile_size, .0);
+        ASSERT_GE_(p.kf_tiles.unload_radius, p.kf_tiles.load_radius);
+    }
+    if (p.kf_prefetch_enabled)
+    {
+        ASSERT_GE_(p.kf_prefetch_horizon, .0);
+        ASSERT_GE_(p.kf_prefetch_samples, 1U);
+    }
+    if (p.global_map_enabled)
+    {
+        ASSERT_GT_(p.global_map.voxel_size, .0);
+        ASSERT_GT_(p.global_map.tile_size, p.global_map.voxel_size);
+    }
+    ASSERT_LE_(p.factor_sigma_xyz_min, p.factor_sigma_xyz_max);
+    ASSERT_LE_(p.factor_sigma_rot_min, p.factor_sigma_rot_max);
+    if (p.multi_hypothesis_enabled)
+    {
+        ASSERTMSG_(
+            p.degeneracy_check,
+            "multi_hypothesis_enabled requires degeneracy_check");
+        ASSERT_GE_(p.multi_hypothesis.max_hypotheses, 1U);
+        ASSERT_GT_(p.multi_hypothesis.prior_sigma_xyz, .0);
+        ASSERT_GT_(p.multi_hypothesis.prior_sigma_rot, .0);
+        ASSERT_(
+            p.multi_hypothesis.score_decay > .0 &&
+            p.multi_hypothesis.score_decay <= 1.0);
+    }
+    if (p.kf_compute_normals)
+    {
+        ASSERT_GE_(p.kf_normals_knn, 3U);
+        ASSERT_GE_(p.kf_normals_decimation, 1U);
+    }
+    if (p.reflectors_enabled)
+    {
+        ASSERT_GT_(p.reflectors_voxel_size, .0);
+        ASSERT_GE_(p.reflectors_max_points, 1U);
+        ASSERT_GE_(p.reflectors_weight, .0);
+    }
+
+    for (const auto kind : {AlignKind::LidarOdometry, AlignKind::NearbyAlign,
+                            AlignKind::LoopClosure})
+    {
+        ASSERTMSG_(
+            p.icp.count(kind) != 0 && p.icp.at(kind).icp,
+            "Missing ICP settings");
+    }
+
+    MRPT_END
+}
+
+void LidarOdometry::initialize(const std::string& cfg_block)
+{
+    MRPT_TRY_START
+
+    // Load params:
+    auto c   = mrpt::containers::yaml::FromText(cfg_block);
+    auto cfg = c["params"];
+    MRPT_LOG_DEBUG_STREAM("Loading these params:\n" << cfg);
+
+    {
+        ProfilerEntry tle(profiler_, "filterPointCloud_initialize");
+        loadParameters(cfg, params_, state_.pc_filter);
+    }
+    validateParameters(params_);
+    lc_verifier_.params    = params_.pcm;
+    lock_profiler_.enabled = params_.profile_locks;
+    watchdog_.setThreshold("odometry", params_.watchdog_odometry_timeout);
+    watchdog_.setThreshold("past_KFs", params_.watchdog_past_kf_timeout);
+
+    if (params_.enable_fast_path)
+    {
+        const auto weights = fast_path_layer_weights(params_);
+
+        state_.fast_path = create_odometry_fast_path(
+            state_.pc_filter, cfg["icp_settings_with_vel"], weights);
+        if (params_.enable_fast_path_nearby)
+            state_.fast_path_nearby = create_odometry_fast_path(
+                state_.pc_filter, cfg["icp_settings_without_vel"], weights);
+    }
+    if (state_.fast_path)
+        MRPT_LOG_INFO_STREAM(
+            "Using odometry fast path: " << state_.fast_path->name());
+    else
+        MRPT_LOG_INFO("Using the generic odometry pipeline.");
+    if (!state_.fast_path && params_.reflectors_enabled &&
+        params_.reflectors_weight != 1.0)
+        MRPT_LOG_WARN(
+            "`reflectors_weight` is ignored: the odometry ICP settings do "
+            "not match the fast path (see icp-settings-fast.yaml).");
+    if (state_.fast_path_nearby)
+        MRPT_LOG_INFO_STREAM(
+            "Using NearbyAlign fast path: "
+            << state_.fast_path_nearby->name());
+
+    {
+        auto ps              = std::make_shared<ParameterSet>();
+        ps->params           = params_;
+        ps->pc_filter        = state_.pc_filter;
+        ps->fast_path        = state_.fast_path;
+        ps->fast_path_nearby = state_.fast_path_nearby;
+
+        MOLA_PROFILED_LOCK(
+            lck, lock_profiler_, params_swap_mtx_, "params_swap_mtx_");
+        active_params_ = std::move(ps);
+    }
+
+    // No past KFs to check against in odometry-only mode:
+    auto numICPThreads = default_num_icp_threads();
+    if (params_.kf_compute_normals) worker_pool_normals_.resize(numICPThreads);
+    if (params_.odometry_only) numICPThreads = 1;
+    worker_pool_past_KFs_.resize(numICPThreads);
+    MRPT_LOG_INFO_STREAM(
+        "Number of ICP working threads: " << numICPThreads
+                                          << " (determined automatically)");
+
+    // attach to world model, if present (else, keep the one given to
+    // attachOfflineServices(), if any):
+    auto wms = findService<WorldModel>();
+    if (wms.size() == 1)
+        worldmodel_ = std::dynamic_pointer_cast<WorldModel>(wms[0]);
+
+    if (params_.warmup_enabled) warmUp();
+
+    MRPT_TRY_END
+}
+
+// Synthetic lidar scan from the center of a box-shaped room, with `nRings`
+// rings of `nPerRing` points each:
+static mrpt::obs::CObservationPointCloud::Ptr make_warmup_scan(
+    size_t num_points, const mrpt::poses::CPose3D& sensor_pose)
+{
+    const size_t nRings   = 16;
+    const size_t nPerRing = std::max<size_t>(num_points / nRings, 36);
+
+    const double half_x = 12.0, half_y = 7.0, floor_z = -1.7, ceil_z = 3.0;
+
+    auto pc = mrpt::maps::CPointsMapXYZI::Create();
+    pc->reserve(nRings * nPerRing);
+
+    for (size_t r = 0; r < nRings; r++)
+    {
+        const double el = mrpt::DEG2RAD(-15.0 + 30.0 * r / (nRings - 1));
+        for (size_t i = 0; i < nPerRing; i++)
+        {
+            const double az = 2 * M_PI * i / nPerRing;
+            const double dx = std::cos(el) * std::cos(az);
+            const double dy = std::cos(el) * std::sin(az);
+            const double dz = std::sin(el);
+
+            // Ray-box intersection, from inside the box:
+            double t = std::numeric_limits<double>::max();
+            if (std::abs(dx) > 1e-6) t = std::min(t, half_x / std::abs(dx));
+            if (std::abs(dy) > 1e-6) t = std::min(t, half_y / std::abs(dy));
+            if (dz < -1e-6) t = std::min(t, floor_z / dz);
+            if (dz > 1e-6) t = std::min(t, ceil_z / dz);
+
+            pc->insertPoint(t * dx, t * dy, t * dz);
+        }
+    }
+    pc->changeCoordinatesReference(sensor_pose);
+
+    auto obs         = mrpt::obs::CObservationPointCloud::Create();
+    obs->pointcloud  = pc;
+    obs->sensorLabel = "warmup";
+    obs->timestamp   = mrpt::Clock::now();
+    return obs;
+}
+
+void LidarOdometry::warmUp()
+{
+    MRPT_START
+
+    ProfilerEntry tle(profiler_, "warmUp");
+    const auto    t0 = std::chrono::steady_clock::now();
+
+    // Spin up all worker threads:
+    {
+        std::vector<std::future<void>> futs;
+        futs.emplace_back(worker_pool_.enqueue([]() {}));
+        futs.emplace_back(worker_pool_backend_replies_.enqueue([]() {}));
+        futs.emplace_back(worker_pool_compress_.enqueue([]() {}));
+        futs.emplace_back(worker_pool_spill_.enqueue([]() {}));
+        futs.emplace_back(worker_pool_global_map_.enqueue([]() {}));
+        for (size_t i = 0; i < worker_pool_normals_.size(); i++)
+            futs.emplace_back(worker_pool_normals_.enqueue([]() {}));
+        for (size_t i = 0; i < worker_pool_past_KFs_.size(); i++)
+            futs.emplace_back(worker_pool_past_KFs_.enqueue([]() {}));
+        for (auto& f : futs) f.get();
+    }
+
+    // Preallocate the edge logs for the edges of a few KFs between merges
+    // (one odometry edge plus the nearby checks, per KF):
+    {
+        const size_t n = 4 * (1 + params_.max_nearby_align_checks);
+        local_pose_graph_log_.reserve(n);
+        local_pose_graph_log_merged_.reserve(n);
+    }
+
+    // Run two synthetic scans through the filter and every ICP pipeline,
+    // so all lazy allocations (matchers, solvers, KD-trees...) happen now:
+    warming_up_ = true;
+
+    std::array<mp2p_icp::pointcloud_t::Ptr, 2> pcs;
+    for (size_t i = 0; i < pcs.size(); i++)
+    {
+        mrpt::obs::CObservation::Ptr o = make_warmup_scan(
+            params_.warmup_num_points,
+            mrpt::poses::CPose3D(0.2 * i, 0, 0, mrpt::DEG2RAD(1.0 * i), 0, 0));
+
+        pcs[i] = mp2p_icp::pointcloud_t::Create();
+        if (state_.fast_path)
+            state_.fast_path->filter(o, *pcs[i]);
+        else
+            state_.pc_filter->filter(o, *pcs[i]);
+        if (params_.reflectors_enabled) addReflectorsLayer(*o, *pcs[i]);
+    }
+    if (params_.kf_compute_normals) estimateKFNormals(*pcs[0]);
+
+    for (const auto kind : {AlignKind::LidarOdometry, AlignKind::NearbyAlign,
+                            AlignKind::LoopClosure})
+    {
+        ICP_Input in;
+        in.align_kind = kind;
+        in.from_id    = 0;
+        in.to_id      = 1;
+        in.from_pc    = pcs[0];
+        in.to_pc      = pcs[1];
+        in.icp_params = params_.icp.at(kind).icpParameters;
+        in.debug_str  = "warmup";
+
+        ICP_Output out;
+        run_one_icp(in, out);
+    }
+
+    warming_up_ = false;
+
+    MRPT_LOG_INFO_FMT(
+        "Warm-up done in %.03f s",
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - t0)
+            .count());
+
+    MRPT_END
+}
+
+std::future<bool> LidarOdometry::saveMapSnapshot(const std::string& file)
+{
+    auto done = std::make_shared<std::promise<bool>>();
+    auto ret  = done->get_future();
+
+    // In the odometry thread, so state_ is not modified meanwhile, only
+    // take the list of KFs. Their clouds are not touched here:
+    worker_pool_.enqueue([this, file, done]() {
+        if (!worldmodel_)
+        {
+            MRPT_LOG_ERROR(
+                "saveMapSnapshot: no world model (odometry-only mode?)");
+            done->set_value(false);
+            return;
+        }
+
+        auto snap = std::make_shared<MapSnapshot>();
+        auto pcs  = std::make_shared<std::vector<LazyLoadResource>>();
+        try
+        {
+            WorldModelEntitiesReadLock wm_lock{*worldmodel_};
+            MOLA_PROFILED_LOCK(
+                lck, lock_profiler_, wm_lock, "worldmodel.entities.read");
+
+            for (const auto& kv : state_.kf_cloud_bytes)
+            {
+                const auto& anns = worldmodel_->entity_annotations_by_id(
+                    kv.first);
+                const auto it = anns.find(ANNOTATION_NAME_PC_LAYERS);
+                if (it == anns.end()) continue;
+
+                MapSnapshot::KeyFrame kf;
+                kf.id   = kv.first;
+                kf.pose = mrpt::poses::CPose3D(
+                    entity_get_pose(worldmodel_->entity_by_id(kf.id)));
+                snap->keyframes.push_back(std::move(kf));
+                // A copy of the handle: loading it below does not bring
+                // unloaded clouds back into the world model, so the memory
+                // budget accounting stays valid.
+                pcs->push_back(it->second);
+            }
+        }
+        catch (const std::exception& e)
+        {
+            MRPT_LOG_ERROR_STREAM(
+                "saveMapSnapshot: error listing KFs:\n"
+                << mrpt::exception_to_str(e));
+            done->set_value(false);
+            return;
+        }
+
+        // Disk I/O and descriptors in the spill thread, without locks, and
+        // never concurrently with a spill of the same clouds:
+        worker_pool_spill_.enqueue([this, file, done, snap, pcs]() {
+            try
+            {
+                ProfilerEntry tle(profiler_, "saveMapSnapshot");
+
+                auto& kfs = snap->keyframes;
+                for (size_t i = 0; i < kfs.size(); i++)
+                {
+                    kfs[i].pc = mrpt::ptr_cast<mp2p_icp::pointcloud_t>::from(
+                        (*pcs)[i].value());
+                    (*pcs)[i] = {};  // Free it as soon as possible
+                    if (!kfs[i].pc) continue;
+
+                    kfs[i].descriptor =
+                        PlaceDescriptor::FromPointCloud(*kfs[i].pc);
+                }
+                kfs.erase(
+                    std::remove_if(
+                        kfs.begin(), kfs.end(),
+                        [](const MapSnapshot::KeyFrame& kf) { return !kf.pc; }),
+                    kfs.end());
+                snap->save(file);
+
+                MRPT_LOG_INFO_STREAM(
+                    "saveMapSnapshot: " << kfs.size() << " KFs written to `"
+                                        << file << "`");
+                done->set_value(true);
+            }
+            catch (const std::exception& e)
+            {
+                MRPT_LOG_ERROR_STREAM(
+                    "saveMapSnapshot: error writing `"
+                    << file << "`:\n"
+                    << mrpt::exception_to_str(e));
+                done->set_value(false);
+            }
+        });
+    });
+    return ret;
+}
+
+std::future<bool> LidarOdometry::reloadParameters(const std::string& cfg_block)
+{
+    // Parsing, class factories and validation happen off the odometry
+    // thread; the swap itself is done by applyPendingParameters():
+    return worker_pool_reload_.enqueue([this, cfg_block]() {
+        try
+        {
+            ProfilerEntry tle(profiler_, "reloadParameters");
+
+            auto c   = mrpt::containers::yaml::FromText(cfg_block);
+            auto cfg = c["params"];
+
+            auto pending = std::make_shared<ParameterSet>();
+            // Start from the current ones, so missing optional entries keep
+            // their current values instead of the defaults:
+            pending->params = activeParameters()->params;
+            loadParameters(cfg, pending->params, pending->pc_filter);
+            validateParameters(pending->params);
+            if (pending->params.enable_fast_path)
+            {
+                const auto weights = fast_path_layer_weights(pending->params);
+
+                pending->fast_path = create_odometry_fast_path(
+                    pending->pc_filter, cfg["icp_settings_with_vel"], weights);
+                if (pending->params.enable_fast_path_nearby)
+                    pending->fast_path_nearby = create_odometry_fast_path(
+                        pending->pc_filter, cfg["icp_settings_without_vel"],
+                        weights);
+            }
+
+            {
+                MOLA_PROFILED_LOCK(
+                    lck, lock_profiler_, params_swap_mtx_, "params_swap_mtx_");
+                pending_params_ = std::move(pending);
+            }
+            MRPT_LOG_INFO("reloadParameters: new parameters validated.");
+            return true;
+        }
+        catch (const std::exception& e)
+        {
+            MRPT_LOG_ERROR_STREAM(
+                "reloadParameters: rejected, keeping the old parameters:\n"
+                << mrpt::exception_to_str(e));
+            return false;
+        }
+    });
+}
+
+std::shared_ptr<const LidarOdometry::ParameterSet>
+    LidarOdometry::activeParameters() const
+{
+    MOLA_PROFILED_LOCK(
+        lck, lock_profiler_, params_swap_mtx_, "params_swap_mtx_");
+    ASSERTMSG_(active_params_, "initialize() was not called");
+    return active_params_;
+}
+
+void LidarOdometry::applyPendingParameters()
+{
+    MOLA_PROFILED_LOCK(
+        lck, lock_profiler_, params_swap_mtx_, "params_swap_mtx_");
+    if (!pending_params_) return;
+
+    ProfilerEntry tle(profiler_, "applyPendingParameters");
+
+    // Queued past-KF tasks keep the old set alive until they end:
+    params_                 = pending_params_->params;
+    state_.pc_filter        = pending_params_->pc_filter;
+    state_.fast_path        = pending_params_->fast_path;
+    state_.fast_path_nearby = pending_params_->fast_path_nearby;
+    active_params_          = std::move(pending_params_);
+
+    state_.pc_filter->setMinLoggingLevel(this->getMinLoggingLevel());
+    lock_profiler_.enabled = params_.profile_locks;
+
+    // Normals may have just been enabled. No normals task is running now,
+    // they are only run (and waited for) from this same odometry thread:
+    if (params_.kf_compute_normals && worker_pool_normals_.size() < 2)
+        worker_pool_normals_.resize(default_num_icp_threads());
+
+    watchdog_.setThreshold("odometry", params_.watchdog_odometry_timeout);
+    watchdog_.setThreshold("past_KFs", params_.watchdog_past_kf_timeout);
+    {
+        MOLA_PROFILED_LOCK(
+            lck2, lock_profiler_, lc_verifier_mtx_, "lc_verifier_mtx_");
+        lc_verifier_.params = params_.pcm;
+    }
+
+    MRPT_LOG_INFO("New parameters applied.");
+}
+
+void LidarOdometry::enqueuePastKFTask(
+    std::function<void(const ParameterSet&)> task)
+{
+    auto ps = activeParameters();
+
+    past_KF_tasks_in_flight_++;
+    profiler_.registerUserMeasure(
+        "past_KFs.tasks_in_flight",
+        static_cast<double>(past_KF_tasks_in_flight_));
+
+    worker_pool_past_KFs_.enqueue([this, task, ps]() {
+        // Decremented even if the task throws:
+        struct InFlightGuard
+        {
+            std::atomic<int>& n;
+            ~InFlightGuard() { n--; }
+        } in_flight{past_KF_tasks_in_flight_};
+
+        StallWatchdog::Scope wds(watchdog_, "past_KFs", "past_KF_task");
+        task(*ps);
+    });
+}
+
+void LidarOdometry::storeRawObservation(
+    id_t kf_id, const CObservation::Ptr& o)
+{
+    const double quantization = params_.kf_raw_obs_quantization;
+    const bool   unload       = params_.kf_raw_obs_unload;
+
+    worker_pool_compress_.enqueue([this, kf_id, o, quantization, unload]() {
+        try
+        {
+            ProfilerEntry tle(profiler_, "storeRawObservation");
+
+            const auto c = CompressedObservation::Compress(*o, quantization);
+
+            profiler_.registerUserMeasure(
+                "storeRawObservation.compressed_kb",
+                c->compressedBytes() / 1024.0);
+            profiler_.registerUserMeasure(
+                "storeRawObservation.ratio",
+                static_cast<double>(c->uncompressedBytes()) /
+                    std::max<size_t>(1, c->compressedBytes()));
+
+            WorldModelEntitiesWriteLock wm_lock{*worldmodel_};
+            MOLA_PROFILED_LOCK(
+                lck, lock_profiler_, wm_lock, "worldmodel.entities.write");
+
+            auto& anns = worldmodel_->entity_annotations_by_id(kf_id);
+            anns.erase(ANNOTATION_NAME_RAW_OBS);
+            const auto ins = anns.emplace(
+                std::piecewise_construct,
+                std::forward_as_tuple(ANNOTATION_NAME_RAW_OBS),
+                std::forward_as_tuple(c, ANNOTATION_NAME_RAW_OBS));
+
+            // Move it to the out-of-core store right away:
+            if (unload) ins.first->second.unload();
+        }
+        catch (const std::exception& e)
+        {
+            MRPT_LOG_ERROR_STREAM(
+                "Error storing raw observation of KF #"
+                << kf_id << ":\n"
+                << mrpt::exception_to_str(e));
+        }
+    });
+}
+
+void LidarOdometry::enterDegradedMode(
+    const std::string& reason, const Parameters& p,
+    ProposedKeyFrame pending_kf)
+{
+    if (!p.watchdog_degrade_to_odometry_only) return;
+
+    MOLA_PROFILED_LOCK(lck, lock_profiler_, degraded_mtx_, "degraded_mtx_");
+    if (pending_kf.reply.valid()) degraded_pending_kf_ = std::move(pending_kf);
+    if (degraded_) return;
+
+    degraded_since_ = std::chrono::steady_clock::now();
+    degraded_       = true;
+
+    profiler_.registerUserMeasure("watchdog.degraded_mode", 1);
+    MRPT_LOG_ERROR_STREAM(
+        "Entering degraded (odometry-only) mode, no KFs will be created "
+        "until the cause is gone. Reason: "
+        << reason);
+}
+
+void LidarOdometry::checkDegradedModeRecovery(const Parameters& p)
+{
+    if (!degraded_) return;
+
+    MOLA_PROFILED_LOCK(lck, lock_profiler_, degraded_mtx_, "degraded_mtx_");
+
+    // Do not flap between modes:
+    const double since = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - degraded_since_)
+                             .count();
+    if (since < p.watchdog_odometry_timeout) return;
+
+    if (watchdog_.stalledTasks("odometry") != 0) return;
+
+    // Wait until the odometry thread attached the KF the back-end did not
+    // reply to in time (see attachLateKeyFrame()):
+    if (degraded_pending_kf_.reply.valid()) return;
+
+    degraded_ = false;
+    profiler_.registerUserMeasure("watchdog.degraded_mode", 0);
+    MRPT_LOG_WARN_FMT(
+        "Leaving degraded (odometry-only) mode after %.02f s.", since);
+}
+
+LidarOdometry::MemoryUsage LidarOdometry::computeMemoryUsage() const
+{
+    MemoryUsage mu;
+    for (const auto& kv : state_.kf_cloud_bytes) mu.kf_clouds += kv.second;
+    for (const auto& kv : state_.kf_decor_bytes) mu.decorations += kv.second;
+
+    mu.checked_KF_pairs =
+        state_.local_pose_graph.checked_KF_pairs.size() *
+        (sizeof(std::pair<id_t, id_t>) + BYTES_PER_TREE_NODE);
+
+    const auto& lpg = state_.local_pose_graph.graph;
+    mu.local_graph =
+        (lpg.nodes.size() + lpg.edges.size()) *
+        (sizeof(mrpt::poses::CPose3D) + sizeof(id_t) * 2 + BYTES_PER_TREE_NODE);
+
+    mu.queued_observations =
+        (worker_pool_.pendingTasks() + worker_pool_compress_.pendingTasks()) *
+        state_.last_obs_bytes;
+    mu.global_map = global_map_.memoryBytes();
+    return mu;
+}
+
+void LidarOdometry::enforceMemoryBudget()
+{
+    ProfilerEntry tle(profiler_, "enforceMemoryBudget");
+
+    const auto mu = computeMemoryUsage();
+    {
+        std::lock_guard<std::mutex> lck(memory_usage_mtx_);
+        memory_usage_ = mu;
+    }
+
+    const double MiB = 1.0 / (1024.0 * 1024.0);
+    profiler_.registerUserMeasure("memory.kf_clouds_MiB", mu.kf_clouds * MiB);
+    profiler_.registerUserMeasure(
+        "memory.decorations_MiB", mu.decorations * MiB);
+    profiler_.registerUserMeasure(
+        "memory.checked_KF_pairs_MiB", mu.checked_KF_pairs * MiB);
+    profiler_.registerUserMeasure(
+        "memory.local_graph_MiB", mu.local_graph * MiB);
+    profiler_.registerUserMeasure(
+        "memory.queued_observations_MiB", mu.queued_observations * MiB);
+    profiler_.registerUserMeasure("memory.total_MiB", mu.total() * MiB);
+
+    const double total_mb   = mu.total() * MiB;
+    const int    prev_level = state_.memory_pressure_level;
+    auto&        level      = state_.memory_pressure_level;
+
+    if (params_.memory_budget_mb == 0 ||
+        total_mb <= params_.memory_budget_hysteresis * params_.memory_budget_mb)
+    {
+        // Well below budget: relax one step each time we get here:
+        if (level > 0) level--;
+    }
+    else if (total_mb > params_.memory_budget_mb)
+    {
+        // Over budget: escalate one more step each time we get here:
+        if (level < 4) level++;
+
+        MRPT_LOG_THROTTLE_WARN_FMT(
+            5.0, "Memory budget exceeded (%.01f > %u MiB): pressure level=%i",
+            total_mb, params_.memory_budget_mb, level);
+    }
+    profiler_.registerUserMeasure("memory.pressure_level", level);
+
+    // Actions are taken once per level change, not on every scan:
+    if (level == prev_level) return;
+
+    if (level < prev_level)
+    {
+        // New KFs get decorations again at level 0. Already decimated or
+        // unloaded clouds are left as they are.
+        if (prev_level == 4)
+        {
+            state_.local_graph_max_kfs = std::numeric_limits<size_t>::max();
+            MRPT_LOG_INFO("Memory budget: local graph size restored.");
+        }
+        return;
+    }
+
+    if (!worldmodel_) return;  // only KF-related actions below
+
+    switch (level)
+    {
+        case 1:
+            memoryDropDecorations();
+            break;
+        case 2:
+            memoryDecimateKFClouds();
+            break;
+        case 3:
+            memoryUnloadKFClouds();
+            break;
+        case 4:
+            memoryEvictLocalGraph();
+            break;
+    };
+}
+
+void LidarOdometry::memoryDropDecorations()
+{
+    if (state_.kf_decor_bytes.empty()) return;
+
+    WorldModelEntitiesWriteLock wm_lock{*worldmodel_};
+    MOLA_PROFILED_LOCK(
+        lck, lock_profiler_, wm_lock, "worldmodel.entities.write");
+
+    for (const auto& kv : state_.kf_decor_bytes)
+        worldmodel_->entity_annotations_by_id(kv.first).erase(
+            "render_decoration");
+    state_.kf_decor_bytes.clear();
+}
+
+void LidarOdometry::memoryDecimateKFClouds()
+{
+    const size_t decim = std::max(2U, params_.memory_kf_decimation);
+
+    // The bookkeeping is updated right away, with the expected sizes:
+    std::vector<id_t> to_decimate;
+    for (auto& kv : state_.kf_cloud_bytes)
+    {
+        const auto id = kv.first;
+        if (state_.kf_decimated.count(id) || state_.kf_unloaded.count(id))
+            continue;
+
+        kv.second /= decim;
+        state_.kf_decimated.insert(id);
+        to_decimate.push_back(id);
+    }
+    if (to_decimate.empty()) return;
+
+    // Off the odometry thread, in the same one than spills, so a KF is
+    // never spilled while being decimated:
+    worker_pool_spill_.enqueue([this, to_decimate, decim]() {
+        try
+        {
+            ProfilerEntry tle(profiler_, "memoryDecimateKFClouds");
+
+            for (const auto id : to_decimate)
+            {
+                mp2p_icp::pointcloud_t::Ptr pc;
+                {
+                    WorldModelEntitiesReadLock wm_lock{*worldmodel_};
+                    MOLA_PROFILED_LOCK(
+                        lck, lock_profiler_, wm_lock,
+                        "worldmodel.entities.read");
+
+                    auto& anns = worldmodel_->entity_annotations_by_id(id);
+                    auto  it   = anns.find(ANNOTATION_NAME_PC_LAYERS);
+                    if (it == anns.end()) continue;
+
+                    pc = mrpt::ptr_cast<mp2p_icp::pointcloud_t>::from(
+                        it->second.value());
+                }
+                if (!pc) continue;
+
+                // Never modify the original: other threads may be using it.
+                auto new_pc = mp2p_icp::pointcloud_t::Create();
+                *new_pc     = *pc;
+                for (auto& layer : new_pc->point_layers)
+                {
+                    if (!layer.second) continue;
+                    auto m = mrpt::ptr_cast<mrpt::maps::CPointsMap>::from(
+                        layer.second->duplicateGetSmartPtr());
+
+                    std::vector<bool> deletion_mask(m->size(), true);
+                    for (size_t i = 0; i < deletion_mask.size(); i += decim)
+                        deletion_mask[i] = false;
+                    m->applyDeletionMask(deletion_mask);
+
+                    layer.second = m;
+                }
+
+                // One KF at a time, not to block other threads for long:
+                WorldModelEntitiesWriteLock wm_lock{*worldmodel_};
+                MOLA_PROFILED_LOCK(
+                    lck, lock_profiler_, wm_lock, "worldmodel.entities.write");
+
+                auto& anns = worldmodel_->entity_annotations_by_id(id);
+                auto  it   = anns.find(ANNOTATION_NAME_PC_LAYERS);
+                if (it == anns.end()) continue;
+
+                anns.erase(it);
+                anns.emplace(
+                    std::piecewise_construct,
+                    std::forward_as_tuple(ANNOTATION_NAME_PC_LAYERS),
+                    std::forward_as_tuple(new_pc, ANNOTATION_NAME_PC_LAYERS));
+            }
+        }
+        catch (const std::exception& e)
+        {
+            MRPT_LOG_ERROR_STREAM(
+                "Error decimating KF clouds:\n"
+                << mrpt::exception_to_str(e));
+        }
+    });
+}
+
+void LidarOdometry::memoryUnloadKFClouds()
+{
+    // Except those just loaded ahead because they will be needed soon:
+    std::vector<id_t> ids;
+    for (const auto& kv : state_.kf_cloud_bytes)
+        if (!state_.kf_loaded_ahead.count(kv.first)) ids.push_back(kv.first);
+    unloadKFClouds(ids);
+}
+
+void LidarOdometry::unloadKFClouds(const std::vector<id_t>& ids)
+{
+    // Only those KFs we are not going to align against soon:
+    const auto& nodes = state_.local_pose_graph.graph.nodes;
+
+    std::vector<id_t> to_spill;
+    for (const auto id : ids)
+    {
+        if (nodes.count(id) || state_.kf_unloaded.count(id)) continue;
+
+        const auto it_bytes = state_.kf_cloud_bytes.find(id);
+        if (it_bytes == state_.kf_cloud_bytes.end()) continue;  // no cloud
+
+        state_.kf_unloaded[id] = it_bytes->second;
+        it_bytes->second       = 0;
+        if (state_.kf_loaded_ahead.erase(id))
+        {
+            MOLA_PROFILED_LOCK(
+                lck, lock_profiler_, kf_loaded_in_background_mtx_,
+                "kf_loaded_in_background_mtx_");
+            kf_loaded_in_background_.erase(id);
+        }
+        to_spill.push_back(id);
+    }
+    if (to_spill.empty()) return;
+
+    {
+        MOLA_PROFILED_LOCK(
+            lck, lock_profiler_, kf_spill_pending_mtx_,
+            "kf_spill_pending_mtx_");
+        kf_spill_pending_.insert(to_spill.begin(), to_spill.end());
+    }
+
+    // Disk I/O, off the odometry thread:
+    worker_pool_spill_.enqueue([this, to_spill]() {
+        try
+        {
+            ProfilerEntry tle(profiler_, "unloadKFClouds");
+
+            for (const auto id : to_spill)
+            {
+                {
+                    MOLA_PROFILED_LOCK(
+                        lck, lock_profiler_, kf_spill_pending_mtx_,
+                        "kf_spill_pending_mtx_");
+                    // Not if requested to be loaded back meanwhile:
+                    if (!kf_spill_pending_.erase(id)) continue;
+                }
+
+                // One KF at a time, not to block other threads for long:
+                WorldModelEntitiesWriteLock wm_lock{*worldmodel_};
+                MOLA_PROFILED_LOCK(
+                    lck, lock_profiler_, wm_lock, "worldmodel.entities.write");
+
+                auto& anns = worldmodel_->entity_annotations_by_id(id);
+                auto  it   = anns.find(ANNOTATION_NAME_PC_LAYERS);
+                if (it == anns.end()) continue;
+
+                // Spill to disk. It will be transparently reloaded if needed:
+                it->second.unload();
+            }
+        }
+        catch (const std::exception& e)
+        {
+            MRPT_LOG_ERROR_STREAM(
+                "Error unloading KF clouds:\n"
+                << mrpt::exception_to_str(e));
+        }
+    });
+}
+
+void LidarOdometry::updateKFTileResidency()
+{
+    const auto ch = kf_tiles_.updateResidency(
+        state_.odom_pose.translation(), params_.kf_tiles);
+
+    profiler_.registerUserMeasure(
+        "kf_tiles.resident_tiles",
+        static_cast<double>(kf_tiles_.residentTileCount()));
+    if (ch.load.empty() && ch.unload.empty()) return;
+
+    ProfilerEntry tle(profiler_, "updateKFTileResidency");
+
+    if (!ch.unload.empty()) unloadKFClouds(ch.unload);
+
+    // Load the clouds of the tiles we are approaching in the background, so
+    // they are ready when needed for alignments:
+    loadKFCloudsInBackground(ch.load);
+}
+
+void LidarOdometry::prefetchKFClouds()
+{
+    ProfilerEntry tle(profiler_, "prefetchKFClouds");
+
+    // Sample the trajectory predicted with the current twist (or just the
+    // current pose, if it is not reliable):
+    const auto&  tw = state_.last_iter_twist;
+    const size_t nSamples =
+        state_.last_iter_twist_is_good ? params_.kf_prefetch_samples : 0;
+
+    std::vector<id_t> to_load;
+    std::set<id_t>    seen;
+    for (size_t i = 0; i <= nSamples; i++)
+    {
+        const double t = nSamples ? params_.kf_prefetch_horizon * i / nSamples
+                                  : .0;
+
+        mrpt::poses::Lie::SE<3>::tangent_vector v;
+        v[0] = tw.vx * t;
+        v[1] = tw.vy * t;
+        v[2] = tw.vz * t;
+        v[3] = tw.wx * t;
+        v[4] = tw.wy * t;
+        v[5] = tw.wz * t;
+        const auto predicted =
+            state_.odom_pose + mrpt::poses::Lie::SE<3>::exp(v);
+
+        // Earliest needed first:
+        for (const auto& kf : kf_tiles_.keyFramesNear(
+                 predicted.translation(), params_.max_dist_to_loop_closure,
+                 params_.kf_tiles))
+        {
+            if (!seen.insert(kf.first).second) continue;
+            if (!state_.kf_unloaded.count(kf.first)) continue;
+            to_load.push_back(kf.first);
+        }
+        if (to_load.size() >= params_.kf_prefetch_max_per_scan) break;
+    }
+    if (to_load.size() > params_.kf_prefetch_max_per_scan)
+        to_load.resize(params_.kf_prefetch_max_per_scan);
+
+    loadKFCloudsInBackground(to_load);
+}
+
+void LidarOdometry::loadKFCloudsInBackground(const std::vector<id_t>& ids)
+{
+    std::vector<id_t> to_load;
+    for (const auto id : ids)
+    {
+        const auto it = state_.kf_unloaded.find(id);
+        if (it == state_.kf_unloaded.end()) continue;
+
+        state_.kf_cloud_bytes[id] = it->second;
+        state_.kf_unloaded.erase(it);
+        state_.kf_loaded_ahead[id] = state_.last_obs_tim;
+        to_load.push_back(id);
+    }
+    if (to_load.empty()) return;
+
+    // Cancel their spills, if still queued:
+    {
+        MOLA_PROFILED_LOCK(
+            lck, lock_profiler_, kf_spill_pending_mtx_,
+            "kf_spill_pending_mtx_");
+        for (const auto id : to_load) kf_spill_pending_.erase(id);
+    }
+    // Not loaded until the task below gets to them:
+    {
+        MOLA_PROFILED_LOCK(
+            lck, lock_profiler_, kf_loaded_in_background_mtx_,
+            "kf_loaded_in_background_mtx_");
+        for (const auto id : to_load) kf_loaded_in_background_.erase(id);
+    }
+
+    enqueuePastKFTask([this, to_load](const ParameterSet&) {
+        try
+        {
+            ProfilerEntry tle(profiler_, "loadKFCloudsInBackground");
+
+            WorldModelEntitiesReadLock wm_lock{*worldmodel_};
+            MOLA_PROFILED_LOCK(
+                lck, lock_profiler_, wm_lock, "worldmodel.entities.read");
+
+            for (const auto id : to_load)
+            {
+                auto& anns = worldmodel_->entity_annotations_by_id(id);
+                auto  it   = anns.find(ANNOTATION_NAME_PC_LAYERS);
+                if (it == anns.end()) continue;
+                it->second.value();  // loads it
+                {
+                    MOLA_PROFILED_LOCK(
+                        lck2, lock_profiler_, kf_loaded_in_background_mtx_,
+                        "kf_loaded_in_background_mtx_");
+                    kf_loaded_in_background_.insert(id);
+                }
+                watchdog_.beat("load_kf_clouds");
+            }
+        }
+        catch (const std::exception& e)
+        {
+            MRPT_LOG_ERROR_STREAM(
+                "Error loading KF clouds:\n"
+                << mrpt::exception_to_str(e));
+        }
+    });
+}
+
+void LidarOdometry::expireKFsLoadedAhead()
+{
+    std::vector<id_t> expired;
+    for (const auto& kv : state_.kf_loaded_ahead)
+        if (mrpt::system::timeDifference(kv.second, state_.last_obs_tim) >
+            params_.kf_prefetch_horizon)
+            expired.push_back(kv.first);
+    if (expired.empty()) return;
+
+    // Mispredicted: they become candidates for memoryUnloadKFClouds() again
+    for (const auto id : expired) state_.kf_loaded_ahead.erase(id);
+    {
+        MOLA_PROFILED_LOCK(
+            lck, lock_profiler_, kf_loaded_in_background_mtx_,
+            "kf_loaded_in_background_mtx_");
+        for (const auto id : expired) kf_loaded_in_background_.erase(id);
+    }
+
+    profiler_.registerUserMeasure(
+        "kf_prefetch.expired", static_cast<double>(expired.size()));
+}
+
+void LidarOdometry::memoryEvictLocalGraph()
+{
+    auto& lpg = state_.local_pose_graph;
+
+    // Halve the local graph size (applied in the next checkForNearbyKFs()),
+    // but always keep enough KFs for the nearby alignment checks:
+    const size_t min_kfs =
+        std::max<size_t>(2, params_.max_nearby_align_checks + 1);
+    state_.local_graph_max_kfs = std::max<size_t>(
+        min_kfs,
+        std::min(state_.local_graph_max_kfs, lpg.graph.nodes.size()) / 2);
+
+    // Forget about checks for KFs out of the local graph:
+    for (auto it = lpg.checked_KF_pairs.begin();
+         it != lpg.checked_KF_pairs.end();)
+    {
+        if (!lpg.graph.nodes.count(it->first) ||
+            !lpg.graph.nodes.count(it->second))
+            it = lpg.checked_KF_pairs.erase(it);
+        else
+            ++it;
+    }
+
+    MRPT_LOG_WARN_STREAM(
+        "Memory budget: local graph limited to "
+        << state_.local_graph_max_kfs << " KFs.");
+}
+
+void LidarOdometry::spinOnce()
+{
+    MRPT_TRY_START
+
+    ProfilerEntry tleg(profiler_, "spinOnce");
+
+    // Not the odometry thread: never read params_ here.
+    const auto  ps = activeParameters();
+    const auto& p  = ps->params;
+
+    // Do not keep loop closures waiting forever for a batch to fill up:
+    bool flush_lcs = false;
+    {
+        MOLA_PROFILED_LOCK(
+            lck, lock_profiler_, lc_verifier_mtx_, "lc_verifier_mtx_");
+        flush_lcs = !lc_verifier_.empty() &&
+                    lc_verifier_.oldestAge() > p.pcm_max_wait;
+    }
+    // (Only once: the buffer stays stale until the queued task runs)
+    if (flush_lcs && !lc_flush_in_flight_.exchange(true))
+    {
+        enqueuePastKFTask([this](const ParameterSet& ps) {
+            verifyPendingLoopClosures(ps.params);
+            lc_flush_in_flight_ = false;
+        });
+    }
+
+    // Report stuck tasks:
+    if (p.watchdog_enabled)
+    {
+        for (const auto& stall : watchdog_.checkForStalls())
+        {
+            profiler_.registerUserMeasure("watchdog.stalls", 1);
+            MRPT_LOG_ERROR_STREAM(StallWatchdog::dump(stall));
+
+            if (stall.task.pool == "odometry")
+                enterDegradedMode(
+                    "odometry thread stalled at `" + stall.task.stage + "`",
+                    p);
+        }
+    }
+    checkDegradedModeRecovery(p);
+
+    MRPT_TRY_END
+}
+
+void LidarOdometry::reset()
+{
+    state_ = MethodState();
+    wheel_odometry_.clear();
+
+    kf_tiles_.clear();
+    {
+        MOLA_PROFILED_LOCK(
+            lck, lock_profiler_, kf_spill_pending_mtx_,
+            "kf_spill_pending_mtx_");
+        kf_spill_pending_.clear();
+    }
+    {
+        MOLA_PROFILED_LOCK(
+            lck, lock_profiler_, kf_loaded_in_background_mtx_,
+            "kf_loaded_in_background_mtx_");
+        kf_loaded_in_background_.clear();
+    }
+
+    global_map_.clear();
+    {
+        MOLA_PROFILED_LOCK(
+            lck, lock_profiler_, global_map_dirty_mtx_,
+            "global_map_dirty_mtx_");
+        global_map_dirty_kfs_.clear();
+        global_map_refresh_next_ = 0;
+    }
 
-    auto numICPThreads = std::thread::hardware_concurrency() / 2;
-    if (numICPThreads < 2) numICPThreads = 2;
-    worker_pool_past_KFs_.resize(numICPThreads);
-    MRPT_LOG_INFO_STREAM(
-        "Number of ICP working threads: " << numICPThreads
-                                          << " (determined automatically)");
+    // Edges and loop closures between KFs of the discarded graph:
+    {
+        MOLA_PROFILED_LOCK(
+            lck, lock_profiler_, local_pose_graph_log_mtx_,
+            "local_pose_graph_log_mtx_");
+        local_pose_graph_log_.clear();
+    }
+    local_pose_graph_log_merged_.clear();
+    std::atomic_store(
+        &local_pose_graph_snapshot_, std::shared_ptr<const kf_poses_t>());
+    {
+        MOLA_PROFILED_LOCK(
+            lck, lock_profiler_, lc_verifier_mtx_, "lc_verifier_mtx_");
+        lc_verifier_.clear();
+    }
 
-    // Load params:
-    auto c   = mrpt::containers::yaml::FromText(cfg_block);
-    auto cfg = c["params"];
-    MRPT_LOG_DEBUG_STREAM("Loading these params:\n" << cfg);
+    MOLA_PROFILED_LOCK(lck, lock_profiler_, degraded_mtx_, "degraded_mtx_");
+    degraded_pending_kf_ = {};
+    degraded_            = false;
+}
 
-    YAML_LOAD_REQ(params_, min_dist_xyz_between_keyframes, double);
-    YAML_LOAD_OPT_DEG(params_, min_rotation_between_keyframes, double);
+void LidarOdometry::subscribeToOdometry(const odometry_callback_t& callback)
+{
+    MOLA_PROFILED_LOCK(
+        lck, lock_profiler_, odometry_subscribers_mtx_,
+        "odometry_subscribers_mtx_");
+    odometry_subscribers_.push_back(callback);
+}
 
-    YAML_LOAD_OPT(params_, min_time_between_scans, double);
-    YAML_LOAD_OPT(params_, min_icp_goodness, double);
-    YAML_LOAD_OPT(params_, min_icp_goodness_lc, double);
-    YAML_LOAD_OPT(params_, decimate_to_point_count, unsigned int);
+void LidarOdometry::publishOdometry(
+    const mrpt::Clock::time_point& timestamp, double icp_goodness,
+    const mp2p_icp::pointcloud_t::Ptr& pc)
+{
+    MOLA_PROFILED_LOCK(
+        lck, lock_profiler_, odometry_subscribers_mtx_,
+        "odometry_subscribers_mtx_");
+    if (odometry_subscribers_.empty()) return;
 
-    YAML_LOAD_OPT(params_, min_dist_to_matching, double);
-    YAML_LOAD_OPT(params_, max_dist_to_matching, double);
-    YAML_LOAD_OPT(params_, max_dist_to_loop_closure, double);
-    YAML_LOAD_OPT(params_, max_nearby_align_checks, unsigned int);
-    YAML_LOAD_OPT(params_, min_topo_dist_to_consider_loopclosure, unsigned int);
-    YAML_LOAD_OPT(params_, loop_closure_montecarlo_samples, unsigned int);
+    ProfilerEntry tle(profiler_, "doProcessNewObservation.publishOdometry");
 
-    YAML_LOAD_OPT(params_, viz_decor_decimation, int);
-    YAML_LOAD_OPT(params_, viz_decor_pointsize, float);
+    OdometryUpdate u;
+    u.timestamp    = timestamp;
+    u.pose         = state_.odom_pose.asTPose();
+    u.twist        = state_.last_iter_twist;
+    u.icp_goodness = icp_goodness;
+    if (params_.odometry_publish_clouds) u.pointcloud = pc;
 
-    ENSURE_YAML_ENTRY_EXISTS(cfg, "icp_settings_with_vel");
-    load_icp_set_of_params(
-        params_.icp[AlignKind::LidarOdometry], cfg["icp_settings_with_vel"]);
-    load_icp_set_of_params(
-        params_.icp[AlignKind::NearbyAlign], cfg["icp_settings_without_vel"]);
-    load_icp_set_of_params(
-        params_.icp[AlignKind::LoopClosure], cfg["icp_settings_loop_closure"]);
+    for (const auto& cb : odometry_subscribers_)
+    {
+        try
+        {
+            cb(u);
+        }
+        catch (const std::exception& e)
+        {
+            MRPT_LOG_ERROR_STREAM(
+                "Exception in odometry subscriber:\n"
+                << mrpt::exception_to_str(e));
+        }
+    }
+}
 
-    YAML_LOAD_OPT(params_, debug_save_lidar_odometry, bool);
-    YAML_LOAD_OPT(params_, debug_save_extra_edges, bool);
-    YAML_LOAD_OPT(params_, debug_save_loop_closures, bool);
+void LidarOdometry::subscribeToGlobalMap(const global_map_callback_t& callback)
+{
+    MOLA_PROFILED_LOCK(
+        lck, lock_profiler_, global_map_subscribers_mtx_,
+        "global_map_subscribers_mtx_");
+    global_map_subscribers_.push_back(callback);
+}
 
-    // Create lidar segmentation algorithm:
+void LidarOdometry::updateGlobalMap(
+    id_t new_kf_id, const mp2p_icp::pointcloud_t::Ptr& pc,
+    const TiledVoxelMap::Parameters& p, const std::string& layers,
+    size_t max_pose_refresh)
+{
+    try
     {
-        ProfilerEntry tle(profiler_, "filterPointCloud_initialize");
+        ProfilerEntry tleg(profiler_, "updateGlobalMap");
 
-        std::string pointcloud_filter_class;
-        YAML_LOAD_REQ(pointcloud_filter_class, std::string);
+        std::vector<std::string> only_layers;
+        mrpt::system::tokenize(layers, ", ", only_layers);
 
-        ENSURE_YAML_ENTRY_EXISTS(cfg, "pointcloud_filter_params");
-        auto pc_params = cfg["pointcloud_filter_params"];
+        // All the (selected) point layers, in the KF frame:
+        mrpt::maps::CSimplePointsMap local;
+        for (const auto& layer : pc->point_layers)
+        {
+            if (!layer.second) continue;
+            if (!only_layers.empty() &&
+                std::find(
+                    only_layers.begin(), only_layers.end(), layer.first) ==
+                    only_layers.end())
+                continue;
+            local.insertAnotherMap(
+                layer.second.get(), mrpt::poses::CPose3D::Identity());
+        }
 
-        // Class factory:
-        auto ptrNew = mrpt::rtti::classFactory(pointcloud_filter_class);
-        state_.pc_filter =
-            mrpt::ptr_cast<lidar_segmentation::LidarFilterBase>::from(ptrNew);
+        // Latest back-end estimates for the new KF, those with new factors
+        // (most likely to move), and a bounded round-robin batch of the rest:
+        std::set<id_t> ids;
+        {
+            MOLA_PROFILED_LOCK(
+                lck, lock_profiler_, global_map_dirty_mtx_,
+                "global_map_dirty_mtx_");
+            ids.swap(global_map_dirty_kfs_);
+
+            const auto batch = global_map_.keyFramesFrom(
+                global_map_refresh_next_, max_pose_refresh);
+            if (!batch.empty()) global_map_refresh_next_ = batch.back() + 1;
+            ids.insert(batch.begin(), batch.end());
+        }
+        ids.insert(new_kf_id);
 
-        if (!state_.pc_filter)
-            THROW_EXCEPTION_FMT(
-                "pointcloud_filter_class=`%s` is a non-registered or "
-                "incompatible class. Please, run: "
-                "`mola-cli --rtti-children-of "
-                "mola::lidar_segmentation::LidarFilterBase`"
-                "to see the list of known classes.",
-                pointcloud_filter_class.c_str());
+        std::map<id_t, mrpt::poses::CPose3D> poses;
+        {
+            WorldModelEntitiesReadLock wm_lock{*worldmodel_};
+            MOLA_PROFILED_LOCK(
+                lck, lock_profiler_, wm_lock, "worldmodel.entities.read");
 
-        // Same verbosity level:
-        state_.pc_filter->setMinLoggingLevel(this->getMinLoggingLevel());
+            for (const auto id : ids)
+                poses[id] = mrpt::poses::CPose3D(
+                    entity_get_pose(worldmodel_->entity_by_id(id)));
+        }
 
-        // Initialize with YAML-based parameters:
-        state_.pc_filter->initialize(mola::yaml2string(pc_params));
-    }
+        global_map_.insertKeyFrame(new_kf_id, poses.at(new_kf_id), local, p);
 
-    // attach to world model, if present:
-    auto wms = findService<WorldModel>();
-    if (wms.size() == 1)
-        worldmodel_ = std::dynamic_pointer_cast<WorldModel>(wms[0]);
+        size_t moved = 0;
+        for (const auto& kv : poses)
+            if (kv.first != new_kf_id &&
+                global_map_.updateKeyFramePose(kv.first, kv.second, p))
+                moved++;
 
-    MRPT_TRY_END
-}
-void LidarOdometry::spinOnce()
-{
-    MRPT_TRY_START
+        GlobalMapUpdate u;
+        u.changed_tiles = global_map_.flushChangedTiles(p);
 
-    ProfilerEntry tleg(profiler_, "spinOnce");
+        profiler_.registerUserMeasure(
+            "updateGlobalMap.moved_kfs", static_cast<double>(moved));
+        profiler_.registerUserMeasure(
+            "updateGlobalMap.changed_tiles",
+            static_cast<double>(u.changed_tiles.size()));
 
-    //
-    MRPT_TRY_END
+        MOLA_PROFILED_LOCK(
+            lck, lock_profiler_, global_map_subscribers_mtx_,
+            "global_map_subscribers_mtx_");
+        for (const auto& cb : global_map_subscribers_)
+        {
+            try
+            {
+                cb(u);
+            }
+            catch (const std::exception& e)
+            {
+                MRPT_LOG_ERROR_STREAM(
+                    "Exception in global map subscriber:\n"
+                    << mrpt::exception_to_str(e));
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        MRPT_LOG_ERROR_STREAM("Exception:\n" << mrpt::exception_to_str(e));
+    }
 }
 
-void LidarOdometry::reset() { state_ = MethodState(); }
-
 void LidarOdometry::onNewObservation(CObservation::Ptr& o)
 {
     MRPT_TRY_START
     ProfilerEntry tleg(profiler_, "onNewObservation");
 
-    // Only process "my" sensor source:
     ASSERT_(o);
+    if (handleWheelOdometry(o)) return;
+
+    // Only process "my" sensor source:
     if (o->sensorLabel != raw_sensor_label_) return;
 
+    if (!first_obs_seen_.exchange(true))
+        first_obs_time_ = std::chrono::steady_clock::now();
+
     const auto queued = worker_pool_.pendingTasks();
     profiler_.registerUserMeasure("onNewObservation.queue_length", queued);
     if (queued > 10)
@@ -210,6 +1638,52 @@ void LidarOdometry::onNewObservation(CObservation::Ptr& o)
     MRPT_TRY_END
 }
 
+void LidarOdometry::attachOfflineServices(
+    const BackEndBase::Ptr& backend, const WorldModel::Ptr& wm)
+{
+    ASSERT_(backend);
+    ASSERT_(wm);
+    slam_backend_ = backend;
+    worldmodel_   = wm;
+}
+
+void LidarOdometry::processObservationNow(CObservation::Ptr& o)
+{
+    if (handleWheelOdometry(o)) return;
+
+    if (!first_obs_seen_.exchange(true))
+        first_obs_time_ = std::chrono::steady_clock::now();
+
+    profiler_.enter("delay_onNewObs_to_process");
+    doProcessNewObservation(o);
+}
+
+bool LidarOdometry::handleWheelOdometry(const CObservation::Ptr& o)
+{
+    // Called from the caller thread: never read params_ here.
+    const auto  ps = activeParameters();
+    const auto& p  = ps->params;
+
+    if (p.wheel_odometry_label.empty() || !o ||
+        o->sensorLabel != p.wheel_odometry_label)
+        return false;
+
+    const auto odo =
+        dynamic_cast<const mrpt::obs::CObservationOdometry*>(o.get());
+    if (!odo)
+    {
+        MRPT_LOG_THROTTLE_WARN_STREAM(
+            5.0, "Observation with label `"
+                     << o->sensorLabel
+                     << "` is not a CObservationOdometry. Ignoring it.");
+        return true;
+    }
+
+    wheel_odometry_.add(
+        odo->timestamp, mrpt::poses::CPose3D(odo->odometry), p.wheel_odometry);
+    return true;
+}
+
 // here happens the main stuff:
 void LidarOdometry::doProcessNewObservation(CObservation::Ptr& o)
 {
@@ -222,6 +1696,12 @@ void LidarOdometry::doProcessNewObservation(CObservation::Ptr& o)
         ProfilerEntry tleg(profiler_, "doProcessNewObservation");
         profiler_.leave("delay_onNewObs_to_process");
 
+        StallWatchdog::Scope wds(
+            watchdog_, "odometry", "doProcessNewObservation");
+
+        // Hot-reloaded parameters are only swapped in between scans:
+        applyPendingParameters();
+
         // Only process pointclouds that are sufficiently apart in time:
         const auto this_obs_tim = o->timestamp;
         if (state_.last_obs_tim != mrpt::Clock::time_point() &&
@@ -238,12 +1718,24 @@ void LidarOdometry::doProcessNewObservation(CObservation::Ptr& o)
         // Extract points from observation:
         auto this_obs_points = mp2p_icp::pointcloud_t::Create();
 
+        if (auto obs_pc =
+                dynamic_cast<const mrpt::obs::CObservationPointCloud*>(o.get());
+            obs_pc != nullptr && obs_pc->pointcloud)
+            state_.last_obs_bytes =
+                obs_pc->pointcloud->size() * BYTES_PER_RAW_POINT;
+
         // Filter/segment the point cloud:
+        watchdog_.beat("filter_pointclouds");
         ProfilerEntry tle1(
             profiler_, "doProcessNewObservation.1.filter_pointclouds");
 
         // convert to variant:
-        state_.pc_filter->filter(o, *this_obs_points);
+        if (state_.fast_path)
+            state_.fast_path->filter(o, *this_obs_points);
+        else
+            state_.pc_filter->filter(o, *this_obs_points);
+        if (params_.reflectors_enabled)
+            addReflectorsLayer(*o, *this_obs_points);
 
         tle1.stop();
 
@@ -266,7 +1758,8 @@ void LidarOdometry::doProcessNewObservation(CObservation::Ptr& o)
             return;
         }
 
-        bool create_keyframe = false;
+        bool   create_keyframe = false;
+        double icp_goodness    = .0;
 
         // First time we cannot do ICP since we need at least two pointclouds:
         if (!last_points || last_points->point_layers.empty())
@@ -281,6 +1774,7 @@ void LidarOdometry::doProcessNewObservation(CObservation::Ptr& o)
         {
             // Register point clouds using ICP:
             // ------------------------------------
+            watchdog_.beat("lidar_odometry_icp");
             profiler_.enter("doProcessNewObservation.2c.prepare_icp_in");
 
             mrpt::poses::CPose3DPDFGaussian initial_guess;
@@ -289,13 +1783,33 @@ void LidarOdometry::doProcessNewObservation(CObservation::Ptr& o)
             if (last_obs_tim != mrpt::Clock::time_point())
                 dt = mrpt::system::timeDifference(last_obs_tim, this_obs_tim);
 
+            // Repeated or out-of-order timestamps are ignored by the twist
+            // filter, long gaps reset it (identity guess in both cases):
+            state_.twist_kf.predict(dt, params_.twist_kf);
+
             ICP_Output icp_out;
             ICP_Input  icp_in;
-            icp_in.init_guess_to_wrt_from = mrpt::math::TPose3D(
-                state_.last_iter_twist.vx * dt, state_.last_iter_twist.vy * dt,
-                state_.last_iter_twist.vz * dt, state_.last_iter_twist.wz * dt,
-                0, 0);
-            MRPT_TODO("do omega_xyz part!");
+            icp_in.init_guess_to_wrt_from =
+                state_.twist_kf.predictRelativePose(dt, params_.twist_kf)
+                    .asTPose();
+
+            // Wheel odometry, if available, is a better prior:
+            bool has_wheel_prior = false;
+            if (!params_.wheel_odometry_label.empty())
+            {
+                if (const auto wheel_inc = wheel_odometry_.relativeMotion(
+                        last_obs_tim, this_obs_tim, params_.wheel_odometry);
+                    wheel_inc)
+                {
+                    icp_in.init_guess_to_wrt_from = wheel_inc->asTPose();
+                    has_wheel_prior               = true;
+                }
+                else
+                {
+                    profiler_.registerUserMeasure(
+                        "doProcessNewObservation.wheel_odometry_missing", 1);
+                }
+            }
 
             icp_in.to_pc   = this_obs_points;
             icp_in.from_pc = last_points;
@@ -303,16 +1817,22 @@ void LidarOdometry::doProcessNewObservation(CObservation::Ptr& o)
             icp_in.to_id =
                 mola::INVALID_ID;  // current data, not a new KF (yet)
             icp_in.debug_str = "lidar_odom";
+            // Only for the factor between KFs, which we never create here:
+            icp_in.need_information = !params_.odometry_only;
 
-            // If we don't have a valid twist estimation, use a larger ICP
-            // correspondence threshold:
+            // If we don't have a valid twist estimation nor wheel odometry,
+            // use a larger ICP correspondence threshold:
             icp_in.icp_params =
-                state_.last_iter_twist_is_good
+                (state_.last_iter_twist_is_good || has_wheel_prior)
                     ? params_.icp[AlignKind::LidarOdometry].icpParameters
                     : params_.icp[AlignKind::NearbyAlign].icpParameters;
 
             profiler_.leave("doProcessNewObservation.2c.prepare_icp_in");
 
+            // Alternative odometry hypotheses, if any, are aligned in
+            // parallel with the main one:
+            auto hyp_jobs = launchHypothesisAlignments(icp_in, has_wheel_prior);
+
             // Run ICP:
             {
                 ProfilerEntry tle(
@@ -320,17 +1840,56 @@ void LidarOdometry::doProcessNewObservation(CObservation::Ptr& o)
 
                 run_one_icp(icp_in, icp_out);
             }
-            const mrpt::poses::CPose3D rel_pose =
+            mrpt::poses::CPose3D rel_pose =
                 icp_out.found_pose_to_wrt_from.getMeanVal();
 
-            // Update velocity model:
-            state_.last_iter_twist.vx = rel_pose.x() / dt;
-            state_.last_iter_twist.vy = rel_pose.y() / dt;
-            state_.last_iter_twist.vz = rel_pose.z() / dt;
-            state_.last_iter_twist.wz = rel_pose.yaw() / dt;
-            MRPT_TODO("do omega_xyz part!");
+            state_.last_icp_degenerate = icp_out.degeneracy.is_degenerate;
+            if (icp_out.goodness <= 0)
+            {
+                // Failed alignment: nothing to trust but the motion prior.
+                rel_pose = mrpt::poses::CPose3D(icp_in.init_guess_to_wrt_from);
+                profiler_.registerUserMeasure(
+                    "doProcessNewObservation.failed_icp", 1);
+            }
+            else if (icp_out.degeneracy.is_degenerate)
+            {
+                // Trust the motion prior along the directions the scans
+                // cannot observe:
+                rel_pose = fuseWithMotionPrior(
+                    rel_pose,
+                    mrpt::poses::CPose3D(icp_in.init_guess_to_wrt_from),
+                    icp_out.degeneracy);
+                profiler_.registerUserMeasure(
+                    "doProcessNewObservation.degenerate_icp", 1);
+            }
+
+            // The best hypothesis may now be a different trajectory, then
+            // the odometry pose jumps to it:
+            mrpt::poses::CPose3D step_increment = rel_pose;
+            if (params_.multi_hypothesis_enabled)
+            {
+                ProfilerEntry tle(
+                    profiler_, "doProcessNewObservation.3c.hypotheses");
+
+                rel_pose =
+                    updateHypotheses(hyp_jobs, icp_in, icp_out, rel_pose);
+                step_increment = state_.hypotheses.best().last_increment;
+            }
+            else
+                state_.hypotheses.clear();
+
+            // Update velocity model, only with reliable alignments:
+            const bool twist_updated =
+                icp_out.goodness >= params_.twist_kf_min_goodness &&
+                !icp_out.degeneracy.is_degenerate &&
+                state_.twist_kf.correct(step_increment, dt, params_.twist_kf);
+            if (!twist_updated)
+                profiler_.registerUserMeasure(
+                    "doProcessNewObservation.twist_kf_rejected", 1);
 
-            state_.last_iter_twist_is_good = true;
+            // A rejected measurement does not invalidate the filter estimate:
+            state_.last_iter_twist         = state_.twist_kf.twist();
+            state_.last_iter_twist_is_good = state_.twist_kf.initialized();
 
             MRPT_LOG_DEBUG_STREAM(
                 "Est.twist=" << state_.last_iter_twist.asString());
@@ -338,9 +1897,32 @@ void LidarOdometry::doProcessNewObservation(CObservation::Ptr& o)
                 "Time since last scan="
                 << mrpt::system::formatTimeInterval(dt));
 
+            // Integrate odometry:
+            state_.odom_pose = state_.odom_pose + rel_pose;
+            icp_goodness     = icp_out.goodness;
+
             // Create a new KF if the distance since the last one is large
             // enough:
             state_.accum_since_last_kf = state_.accum_since_last_kf + rel_pose;
+
+            // Accumulate the uncertainty of the increments (a conservative,
+            // frame-independent approximation for the odometry factor):
+            if (icp_out.has_information && !icp_out.degeneracy.is_degenerate &&
+                state_.accum_var_xyz_since_last_kf >= 0)
+            {
+                const auto sigmas =
+                    information_to_max_sigmas(icp_out.information);
+                state_.accum_var_xyz_since_last_kf +=
+                    mrpt::square(sigmas.first);
+                state_.accum_var_rot_since_last_kf +=
+                    mrpt::square(sigmas.second);
+            }
+            else
+            {
+                // Unknown: use the max. sigmas for this KF:
+                state_.accum_var_xyz_since_last_kf = -1;
+                state_.accum_var_rot_since_last_kf = -1;
+            }
             const double dist_eucl_since_last =
                 state_.accum_since_last_kf.norm();
             const double rot_since_last =
@@ -354,151 +1936,123 @@ void LidarOdometry::doProcessNewObservation(CObservation::Ptr& o)
 
             create_keyframe =
                 (icp_out.goodness > params_.min_icp_goodness &&
+                 !icp_out.degeneracy.is_degenerate &&
+                 !state_.hypotheses.ambiguous() &&
                  (dist_eucl_since_last >
                       params_.min_dist_xyz_between_keyframes ||
                   rot_since_last > params_.min_rotation_between_keyframes));
 
         }  // end: yes, we can do ICP
 
+        if (degraded_) attachLateKeyFrame();
+
         // Should we create a new KF?
-        if (create_keyframe)
+        // (Never in odometry-only mode, where there is no map at all)
+        if (create_keyframe && !params_.odometry_only && !degraded_)
         {
             // Yes: create new KF
             // 1) New KeyFrame
             BackEndBase::ProposeKF_Input kf;
 
             kf.timestamp = this_obs_tim;
-            MRPT_TODO("re-enable this");
-            if (0)
-            {
-                mrpt::obs::CSensoryFrame& sf = kf.observations.emplace();
-                sf.push_back(o);
-            }
+            // Note: the raw observation is not passed in kf.observations,
+            // but compressed in the background (storeRawObservation()).
 
+            watchdog_.beat("addKeyFrame");
             profiler_.enter("doProcessNewObservation.3a.addKeyFrame");
 
-            std::future<BackEndBase::ProposeKF_Output> kf_out_fut;
-            kf_out_fut = slam_backend_->addKeyFrame(kf);
-
-            // Wait until it's executed:
-            auto kf_out = kf_out_fut.get();
-
-            ASSERT_(kf_out.success);
-            ASSERT_(kf_out.new_kf_id);
-
-            const mola::id_t new_kf_id = kf_out.new_kf_id.value();
-            ASSERT_(new_kf_id != mola::INVALID_ID);
+            ProposedKeyFrame pkf;
+            pkf.reply = slam_backend_->addKeyFrame(kf);
 
             profiler_.leave("doProcessNewObservation.3a.addKeyFrame");
 
-            // Add point cloud to the KF annotations in the map:
-            // Also, add Rendering decorations for the map visualizer:
-            ASSERT_(worldmodel_);
+            // Precompute normals once per KF, so they are reused by all
+            // future alignments against this KF. Done while the back-end
+            // is busy with the new KF:
+            if (params_.kf_compute_normals)
             {
-                profiler_.enter("doProcessNewObservation.wait.ent.writelock");
-                worldmodel_->entities_lock_for_write();
-                profiler_.leave("doProcessNewObservation.wait.ent.writelock");
-
                 ProfilerEntry tle(
-                    profiler_,
-                    "doProcessNewObservation.4.writePCsToWorldModel");
+                    profiler_, "doProcessNewObservation.3b.estimateNormals");
+                estimateKFNormals(*this_obs_points);
+            }
 
-                worldmodel_->entity_annotations_by_id(new_kf_id).emplace(
-                    std::piecewise_construct,
-                    std::forward_as_tuple(ANNOTATION_NAME_PC_LAYERS),
-                    std::forward_as_tuple(
-                        this_obs_points, ANNOTATION_NAME_PC_LAYERS));
+            pkf.obs           = o;
+            pkf.points        = this_obs_points;
+            pkf.pose          = state_.odom_pose;
+            pkf.accum         = state_.accum_since_last_kf;
+            pkf.accum_var_xyz = state_.accum_var_xyz_since_last_kf;
+            pkf.accum_var_rot = state_.accum_var_rot_since_last_kf;
+
+            // We need the new KF ID from now on:
+            watchdog_.beat("wait.addKeyFrame");
+            profiler_.enter("doProcessNewObservation.wait.addKeyFrame");
+            const bool timed_out =
+                params_.watchdog_enabled &&
+                params_.watchdog_degrade_to_odometry_only &&
+                pkf.reply.wait_for(std::chrono::duration<double>(
+                    params_.watchdog_odometry_timeout)) !=
+                    std::future_status::ready;
+            if (timed_out)
+            {
+                profiler_.leave("doProcessNewObservation.wait.addKeyFrame");
+                // Keep publishing poses: the KF is attached once (if ever)
+                // the back-end replies, see attachLateKeyFrame().
+                enterDegradedMode(
+                    "back-end did not reply to addKeyFrame()", params_,
+                    std::move(pkf));
+            }
+            else
+            {
+                const auto kf_out = pkf.reply.get();
+                profiler_.leave("doProcessNewObservation.wait.addKeyFrame");
 
-                MRPT_TODO(
-                    "move this render stuff to its a low-prio worker thread?");
-                if (state_.kf_decor_decim_cnt < 0 ||
-                    ++state_.kf_decor_decim_cnt > params_.viz_decor_decimation)
-                {
-                    auto obs_render = mrpt::opengl::CSetOfObjects::Create();
-
-                    if (auto obs_pc = dynamic_cast<
-                            const mrpt::obs::CObservationPointCloud*>(o.get());
-                        obs_pc != nullptr && obs_pc->pointcloud)
-                    {
-                        state_.kf_decor_decim_cnt = 0;
-
-                        obs_pc->pointcloud->renderOptions.point_size =
-                            params_.viz_decor_pointsize;
-                        obs_pc->pointcloud->getAs3DObject(obs_render);
-                    }
-                    else
-                    {
-                        state_.kf_decor_decim_cnt = 0;
-
-                        mrpt::maps::CColouredPointsMap pm;
-                        pm.renderOptions.point_size =
-                            params_.viz_decor_pointsize;
-
-                        if (pm.insertObservationPtr(o))
-                            pm.getAs3DObject(obs_render);
-                    }
-
-                    if (obs_render)
-                        worldmodel_->entity_annotations_by_id(new_kf_id)
-                            .emplace(
-                                std::piecewise_construct,
-                                std::forward_as_tuple("render_decoration"),
-                                std::forward_as_tuple(
-                                    obs_render, "render_decoration"));
-                }
+                attachKeyFrame(kf_out, pkf);
 
-                worldmodel_->entities_unlock_for_write();
+                // Reset accumulators:
+                state_.accum_since_last_kf         = mrpt::poses::CPose3D();
+                state_.accum_var_xyz_since_last_kf = .0;
+                state_.accum_var_rot_since_last_kf = .0;
             }
-            MRPT_LOG_INFO_STREAM("New KF: ID=" << new_kf_id);
+        }  // end done add a new KF
 
-            // 2) New SE(3) constraint between consecutive Keyframes:
-            if (state_.last_kf != mola::INVALID_ID)
-            {
-                std::future<BackEndBase::AddFactor_Output> factor_out_fut;
-                // Important: The "constant velocity model" factor is
-                // automatically added by the SLAM module (if applicable). Here,
-                // all we need to tell it is the SE(3) constraint, and the
-                // KeyFrame timestamp:
-                mola::FactorRelativePose3 fPose3(
-                    state_.last_kf, new_kf_id,
-                    state_.accum_since_last_kf.asTPose());
-
-                fPose3.noise_model_diag_xyz_ = 0.10;
-                fPose3.noise_model_diag_rot_ = mrpt::DEG2RAD(1.0);
-
-                mola::Factor f = std::move(fPose3);
-                factor_out_fut = slam_backend_->addFactor(f);
-
-                // Wait until it's executed:
-                auto factor_out = factor_out_fut.get();
-                ASSERT_(factor_out.success);
-                ASSERT_(
-                    factor_out.new_factor_id &&
-                    factor_out.new_factor_id != mola::INVALID_FID);
-
-                // Append to local graph as well:
-                {
-                    std::lock_guard<std::mutex> lck(local_pose_graph_mtx);
+        if (params_.kf_tiles_enabled && worldmodel_)
+            updateKFTileResidency();
+        if (params_.kf_prefetch_enabled && worldmodel_) prefetchKFClouds();
+        if (!state_.kf_loaded_ahead.empty()) expireKFsLoadedAhead();
 
-                    state_.local_pose_graph.graph.insertEdgeAtEnd(
-                        state_.last_kf, *kf_out.new_kf_id,
-                        state_.accum_since_last_kf);
-                }
+        enforceMemoryBudget();
 
-                MRPT_LOG_DEBUG_STREAM(
-                    "New FactorRelativePose3: #"
-                    << state_.last_kf << " <=> #" << new_kf_id
-                    << ". rel_pose=" << state_.accum_since_last_kf.asString());
-            }
+        if (!first_pose_reported_)
+        {
+            first_pose_reported_ = true;
+
+            const double dt = std::chrono::duration<double>(
+                                  std::chrono::steady_clock::now() -
+                                  first_obs_time_)
+                                  .count();
+            profiler_.registerUserMeasure("startup_to_first_pose", dt);
+            MRPT_LOG_INFO_FMT(
+                "Time from first observation to first pose: %.03f s", dt);
+        }
 
-            // Reset accumulators:
-            state_.accum_since_last_kf = mrpt::poses::CPose3D();
-            state_.last_kf             = new_kf_id;
-        }  // end done add a new KF
+        // Publish the odometry to local subscribers:
+        publishOdometry(this_obs_tim, icp_goodness, this_obs_points);
+
+        // Odometry-only mode (or degraded mode, see the watchdog): we are
+        // done with this scan.
+        if (params_.odometry_only || degraded_)
+        {
+            // Nothing else depends on it. In degraded mode, keep it for the
+            // factor to the last KF once we recover:
+            if (params_.odometry_only)
+                state_.accum_since_last_kf = mrpt::poses::CPose3D();
+            return;
+        }
 
         // In any case, publish to the SLAM BackEnd what's our **current**
         // vehicle pose, no matter if it's a keyframe or not:
         {
+            watchdog_.beat("advertiseUpdatedLocalization");
             ProfilerEntry tle(
                 profiler_,
                 "doProcessNewObservation.5.advertiseUpdatedLocalization");
@@ -508,31 +2062,306 @@ void LidarOdometry::doProcessNewObservation(CObservation::Ptr& o)
             new_loc.reference_kf = state_.last_kf;
             new_loc.pose         = state_.accum_since_last_kf.asTPose();
 
-            std::future<void> adv_pose_fut =
-                slam_backend_->advertiseUpdatedLocalization(new_loc);
-        }
+            std::future<void> adv_pose_fut =
+                slam_backend_->advertiseUpdatedLocalization(new_loc);
+        }
+
+        // Now, let's try to align this new KF against a few past KFs as well.
+        // we'll do it in separate threads, with priorities so the latest KFs
+        // are always attended first:
+        mergeLocalPoseGraphLog();
+        const bool can_check_for_other_matches =
+            !state_.local_pose_graph.graph.edges.empty();
+
+        if (can_check_for_other_matches)
+        {
+            watchdog_.beat("checkForNearbyKFs");
+            ProfilerEntry tle(
+                profiler_, "doProcessNewObservation.6.checkForNearbyKFs");
+            checkForNearbyKFs();
+        }
+    }
+    catch (const std::exception& e)
+    {
+        MRPT_LOG_ERROR_STREAM("Exception:\n" << mrpt::exception_to_str(e));
+    }
+}
+
+mrpt::poses::CPose3D LidarOdometry::fuseWithMotionPrior(
+    const mrpt::poses::CPose3D& icp_pose, const mrpt::poses::CPose3D& prior,
+    const ICP_Degeneracy& dg) const
+{
+    // Translation: replace the ICP solution by the prior along those
+    // eigenvectors below the degeneracy threshold:
+    const mrpt::math::TVector3D icp_t = icp_pose.translation();
+    const mrpt::math::TVector3D delta = prior.translation() - icp_t;
+
+    mrpt::math::TVector3D t = icp_t;
+    for (int i = 0; i < 3; i++)
+    {
+        if (dg.eig_xyz[i] >= params_.degeneracy_min_eig_xyz) continue;
+        const mrpt::math::TVector3D v(
+            dg.eigvec_xyz(0, i), dg.eigvec_xyz(1, i), dg.eigvec_xyz(2, i));
+        t = t + v * (v.x * delta.x + v.y * delta.y + v.z * delta.z);
+    }
+
+    // Rotation: if any direction is unobservable, keep the prior attitude:
+    const bool rot_degenerate = dg.eig_rot[0] < params_.degeneracy_min_eig_rot;
+
+    mrpt::poses::CPose3D ret = rot_degenerate ? prior : icp_pose;
+    ret.x(t.x);
+    ret.y(t.y);
+    ret.z(t.z);
+    return ret;
+}
+
+LidarOdometry::hypothesis_alignments_t
+    LidarOdometry::launchHypothesisAlignments(
+        const ICP_Input& main_in, bool has_wheel_prior)
+{
+    hypothesis_alignments_t jobs;
+    if (!params_.multi_hypothesis_enabled) return jobs;
+
+    // (Re)start tracking from the current odometry, e.g. after enabling it
+    // in a parameter hot-reload:
+    auto& mh = state_.hypotheses;
+    if (mh.empty() || mh.best().pose.distanceTo(state_.odom_pose) > 1e-3)
+        mh.reset(state_.odom_pose);
+
+    // All hypotheses are aligned the same way against the last scan, so
+    // that alignment cannot tell them apart: they are aligned against the
+    // anchor instead, from which each one has a different relative pose.
+    if (!mh.ambiguous() || !state_.hypotheses_anchor_points) return jobs;
+
+    const auto& hyps = mh.hypotheses();
+    for (size_t i = 0; i < hyps.size(); i++)
+    {
+        auto job      = std::make_shared<HypothesisAlignment>();
+        job->parent   = i;
+        job->anchored = true;
+        // Each hypothesis has its own constant-velocity prior, unless
+        // there is an external one:
+        job->prior = has_wheel_prior
+                         ? mrpt::poses::CPose3D(main_in.init_guess_to_wrt_from)
+                         : hyps[i].last_increment;
+
+        job->in            = main_in;
+        job->in.align_kind = AlignKind::NearbyAlign;
+        job->in.from_pc    = state_.hypotheses_anchor_points;
+        job->in.icp_params =
+            params_.icp[AlignKind::NearbyAlign].icpParameters;
+        job->in.init_guess_to_wrt_from =
+            ((hyps[i].pose + job->prior) - state_.hypotheses_anchor_pose)
+                .asTPose();
+        job->in.debug_str        = "lidar_odom_hypothesis";
+        job->in.need_information = false;
+        jobs.push_back(job);
+    }
+    startHypothesisAlignments(jobs);
+    return jobs;
+}
+
+void LidarOdometry::startHypothesisAlignments(hypothesis_alignments_t& jobs)
+{
+    // Do not wait behind queued past-KF tasks, which may take long:
+    // align in this thread instead.
+    const bool run_here = worker_pool_past_KFs_.pendingTasks() > 0;
+
+    for (auto& job : jobs)
+    {
+        if (run_here)
+        {
+            run_one_icp(job->in, job->out);
+            continue;
+        }
+        job->done = worker_pool_past_KFs_.enqueue([this, job]() {
+            StallWatchdog::Scope wds(
+                watchdog_, "past_KFs", "odometry_hypothesis");
+            run_one_icp(job->in, job->out);
+        });
+    }
+}
+
+mrpt::poses::CPose3D LidarOdometry::updateHypotheses(
+    hypothesis_alignments_t& jobs, const ICP_Input& main_in,
+    const ICP_Output& main_out, const mrpt::poses::CPose3D& main_increment)
+{
+    MRPT_START
+
+    auto&       mh = state_.hypotheses;
+    const auto& mp = params_.multi_hypothesis;
+
+    const mrpt::poses::CPose3D main_prior(main_in.init_guess_to_wrt_from);
+
+    // An ambiguous alignment: seed new hypotheses at both sides of the
+    // solution, along the least observable direction:
+    const auto& dg = main_out.degeneracy;
+    if (dg.is_degenerate && !mh.ambiguous() && mp.max_hypotheses > 1)
+    {
+        // The anchor, for the next steps: the last KF if near enough, since
+        // it is farther away than the last scan (more distinct relative
+        // poses between hypotheses), or the last scan otherwise:
+        if (state_.last_kf_points &&
+            state_.last_kf_pose.distanceTo(state_.odom_pose) <
+                params_.max_dist_to_matching)
+        {
+            state_.hypotheses_anchor_points = state_.last_kf_points;
+            state_.hypotheses_anchor_pose   = state_.last_kf_pose;
+        }
+        else
+        {
+            state_.hypotheses_anchor_points = main_in.from_pc;
+            state_.hypotheses_anchor_pose   = state_.odom_pose;
+        }
+
+        const mrpt::math::TVector3D v(
+            dg.eigvec_xyz(0, 0), dg.eigvec_xyz(1, 0), dg.eigvec_xyz(2, 0));
+
+        hypothesis_alignments_t seeds;
+        for (const double sign : {-1.0, 1.0})
+        {
+            auto job    = std::make_shared<HypothesisAlignment>();
+            job->parent = mh.bestIndex();
+            job->prior  = main_prior;
+            job->in     = main_in;
+
+            auto       seed = main_increment;
+            const auto t = seed.translation() + v * (sign * mp.spawn_offset);
+            seed.x(t.x);
+            seed.y(t.y);
+            seed.z(t.z);
+            job->in.init_guess_to_wrt_from = seed.asTPose();
+            job->in.debug_str              = "lidar_odom_hypothesis_seed";
+            job->in.need_information       = false;
+            seeds.push_back(job);
+        }
+        startHypothesisAlignments(seeds);
+        jobs.insert(jobs.end(), seeds.begin(), seeds.end());
+
+        profiler_.registerUserMeasure("multi_hypothesis.spawned", 1);
+    }
+
+    // The main alignment first (unless the hypotheses are aligned against
+    // the anchor), so the best hypothesis keeps its id:
+    std::vector<OdometryHypotheses::Candidate> candidates;
+    const bool anchored = !jobs.empty() && jobs.front()->anchored;
+    if (!anchored)
+    {
+        auto& c     = candidates.emplace_back();
+        c.parent    = mh.bestIndex();
+        c.increment = main_increment;
+        c.prior     = main_prior;
+        c.goodness  = main_out.goodness;
+    }
+    for (auto& job : jobs)
+    {
+        if (job->done.valid()) job->done.get();  // rethrows, if any
+
+        if (job->anchored)
+        {
+            const auto& parent = mh.hypotheses().at(job->parent);
+
+            auto& c    = candidates.emplace_back();
+            c.parent   = job->parent;
+            c.prior    = job->prior;
+            c.goodness = std::max(.0, job->out.goodness);
+            // No overlap with the anchor anymore: keep tracking with the
+            // scan-to-scan increment, with no goodness to score:
+            c.increment =
+                job->out.goodness > 0
+                    ? (state_.hypotheses_anchor_pose +
+                       job->out.found_pose_to_wrt_from.getMeanVal()) -
+                          parent.pose
+                    : main_increment;
+            continue;
+        }
+        if (job->out.goodness <= 0) continue;  // failed: drop it
+
+        auto& c     = candidates.emplace_back();
+        c.parent    = job->parent;
+        c.increment = job->out.found_pose_to_wrt_from.getMeanVal();
+        c.prior     = job->prior;
+        c.goodness  = job->out.goodness;
+    }
+
+    const auto prev_best_id = mh.best().id;
+    mh.update(candidates, mp);
+
+    if (mh.best().id != prev_best_id)
+    {
+        MRPT_LOG_WARN_FMT(
+            "Multi-hypothesis odometry: switching to hypothesis #%u (%u "
+            "alive), pose jump=%.03f m",
+            static_cast<unsigned int>(mh.best().id),
+            static_cast<unsigned int>(mh.size()),
+            mh.best().pose.distanceTo(state_.odom_pose + main_increment));
+        profiler_.registerUserMeasure("multi_hypothesis.switches", 1);
+    }
+    profiler_.registerUserMeasure(
+        "multi_hypothesis.alive", static_cast<double>(mh.size()));
+
+    if (!mh.ambiguous()) state_.hypotheses_anchor_points.reset();
+
+    return mh.best().pose - state_.odom_pose;
+
+    MRPT_END
+}
+
+void LidarOdometry::addReflectorsLayer(
+    const mrpt::obs::CObservation& o, mp2p_icp::pointcloud_t& pc)
+{
+    ProfilerEntry tle(profiler_, "addReflectorsLayer");
+
+    ReflectorsParameters rp;
+    rp.min_intensity = params_.reflectors_min_intensity;
+    rp.max_range     = params_.reflectors_max_range;
+    rp.voxel_size    = params_.reflectors_voxel_size;
+    rp.max_points    = params_.reflectors_max_points;
+
+    auto layer = extract_reflectors(o, rp);
+    if (!layer) return;
+
+    profiler_.registerUserMeasure(
+        "reflectors.points", static_cast<double>(layer->size()));
+    pc.point_layers[LAYER_NAME_REFLECTORS] = std::move(layer);
+}
+
+void LidarOdometry::estimateKFNormals(mp2p_icp::pointcloud_t& pc)
+{
+    MRPT_START
+
+    std::vector<std::string> only_layers;
+    mrpt::system::tokenize(params_.kf_normals_layers, ", ", only_layers);
+
+    NormalsEstimationParameters np;
+    np.knn        = params_.kf_normals_knn;
+    np.decimation = params_.kf_normals_decimation;
+    np.max_e0_e1  = params_.kf_normals_max_e0_e1;
+    np.num_chunks = static_cast<unsigned int>(worker_pool_normals_.size());
 
-        // Now, let's try to align this new KF against a few past KFs as well.
-        // we'll do it in separate threads, with priorities so the latest KFs
-        // are always attended first:
-        bool can_check_for_other_matches = true;
-        {
-            std::lock_guard<std::mutex> lck(local_pose_graph_mtx);
-            can_check_for_other_matches =
-                !state_.local_pose_graph.graph.edges.empty();
-        }
+    const auto nPlanesBefore = pc.planes.size();
 
-        if (can_check_for_other_matches)
-        {
-            ProfilerEntry tle(
-                profiler_, "doProcessNewObservation.6.checkForNearbyKFs");
-            checkForNearbyKFs();
-        }
-    }
-    catch (const std::exception& e)
+    for (const auto& layer : pc.point_layers)
     {
-        MRPT_LOG_ERROR_STREAM("Exception:\n" << mrpt::exception_to_str(e));
+        if (!layer.second) continue;
+        if (!only_layers.empty() &&
+            std::find(only_layers.begin(), only_layers.end(), layer.first) ==
+                only_layers.end())
+            continue;
+
+        estimate_point_normals(
+            *layer.second, np, worker_pool_normals_, pc.planes);
     }
+
+    // Sorted by position, so the alignment Hessian and
+    // Matcher_Point2CachedPlane can look up the plane of a paired point:
+    sort_plane_patches(pc.planes);
+
+    MRPT_LOG_DEBUG_STREAM(
+        "estimateKFNormals: added " << pc.planes.size() - nPlanesBefore
+                                    << " plane patches.");
+
+    MRPT_END
 }
 
 void LidarOdometry::checkForNearbyKFs()
@@ -548,7 +2377,9 @@ void LidarOdometry::checkForNearbyKFs()
                KF_distances;
     mola::id_t current_kf_id{mola::INVALID_ID};
     {
-        std::lock_guard<std::mutex> lck(local_pose_graph_mtx);
+        // No lock needed: only this thread touches the local graph. New
+        // edges from other threads are merged from the log:
+        mergeLocalPoseGraphLog();
 
         auto& lpg     = state_.local_pose_graph.graph;
         current_kf_id = state_.last_kf;
@@ -577,7 +2408,9 @@ void LidarOdometry::checkForNearbyKFs()
         lpg.getAdjacencyMatrix(adj);
 
         // Remove too distant KFs:
-        while (lpg.nodes.size() > params_.max_KFs_local_graph)
+        const size_t max_kfs = std::min<size_t>(
+            params_.max_KFs_local_graph, state_.local_graph_max_kfs);
+        while (lpg.nodes.size() > max_kfs)
         {
             const auto id_to_remove = KF_distances.rbegin()->second.first;
             KF_distances.erase(std::prev(KF_distances.end()));
@@ -589,54 +2422,167 @@ void LidarOdometry::checkForNearbyKFs()
                 lpg.edges.erase(std::make_pair(other_id, id_to_remove));
             }
         }
+
+        // Publish the new node poses for readers in other threads:
+        auto snapshot = std::make_shared<kf_poses_t>();
+        for (const auto& n : lpg.nodes) snapshot->emplace(n.first, n.second);
+        std::atomic_store(
+            &local_pose_graph_snapshot_,
+            std::shared_ptr<const kf_poses_t>(std::move(snapshot)));
+    }
+
+    // (Re)build the list of candidates for the current KF, unless we are
+    // resuming the evaluation of a list that ran out of time budget:
+    auto& cursor = state_.nearby_kfs_cursor;
+    if (cursor.from_id != current_kf_id ||
+        cursor.next >= cursor.pending.size())
+    {
+        ProfilerEntry tle(profiler_, "checkForNearbyKFs.listCandidates");
+
+        if (cursor.from_id != current_kf_id)
+        {
+            cursor.from_id                 = current_kf_id;
+            cursor.nearby_dispatched       = 0;
+            cursor.loop_closure_dispatched = false;
+        }
+        cursor.pending.clear();
+        cursor.next = 0;
+
+        const auto already_checked = [&](id_t kf_id) {
+            return state_.local_pose_graph.checked_KF_pairs.count(
+                       std::make_pair(
+                           std::min(kf_id, current_kf_id),
+                           std::max(kf_id, current_kf_id))) != 0;
+        };
+
+        // Pick the nodes at an intermediary distance:
+        auto it1 = KF_distances.lower_bound(params_.min_dist_to_matching);
+        auto it2 = KF_distances.upper_bound(std::max(
+            params_.max_dist_to_loop_closure, params_.max_dist_to_matching));
+
+        for (auto it = it1; it != it2; ++it)
+        {
+            NearbyKFCandidate c;
+            c.eucl_dist       = it->first;
+            c.kf_id           = it->second.first;
+            c.topo_dist       = it->second.second;
+            c.is_loop_closure = (c.topo_dist >=
+                                 params_.min_topo_dist_to_consider_loopclosure);
+
+            // Only explore KFs farther than this threshold if they are LCs:
+            if (!c.is_loop_closure &&
+                c.eucl_dist > params_.max_dist_to_matching)
+                continue;
+            if (already_checked(c.kf_id)) continue;
+
+            c.init_guess =
+                state_.local_pose_graph.graph.nodes[c.kf_id].asTPose();
+            cursor.pending.push_back(c);
+        }
+
+        // Loop closure candidates out of the local graph, only from the
+        // resident tiles:
+        const auto current_kf_pose = kf_tiles_.keyFramePose(current_kf_id);
+        if (params_.kf_tiles_enabled && current_kf_pose)
+        {
+            const auto& nodes      = state_.local_pose_graph.graph.nodes;
+            const auto  candidates = kf_tiles_.residentKeyFramesNear(
+                current_kf_pose->translation(),
+                params_.max_dist_to_loop_closure, params_.kf_tiles);
+
+            for (const auto& kf : candidates)
+            {
+                if (kf.first == current_kf_id || nodes.count(kf.first))
+                    continue;
+                if (already_checked(kf.first)) continue;
+
+                const auto rel_pose = kf.second - *current_kf_pose;
+
+                NearbyKFCandidate c;
+                c.kf_id           = kf.first;
+                c.eucl_dist       = rel_pose.norm();
+                c.is_loop_closure = true;
+                c.from_tiles      = true;
+                c.init_guess      = rel_pose.asTPose();
+                cursor.pending.push_back(c);
+            }
+        }
+
+        // By expected value: loop closures first (the closest ones, in
+        // theory, the easiest to align), then nearby KFs with the largest
+        // topological distance (the most informative new edges):
+        std::stable_sort(
+            cursor.pending.begin(), cursor.pending.end(),
+            [](const NearbyKFCandidate& a, const NearbyKFCandidate& b) {
+                if (a.is_loop_closure != b.is_loop_closure)
+                    return a.is_loop_closure;
+                if (!a.is_loop_closure && a.topo_dist != b.topo_dist)
+                    return a.topo_dist > b.topo_dist;
+                return a.eucl_dist < b.eucl_dist;
+            });
     }
 
-    // Pick the node at an intermediary distance and try to align
-    // against it:
-    auto it1 = KF_distances.lower_bound(params_.min_dist_to_matching);
-    auto it2 = KF_distances.upper_bound(std::max(
-        params_.max_dist_to_loop_closure, params_.max_dist_to_matching));
+    // Don't even try loop closures in a degenerate place (tunnels, open
+    // fields...):
+    const bool lc_allowed = !state_.last_icp_degenerate;
 
-    // Store here all the desired checks:
-    std::vector<ICP_Input::Ptr>                nearby_checks;
-    std::map<euclidean_dist_t, ICP_Input::Ptr> loop_closure_checks;
+    const auto tStart = std::chrono::steady_clock::now();
 
-    for (auto it = it1; it != it2; ++it)
+    for (; cursor.next < cursor.pending.size(); cursor.next++)
     {
-        const double             kf_eucl_dist        = it->first;
-        const auto               kf_id               = it->second.first;
-        const topological_dist_t kf_topo_d           = it->second.second;
-        bool                     edge_already_exists = false;
-        const bool               is_potential_loop_closure =
-            (kf_topo_d >= params_.min_topo_dist_to_consider_loopclosure);
+        // Nothing else to dispatch for this KF?
+        if (cursor.nearby_dispatched >= params_.max_nearby_align_checks &&
+            (cursor.loop_closure_dispatched || !lc_allowed))
+        {
+            cursor.next = cursor.pending.size();
+            break;
+        }
+
+        // Resume from here in the next call if out of time:
+        if (params_.nearby_kfs_time_budget > 0 &&
+            std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - tStart)
+                    .count() > params_.nearby_kfs_time_budget)
+        {
+            MRPT_LOG_DEBUG_STREAM(
+                "[checkForNearbyKFs] Out of time budget, "
+                << cursor.pending.size() - cursor.next
+                << " candidates left for the next call.");
+            break;
+        }
+
+        const auto& c     = cursor.pending[cursor.next];
+        const auto  kf_id = c.kf_id;
+        bool        edge_already_exists = false;
 
-        // Only explore KFs farther than this threshold if they are LCs:
-        if (!is_potential_loop_closure &&
-            kf_eucl_dist > params_.max_dist_to_matching)
+        // Only the first (closest) loop closure, in theory, the easiest one
+        // to align. The rest are not marked as checked, so they are
+        // considered again for the next KFs:
+        if (c.is_loop_closure &&
+            (cursor.loop_closure_dispatched || !lc_allowed))
+            continue;
+        if (!c.is_loop_closure &&
+            cursor.nearby_dispatched >= params_.max_nearby_align_checks)
             continue;
 
-        // Already sent out for checking?
+        // Already sent out for checking (since the list was built)?
         const auto pair_ids = std::make_pair(
             std::min(kf_id, current_kf_id), std::max(kf_id, current_kf_id));
 
-        {
-            std::lock_guard<std::mutex> lck(local_pose_graph_mtx);
-
-            if (state_.local_pose_graph.checked_KF_pairs.count(pair_ids) != 0)
-                edge_already_exists = true;
-        }
+        if (state_.local_pose_graph.checked_KF_pairs.count(pair_ids) != 0)
+            edge_already_exists = true;
 
         MRPT_TODO("Factors should have an annotation to know who created them");
         // Also check in the WorldModel if *we* created an edge already between
         // those two KFs:
-        if (!edge_already_exists && worldmodel_)
+        if (!edge_already_exists && worldmodel_ && !c.from_tiles)
         {
-            profiler_.enter("checkForNearbyKFs.wait.worldmodel.locks");
-
-            worldmodel_->entities_lock_for_read();
-            worldmodel_->factors_lock_for_read();
-
-            profiler_.leave("checkForNearbyKFs.wait.worldmodel.locks");
+            WorldModelEntitiesReadLock ent_lock{*worldmodel_};
+            WorldModelFactorsReadLock  fac_lock{*worldmodel_};
+            MOLA_PROFILED_LOCK(
+                lck1, lock_profiler_, ent_lock, "worldmodel.entities.read");
+            MOLA_PROFILED_LOCK(
+                lck2, lock_profiler_, fac_lock, "worldmodel.factors.read");
 
             const auto connected = worldmodel_->entity_neighbors(kf_id);
             if (connected.count(current_kf_id) != 0)
@@ -647,130 +2593,133 @@ void LidarOdometry::checkForNearbyKFs()
                     << kf_id << " <==> #" << current_kf_id);
                 edge_already_exists = false;
             }
-
-            worldmodel_->factors_unlock_for_read();
-            worldmodel_->entities_unlock_for_read();
         }
 
-        if (!edge_already_exists)
-        {
-            // Prepare the command to be sent out to the worker thread:
-            auto d     = std::make_shared<ICP_Input>();
-            d->to_id   = kf_id;
-            d->from_id = current_kf_id;
-
-            // Retrieve the point clouds from the Map (WorldModel).
-            // This will automatically load them from disk if they were swapped
-            // off memory after a long time unused:
-            // d->to_pc   = state_.local_pose_graph.pcs[d->to_id];
-            // d->from_pc = state_.local_pose_graph.pcs[d->from_id];
-            profiler_.enter("checkForNearbyKFs.wait.entities.lockread");
-
-            worldmodel_->entities_lock_for_read();
+        if (edge_already_exists) continue;
 
-            profiler_.leave("checkForNearbyKFs.wait.entities.lockread");
+        // Prepare the command to be sent out to the worker thread:
+        auto d     = std::make_shared<ICP_Input>();
+        d->to_id   = kf_id;
+        d->from_id = current_kf_id;
 
-            MRPT_TODO(
-                "Make a mola-kernel function to make this cleaner and throw "
-                "sensible exception errors if something fails");
-            {
-                ProfilerEntry tle(
-                    profiler_, "checkForNearbyKFs.readPCsFromWorldModel");
-
-                d->to_pc = mrpt::ptr_cast<mp2p_icp::pointcloud_t>::from(
-                    worldmodel_->entity_annotations_by_id(d->to_id)
-                        .at(ANNOTATION_NAME_PC_LAYERS)
-                        .value());
-
-                d->from_pc = mrpt::ptr_cast<mp2p_icp::pointcloud_t>::from(
-                    worldmodel_->entity_annotations_by_id(d->from_id)
-                        .at(ANNOTATION_NAME_PC_LAYERS)
-                        .value());
-            }
+        // Retrieve the point clouds from the Map (WorldModel), only for the
+        // checks we actually dispatch.
+        // This will automatically load them from disk if they were swapped
+        // off memory after a long time unused:
+        readKFPointClouds(*d);
 
-            worldmodel_->entities_unlock_for_read();
+        d->init_guess_to_wrt_from = c.init_guess;
 
-            {
-                std::lock_guard<std::mutex> lck(local_pose_graph_mtx);
+        // Is this an extra edge for a nearby KF, or a potential loop
+        // closure?
+        if (!c.is_loop_closure)
+        {
+            // Regular, nearby KF-to-KF ICP check:
+            d->align_kind = AlignKind::NearbyAlign;
+            d->debug_str  = "extra_edge"s;
+            d->icp_params = params_.icp[d->align_kind].icpParameters;
 
-                d->init_guess_to_wrt_from =
-                    state_.local_pose_graph.graph.nodes[kf_id].asTPose();
-            }
+            cursor.nearby_dispatched++;
+        }
+        else
+        {
+            // Attempt to close a loop:
+            d->align_kind = AlignKind::LoopClosure;
+            d->debug_str =
+                c.from_tiles ? "loop_closure_tiles"s : "loop_closure"s;
+            d->icp_params = params_.icp[d->align_kind].icpParameters;
 
-            // Is this an extra edge for a nearby KF, or a potential loop
-            // closure?
-            if (!is_potential_loop_closure)
-            {
-                // Regular, nearby KF-to-KF ICP check:
-                d->align_kind = AlignKind::NearbyAlign;
-                d->debug_str  = "extra_edge"s;
-                d->icp_params = params_.icp[d->align_kind].icpParameters;
+            MRPT_LOG_WARN_STREAM(
+                "Attempting to close a loop between KFs #"
+                << d->to_id << " <==> #" << d->from_id);
+            cursor.loop_closure_dispatched = true;
+        }
 
-                nearby_checks.emplace_back(std::move(d));
-            }
-            else
-            {
-                // Attempt to close a loop:
-                d->align_kind = AlignKind::LoopClosure;
-                d->debug_str  = "loop_closure"s;
-                d->icp_params = params_.icp[d->align_kind].icpParameters;
+        enqueuePastKFTask([this, d](const ParameterSet& ps) {
+            doCheckForNonAdjacentKFs(d, ps);
+        });
 
-                loop_closure_checks[kf_eucl_dist] = std::move(d);
-            }
-        }
+        // Mark as already considered for check:
+        state_.local_pose_graph.checked_KF_pairs.insert(pair_ids);
     }
+    profiler_.registerUserMeasure(
+        "checkForNearbyKFs.pending_candidates",
+        static_cast<double>(cursor.pending.size() - cursor.next));
 
-    // Actually send the tasks to the worker thread, firstly filtering
-    // some of them to reduce the computational cost:
-    // Nearby checks: send a maximum of "N"
-    const size_t nNearbyChecks    = nearby_checks.size();
-    const size_t nearbyCheckDecim = std::max(
-        static_cast<size_t>(1U),
-        nNearbyChecks / params_.max_nearby_align_checks);
-    for (size_t idx = 0; idx < nNearbyChecks; idx += nearbyCheckDecim)
-    {
-        const auto& d = nearby_checks[idx];
-        worker_pool_past_KFs_.enqueue(
-            &LidarOdometry::doCheckForNonAdjacentKFs, this, d);
+    MRPT_END
+}
 
+void LidarOdometry::accountKFCloudAccess(id_t id)
+{
+    if (state_.kf_loaded_ahead.erase(id))
+    {
+        bool loaded;
         {
-            std::lock_guard<std::mutex> lck(local_pose_graph_mtx);
-
-            // Mark as already considered for check:
-            state_.local_pose_graph.checked_KF_pairs.insert(std::make_pair(
-                std::min(d->to_id, d->from_id),
-                std::max(d->to_id, d->from_id)));
+            MOLA_PROFILED_LOCK(
+                lck, lock_profiler_, kf_loaded_in_background_mtx_,
+                "kf_loaded_in_background_mtx_");
+            loaded = kf_loaded_in_background_.erase(id) != 0;
         }
+        // If still queued, it is loaded right now in the critical path:
+        if (loaded)
+            state_.kf_prefetch_hits++;
+        else
+            state_.kf_prefetch_misses++;
     }
-    // Loop closures: just send the one with the smallest distance (in theory,
-    // it *might* be the easiest one to align...)
-    if (!loop_closure_checks.empty())
+    else
     {
-        const auto& d = loop_closure_checks.begin()->second;
+        const auto it = state_.kf_unloaded.find(id);
+        if (it == state_.kf_unloaded.end()) return;  // never unloaded
 
-        worker_pool_past_KFs_.enqueue(
-            &LidarOdometry::doCheckForNonAdjacentKFs, this, d);
-
-        MRPT_LOG_WARN_STREAM(
-            "Attempting to close a loop between KFs #" << d->to_id << " <==> #"
-                                                       << d->from_id);
-        {
-            std::lock_guard<std::mutex> lck(local_pose_graph_mtx);
-            // Mark as already considered for check:
-            state_.local_pose_graph.checked_KF_pairs.insert(std::make_pair(
-                std::min(d->to_id, d->from_id),
-                std::max(d->to_id, d->from_id)));
-        }
+        // It is going to be loaded right now, in the critical path:
+        state_.kf_prefetch_misses++;
+        state_.kf_cloud_bytes[id] = it->second;
+        state_.kf_unloaded.erase(it);
     }
 
-    MRPT_END
+    profiler_.registerUserMeasure(
+        "kf_prefetch.hit_rate",
+        static_cast<double>(state_.kf_prefetch_hits) /
+            (state_.kf_prefetch_hits + state_.kf_prefetch_misses));
+}
+
+void LidarOdometry::readKFPointClouds(ICP_Input& d)
+{
+    accountKFCloudAccess(d.to_id);
+    accountKFCloudAccess(d.from_id);
+
+    MRPT_TODO(
+        "Make a mola-kernel function to make this cleaner and throw "
+        "sensible exception errors if something fails");
+
+    WorldModelEntitiesReadLock wm_lock{*worldmodel_};
+    MOLA_PROFILED_LOCK(
+        lck, lock_profiler_, wm_lock, "worldmodel.entities.read");
+
+    ProfilerEntry tle(profiler_, "checkForNearbyKFs.readPCsFromWorldModel");
+
+    d.to_pc = mrpt::ptr_cast<mp2p_icp::pointcloud_t>::from(
+        worldmodel_->entity_annotations_by_id(d.to_id)
+            .at(ANNOTATION_NAME_PC_LAYERS)
+            .value());
+
+    d.from_pc = mrpt::ptr_cast<mp2p_icp::pointcloud_t>::from(
+        worldmodel_->entity_annotations_by_id(d.from_id)
+            .at(ANNOTATION_NAME_PC_LAYERS)
+            .value());
 }
 
-void LidarOdometry::doCheckForNonAdjacentKFs(ICP_Input::Ptr d)
+void LidarOdometry::doCheckForNonAdjacentKFs(
+    ICP_Input::Ptr d, const ParameterSet& ps)
 {
+    const auto& p = ps.params;
+
     try
     {
         ProfilerEntry tleg(profiler_, "doCheckForNonAdjacentKFs");
+        watchdog_.beat(
+            d->align_kind == AlignKind::LoopClosure ? "loop_closure_icp"
+                                                    : "nearby_align_icp");
 
         // Call ICP:
         ICP_Output icp_out;
@@ -779,7 +2728,7 @@ void LidarOdometry::doCheckForNonAdjacentKFs(ICP_Input::Ptr d)
         {
             // Regular case:
             ProfilerEntry tle(profiler_, "doCheckForNonAdjacentKFs.run_icp");
-            run_one_icp(*d, icp_out);
+            run_one_icp(*d, icp_out, ps);
         }
         else
         {
@@ -788,14 +2737,17 @@ void LidarOdometry::doCheckForNonAdjacentKFs(ICP_Input::Ptr d)
                 profiler_, "doCheckForNonAdjacentKFs.run_icp_loop_closure");
 
             // do a small montecarlo sampling and keep the best attempt:
-            const double std_xyz = params_.max_dist_to_loop_closure * 0.1;
+            const double std_xyz = p.max_dist_to_loop_closure * 0.1;
             const double std_rot = mrpt::DEG2RAD(2.0);
 
             const auto original_guess = d->init_guess_to_wrt_from;
 
             mrpt::random::CRandomGenerator rnd;
 
-            for (size_t i = 0; i < params_.loop_closure_montecarlo_samples; i++)
+            // Only for the best sample, below:
+            d->need_information = false;
+
+            for (size_t i = 0; i < p.loop_closure_montecarlo_samples; i++)
             {
                 d->init_guess_to_wrt_from = original_guess;
                 d->init_guess_to_wrt_from.x += rnd.drawGaussian1D(0, std_xyz);
@@ -804,9 +2756,28 @@ void LidarOdometry::doCheckForNonAdjacentKFs(ICP_Input::Ptr d)
                 d->init_guess_to_wrt_from.yaw += rnd.drawGaussian1D(0, std_rot);
 
                 ICP_Output this_icp_out;
-                run_one_icp(*d, this_icp_out);
+                run_one_icp(*d, this_icp_out, ps);
                 if (this_icp_out.goodness > icp_out.goodness)
                     icp_out = this_icp_out;
+
+                // Don't waste more samples in a degenerate place: every
+                // attempt would be equally unreliable. The best one so far
+                // is kept.
+                if (this_icp_out.degeneracy.is_degenerate)
+                {
+                    MRPT_LOG_DEBUG_STREAM(
+                        "[doCheckForNonAdjacentKFs] Degenerate loop closure "
+                        "#" << d->from_id << " ==> #" << d->to_id
+                            << ": skipping remaining Monte Carlo samples.");
+                    break;
+                }
+            }
+
+            d->need_information = true;
+            if (p.factor_noise_from_information && icp_out.goodness > 0)
+            {
+                ProfilerEntry tle2(profiler_, "run_one_icp.hessian");
+                evaluateAlignmentHessian(*d, icp_out, p);
             }
         }
 
@@ -830,40 +2801,390 @@ void LidarOdometry::doCheckForNonAdjacentKFs(ICP_Input::Ptr d)
             << "%)");
 
         const double goodness_thres =
-            (d->align_kind == AlignKind::LoopClosure
-                 ? params_.min_icp_goodness_lc
-                 : params_.min_icp_goodness);
+            (d->align_kind == AlignKind::LoopClosure ? p.min_icp_goodness_lc
+                                                      : p.min_icp_goodness);
 
         if (icp_goodness > goodness_thres &&
+            !icp_out.degeneracy.is_degenerate &&
             (correction_percent < 0.2 ||
              d->align_kind == AlignKind::LoopClosure))
         {
-            std::future<BackEndBase::AddFactor_Output> factor_out_fut;
-            mola::FactorRelativePose3                  fPose3(
-                d->from_id, d->to_id, rel_pose.asTPose());
+            double var_xyz = -1, var_rot = -1;
+            if (icp_out.has_information)
+            {
+                const auto sigmas =
+                    information_to_max_sigmas(icp_out.information);
+                var_xyz = mrpt::square(sigmas.first);
+                var_rot = mrpt::square(sigmas.second);
+            }
+
+            if (d->align_kind == AlignKind::LoopClosure && p.pcm_enabled)
+            {
+                // Hold it until it can be checked against other closures:
+                LoopClosureVerifier::Candidate c;
+                c.from_id  = d->from_id;
+                c.to_id    = d->to_id;
+                c.rel_pose = rel_pose;
+                c.var_xyz  = var_xyz;
+                c.var_rot  = var_rot;
+
+                bool batch_ready = false;
+                {
+                    MOLA_PROFILED_LOCK(
+                        lck, lock_profiler_, lc_verifier_mtx_,
+                        "lc_verifier_mtx_");
+                    lc_verifier_.add(c);
+                    batch_ready = lc_verifier_.size() >= p.pcm_batch_size;
+                }
+                MRPT_LOG_DEBUG_STREAM(
+                    "Loop closure candidate buffered for PCM: #"
+                    << d->from_id << " <=> #" << d->to_id);
+
+                if (batch_ready) verifyPendingLoopClosures(p);
+            }
+            else
+            {
+                addRelativePoseFactor(
+                    d->from_id, d->to_id, rel_pose, var_xyz, var_rot, p);
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        MRPT_LOG_ERROR_STREAM("Exception:\n" << mrpt::exception_to_str(e));
+    }
+}
+
+void LidarOdometry::evaluateAlignmentHessian(
+    const ICP_Input& in, ICP_Output& out, const Parameters& p)
+{
+    MRPT_START
+
+    AlignmentHessianParameters hp;
+    hp.max_points_per_layer = p.degeneracy_max_points_per_layer;
+    hp.max_pair_distance    = p.degeneracy_max_pair_distance;
+
+    const AlignmentHessian ah = alignment_hessian(
+        *in.from_pc, *in.to_pc, out.found_pose_to_wrt_from.mean, hp);
+
+    if (ah.num_pairings > 0)
+        profiler_.registerUserMeasure(
+            "evaluateAlignmentHessian.cached_normals_ratio",
+            static_cast<double>(ah.num_cached_normals) / ah.num_pairings);
+
+    if (ah.num_pairings >= 6 && p.factor_noise_from_information &&
+        in.need_information)
+    {
+        out.information = alignment_information(ah, p.icp_residual_min_sigma);
+        out.has_information = true;
+    }
+
+    if (!p.degeneracy_check || out.degeneracy.evaluated) return;
+
+    auto& dg        = out.degeneracy;
+    dg.evaluated    = true;
+    dg.num_pairings = ah.num_pairings;
+
+    // Too few pairings is a failed alignment, not a degenerate geometry:
+    if (ah.num_pairings < 6)
+    {
+        out.goodness = .0;
+        return;
+    }
+
+    const double inv_n = 1.0 / ah.num_pairings;
+
+    const mrpt::math::CMatrixDouble33 H_xyz = ah.H.blockCopy<3, 3>(0, 0);
+    const mrpt::math::CMatrixDouble33 H_rot = ah.H.blockCopy<3, 3>(3, 3);
+
+    std::vector<double> ev;
+    H_xyz.eig_symmetric(dg.eigvec_xyz, ev);
+    for (int i = 0; i < 3; i++) dg.eig_xyz[i] = ev[i] * inv_n;
+
+    H_rot.eig_symmetric(dg.eigvec_rot, ev);
+    for (int i = 0; i < 3; i++) dg.eig_rot[i] = ev[i] * inv_n;
+
+    dg.is_degenerate = dg.eig_xyz[0] < p.degeneracy_min_eig_xyz ||
+                       dg.eig_rot[0] < p.degeneracy_min_eig_rot;
+
+    MRPT_LOG_DEBUG_FMT(
+        "ICP degeneracy: eig_xyz=[%.03f %.03f %.03f] eig_rot=[%.03f %.03f "
+        "%.03f] pairings=%u degenerate=%s",
+        dg.eig_xyz[0], dg.eig_xyz[1], dg.eig_xyz[2], dg.eig_rot[0],
+        dg.eig_rot[1], dg.eig_rot[2],
+        static_cast<unsigned int>(dg.num_pairings),
+        dg.is_degenerate ? "YES" : "no");
+
+    MRPT_END
+}
+
+void LidarOdometry::attachKeyFrame(
+    const BackEndBase::ProposeKF_Output& kf_out, const ProposedKeyFrame& pkf)
+{
+    ASSERT_(kf_out.success);
+    ASSERT_(kf_out.new_kf_id);
+
+    const mola::id_t new_kf_id = kf_out.new_kf_id.value();
+    ASSERT_(new_kf_id != mola::INVALID_ID);
+
+    // Add point cloud to the KF annotations in the map:
+    // Also, add Rendering decorations for the map visualizer:
+    ASSERT_(worldmodel_);
+    watchdog_.beat("writePCsToWorldModel");
+    {
+        WorldModelEntitiesWriteLock wm_lock{*worldmodel_};
+        MOLA_PROFILED_LOCK(
+            lck, lock_profiler_, wm_lock, "worldmodel.entities.write");
+
+        ProfilerEntry tle(
+            profiler_, "doProcessNewObservation.4.writePCsToWorldModel");
+
+        worldmodel_->entity_annotations_by_id(new_kf_id).emplace(
+            std::piecewise_construct,
+            std::forward_as_tuple(ANNOTATION_NAME_PC_LAYERS),
+            std::forward_as_tuple(pkf.points, ANNOTATION_NAME_PC_LAYERS));
+        state_.kf_cloud_bytes[new_kf_id] = pointcloud_bytes(*pkf.points);
+
+        // Also the spatial index for the prefetcher:
+        if (params_.kf_tiles_enabled || params_.kf_prefetch_enabled)
+            kf_tiles_.insert(new_kf_id, pkf.pose, params_.kf_tiles);
+
+        MRPT_TODO("move this render stuff to its a low-prio worker thread?");
+        // No more decorations under memory pressure:
+        if (state_.memory_pressure_level == 0 &&
+            (state_.kf_decor_decim_cnt < 0 ||
+             ++state_.kf_decor_decim_cnt > params_.viz_decor_decimation))
+        {
+            auto obs_render = mrpt::opengl::CSetOfObjects::Create();
 
-            mola::Factor f = std::move(fPose3);
-            factor_out_fut = slam_backend_->addFactor(f);
+            if (auto obs_pc =
+                    dynamic_cast<const mrpt::obs::CObservationPointCloud*>(
+                        pkf.obs.get());
+                obs_pc != nullptr && obs_pc->pointcloud)
+            {
+                state_.kf_decor_decim_cnt = 0;
+
+                obs_pc->pointcloud->renderOptions.point_size =
+                    params_.viz_decor_pointsize;
+                obs_pc->pointcloud->getAs3DObject(obs_render);
+            }
+            else
+            {
+                state_.kf_decor_decim_cnt = 0;
+
+                mrpt::maps::CColouredPointsMap pm;
+                pm.renderOptions.point_size = params_.viz_decor_pointsize;
 
-            // Wait until it's executed:
-            auto factor_out = factor_out_fut.get();
-            ASSERT_(factor_out.success);
-            ASSERT_(
-                factor_out.new_factor_id &&
-                factor_out.new_factor_id != mola::INVALID_FID);
+                if (pm.insertObservationPtr(pkf.obs))
+                    pm.getAs3DObject(obs_render);
+            }
 
-            // Append to local graph as well::
+            if (obs_render)
             {
-                std::lock_guard<std::mutex> lck(local_pose_graph_mtx);
-                state_.local_pose_graph.graph.insertEdgeAtEnd(
-                    d->from_id, d->to_id, rel_pose);
+                worldmodel_->entity_annotations_by_id(new_kf_id).emplace(
+                    std::piecewise_construct,
+                    std::forward_as_tuple("render_decoration"),
+                    std::forward_as_tuple(obs_render, "render_decoration"));
+                // Approximate: one vertex and color per point
+                state_.kf_decor_bytes[new_kf_id] = state_.last_obs_bytes;
             }
+        }
+    }
+    MRPT_LOG_INFO_STREAM("New KF: ID=" << new_kf_id);
 
-            MRPT_LOG_DEBUG_STREAM(
-                "New FactorRelativePose3: #"
-                << d->from_id << " <=> #" << d->to_id
-                << ". rel_pose=" << rel_pose.asString());
+    if (params_.kf_store_raw_observations)
+        storeRawObservation(new_kf_id, pkf.obs);
+
+    if (params_.global_map_enabled)
+    {
+        worker_pool_global_map_.enqueue(
+            [this, new_kf_id, pc = pkf.points, gp = params_.global_map,
+             layers   = params_.global_map_layers,
+             nRefresh = params_.global_map_max_pose_refresh]() {
+                updateGlobalMap(new_kf_id, pc, gp, layers, nRefresh);
+            });
+    }
+
+    // 2) New SE(3) constraint between consecutive Keyframes:
+    if (state_.last_kf != mola::INVALID_ID)
+    {
+        // Important: The "constant velocity model" factor is
+        // automatically added by the SLAM module (if applicable). Here,
+        // all we need to tell it is the SE(3) constraint, and the
+        // KeyFrame timestamp:
+        addRelativePoseFactor(
+            state_.last_kf, new_kf_id, pkf.accum, pkf.accum_var_xyz,
+            pkf.accum_var_rot, params_);
+    }
+    state_.last_kf = new_kf_id;
+
+    if (params_.multi_hypothesis_enabled)
+    {
+        state_.last_kf_points = pkf.points;
+        state_.last_kf_pose   = pkf.pose;
+    }
+}
+
+void LidarOdometry::attachLateKeyFrame()
+{
+    ProposedKeyFrame pkf;
+    {
+        MOLA_PROFILED_LOCK(
+            lck, lock_profiler_, degraded_mtx_, "degraded_mtx_");
+        if (!degraded_pending_kf_.reply.valid() ||
+            degraded_pending_kf_.reply.wait_for(std::chrono::seconds(0)) !=
+                std::future_status::ready)
+            return;
+        pkf                  = std::move(degraded_pending_kf_);
+        degraded_pending_kf_ = {};
+    }
+
+    // The back-end created that KF after all: attach our cloud and the
+    // factor from the last KF to it, as if it had replied in time.
+    try
+    {
+        attachKeyFrame(pkf.reply.get(), pkf);
+
+        // The odometry accumulated meanwhile is now relative to it:
+        state_.accum_since_last_kf = state_.accum_since_last_kf - pkf.accum;
+        state_.accum_var_xyz_since_last_kf = std::max(
+            .0, state_.accum_var_xyz_since_last_kf - pkf.accum_var_xyz);
+        state_.accum_var_rot_since_last_kf = std::max(
+            .0, state_.accum_var_rot_since_last_kf - pkf.accum_var_rot);
+
+        MRPT_LOG_WARN_STREAM(
+            "Late back-end reply: observations attached to KF ID="
+            << state_.last_kf);
+    }
+    catch (const std::exception& e)
+    {
+        MRPT_LOG_WARN_STREAM(
+            "Late back-end reply failed:\n"
+            << mrpt::exception_to_str(e));
+    }
+}
+
+void LidarOdometry::addRelativePoseFactor(
+    id_t from_id, id_t to_id, const mrpt::poses::CPose3D& rel_pose,
+    double var_xyz, double var_rot, const Parameters& p)
+{
+    MRPT_START
+
+    mola::FactorRelativePose3 fPose3(from_id, to_id, rel_pose.asTPose());
+    setFactorNoise(fPose3, var_xyz, var_rot, p);
+
+    mola::Factor f = std::move(fPose3);
+
+    // Their poses in the global map must be refreshed:
+    if (p.global_map_enabled)
+    {
+        MOLA_PROFILED_LOCK(
+            lck, lock_profiler_, global_map_dirty_mtx_,
+            "global_map_dirty_mtx_");
+        global_map_dirty_kfs_.insert(from_id);
+        global_map_dirty_kfs_.insert(to_id);
+    }
+
+    // Don't wait for the back-end: nothing here depends on the factor ID.
+    awaitBackendReply(
+        slam_backend_->addFactor(f),
+        mrpt::format(
+            "FactorRelativePose3 #%u <=> #%u", static_cast<unsigned>(from_id),
+            static_cast<unsigned>(to_id)));
+
+    // Append to local graph as well (merged by the odometry thread):
+    {
+        MOLA_PROFILED_LOCK(
+            lck, lock_profiler_, local_pose_graph_log_mtx_,
+            "local_pose_graph_log_mtx_");
+
+        local_pose_graph_log_.push_back({from_id, to_id, rel_pose});
+    }
+
+    MRPT_LOG_DEBUG_STREAM(
+        "New FactorRelativePose3: #" << from_id << " <=> #" << to_id
+                                     << ". rel_pose=" << rel_pose.asString());
+
+    MRPT_END
+}
+
+void LidarOdometry::mergeLocalPoseGraphLog()
+{
+    auto& new_edges = local_pose_graph_log_merged_;
+    {
+        MOLA_PROFILED_LOCK(
+            lck, lock_profiler_, local_pose_graph_log_mtx_,
+            "local_pose_graph_log_mtx_");
+        new_edges.swap(local_pose_graph_log_);
+    }
+
+    for (const auto& e : new_edges)
+        state_.local_pose_graph.graph.insertEdgeAtEnd(
+            e.from_id, e.to_id, e.rel_pose);
+    new_edges.clear();
+}
+
+void LidarOdometry::awaitBackendReply(
+    std::future<BackEndBase::AddFactor_Output>&& fut, const std::string& what)
+{
+    backend_requests_in_flight_++;
+    profiler_.registerUserMeasure(
+        "backend.requests_in_flight",
+        static_cast<double>(backend_requests_in_flight_));
+
+    auto sfut = fut.share();
+    worker_pool_backend_replies_.enqueue([this, sfut, what]() {
+        try
+        {
+            const auto& out = sfut.get();
+            if (!out.success || !out.new_factor_id ||
+                *out.new_factor_id == mola::INVALID_FID)
+                MRPT_LOG_ERROR_STREAM("Back-end rejected: " << what);
+        }
+        catch (const std::exception& e)
+        {
+            MRPT_LOG_ERROR_STREAM(
+                "Back-end error for: " << what << "\n"
+                                       << mrpt::exception_to_str(e));
+        }
+        backend_requests_in_flight_--;
+    });
+}
+
+void LidarOdometry::verifyPendingLoopClosures(const Parameters& p)
+{
+    try
+    {
+        ProfilerEntry tleg(profiler_, "verifyPendingLoopClosures");
+        watchdog_.beat("verifyPendingLoopClosures");
+
+        MOLA_PROFILED_LOCK(
+            lck_lc, lock_profiler_, lc_verifier_mtx_, "lc_verifier_mtx_");
+        if (lc_verifier_.empty()) return;
+
+        // Current odometry-based estimate of all involved KFs:
+        kf_poses_t kf_poses;
+        if (const auto nodes = std::atomic_load(&local_pose_graph_snapshot_);
+            nodes)
+        {
+            for (const auto id : lc_verifier_.involvedKFs())
+                if (auto it = nodes->find(id); it != nodes->end())
+                    kf_poses[id] = it->second;
         }
+
+        const size_t nCandidates = lc_verifier_.size();
+        const auto   accepted    = lc_verifier_.verify(kf_poses);
+
+        MRPT_LOG_INFO_STREAM(
+            "[PCM] Accepted " << accepted.size() << " out of " << nCandidates
+                              << " loop closure candidates.");
+        profiler_.registerUserMeasure(
+            "verifyPendingLoopClosures.rejected",
+            static_cast<double>(nCandidates - accepted.size()));
+
+        for (const auto& c : accepted)
+            addRelativePoseFactor(
+                c.from_id, c.to_id, c.rel_pose, c.var_xyz, c.var_rot, p);
     }
     catch (const std::exception& e)
     {
@@ -871,12 +3192,46 @@ void LidarOdometry::doCheckForNonAdjacentKFs(ICP_Input::Ptr d)
     }
 }
 
+void LidarOdometry::setFactorNoise(
+    mola::FactorRelativePose3& f, double var_xyz, double var_rot,
+    const Parameters& p) const
+{
+    if (!p.factor_noise_from_information)
+    {
+        f.noise_model_diag_xyz_ = p.factor_sigma_xyz;
+        f.noise_model_diag_rot_ = p.factor_sigma_rot;
+        return;
+    }
+
+    // Unknown (e.g. degenerate) uncertainty: never more confident than the
+    // worst alignment with a known one.
+    if (var_xyz < 0 || var_rot < 0)
+    {
+        f.noise_model_diag_xyz_ = p.factor_sigma_xyz_max;
+        f.noise_model_diag_rot_ = p.factor_sigma_rot_max;
+        return;
+    }
+
+    f.noise_model_diag_xyz_ = mrpt::saturate_val(
+        std::sqrt(var_xyz), p.factor_sigma_xyz_min, p.factor_sigma_xyz_max);
+    f.noise_model_diag_rot_ = mrpt::saturate_val(
+        std::sqrt(var_rot), p.factor_sigma_rot_min, p.factor_sigma_rot_max);
+}
+
 void LidarOdometry::run_one_icp(const ICP_Input& in, ICP_Output& out)
+{
+    run_one_icp(in, out, *activeParameters());
+}
+
+void LidarOdometry::run_one_icp(
+    const ICP_Input& in, ICP_Output& out, const ParameterSet& ps)
 {
     using namespace std::string_literals;
 
     MRPT_START
 
+    const auto& p = ps.params;
+
     {
         ProfilerEntry tle(profiler_, "run_one_icp");
 
@@ -891,9 +3246,9 @@ void LidarOdometry::run_one_icp(const ICP_Input& in, ICP_Output& out)
             mrpt::keep_max(largest_pc_count, layer.second->size());
 
         unsigned int decim = 1;
-        if (params_.decimate_to_point_count > 0)
+        if (p.decimate_to_point_count > 0)
             decim = static_cast<unsigned>(
-                largest_pc_count / params_.decimate_to_point_count);
+                largest_pc_count / p.decimate_to_point_count);
         if (decim < 1) decim = 1;
 
         mrpt::math::TPose3D current_solution = in.init_guess_to_wrt_from;
@@ -904,9 +3259,25 @@ void LidarOdometry::run_one_icp(const ICP_Input& in, ICP_Output& out)
             "MRPT ICP: max point count=" << largest_pc_count
                                          << " decimation=" << decim);
 
-        params_.icp.at(in.align_kind)
-            .icp->align(
+        // Loop closures always use the generic (double precision) ICP:
+        if (in.align_kind == AlignKind::LidarOdometry && ps.fast_path)
+        {
+            ps.fast_path->align(
+                pcs_from, pcs_to, current_solution, in.icp_params, icp_result);
+        }
+        else if (
+            in.align_kind == AlignKind::NearbyAlign && ps.fast_path_nearby)
+        {
+            ps.fast_path_nearby->align(
                 pcs_from, pcs_to, current_solution, in.icp_params, icp_result);
+        }
+        else
+        {
+            p.icp.at(in.align_kind)
+                .icp->align(
+                    pcs_from, pcs_to, current_solution, in.icp_params,
+                    icp_result);
+        }
 
         if (icp_result.quality > 0)
         {
@@ -926,19 +3297,26 @@ void LidarOdometry::run_one_icp(const ICP_Input& in, ICP_Output& out)
             static_cast<unsigned int>(icp_result.terminationReason));
 
         // Check quality of match:
-        MRPT_TODO("Impl. finite differences based Hessian check");
+        if ((p.degeneracy_check ||
+             (p.factor_noise_from_information && in.need_information)) &&
+            icp_result.quality > 0)
+        {
+            ProfilerEntry tle2(profiler_, "run_one_icp.hessian");
+            evaluateAlignmentHessian(in, out, p);
+        }
     }
 
     // -------------------------------------------------
     MRPT_TODO("Move this to its own method");
 
     // Save debug files for debugging ICP quality
-    bool gen_debug = (in.align_kind == AlignKind::LidarOdometry &&
-                      params_.debug_save_lidar_odometry) ||
-                     (in.align_kind == AlignKind::NearbyAlign &&
-                      params_.debug_save_extra_edges) ||
-                     (in.align_kind == AlignKind::LoopClosure &&
-                      params_.debug_save_loop_closures);
+    bool gen_debug = !warming_up_ &&
+                     ((in.align_kind == AlignKind::LidarOdometry &&
+                       p.debug_save_lidar_odometry) ||
+                      (in.align_kind == AlignKind::NearbyAlign &&
+                       p.debug_save_extra_edges) ||
+                      (in.align_kind == AlignKind::LoopClosure &&
+                       p.debug_save_loop_closures));
 
     if (gen_debug)
     {
@@ -0,0 +1,120 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   LockProfiler.cpp
+ * @brief  Wait/hold time statistics of instrumented locks
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+
+#include <mola-fe-lidar/LockProfiler.h>
+
+#include <mrpt/core/bits_math.h>
+#include <mrpt/core/format.h>
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <vector>
+
+using namespace mola;
+
+void LockProfiler::Distribution::add(double seconds)
+{
+    const double us  = seconds * 1e6;
+    size_t       bin = 0;
+    if (us >= 1.0)
+        bin = std::min<size_t>(
+            NUM_BINS - 1, 1 + static_cast<size_t>(std::log2(us)));
+    bins[bin]++;
+    sum += seconds;
+    mrpt::keep_max(max, seconds);
+}
+
+double LockProfiler::Distribution::quantile(double q, uint64_t count) const
+{
+    if (count == 0) return .0;
+    const auto target = static_cast<uint64_t>(std::ceil(q * count));
+    uint64_t   accum  = 0;
+    for (size_t i = 0; i < NUM_BINS; i++)
+    {
+        accum += bins[i];
+        // Report the upper edge of the bin:
+        if (accum >= target) return std::min(max, std::ldexp(1.0, i) * 1e-6);
+    }
+    return max;
+}
+
+void LockProfiler::record(
+    const char* section, const char* file, int line, double wait_s,
+    double hold_s)
+{
+    // Keep the file name only:
+    std::string site = file;
+    if (const auto p = site.find_last_of("/\\"); p != std::string::npos)
+        site = site.substr(p + 1);
+    site += ":" + std::to_string(line);
+
+    std::lock_guard<std::mutex> lck(mtx_);
+    auto&                       s = stats_[section];
+    s.count++;
+    s.wait.add(wait_s);
+    s.hold.add(hold_s);
+    s.hold_by_site[site] += hold_s;
+}
+
+bool LockProfiler::empty() const
+{
+    std::lock_guard<std::mutex> lck(mtx_);
+    return stats_.empty();
+}
+
+void LockProfiler::clear()
+{
+    std::lock_guard<std::mutex> lck(mtx_);
+    stats_.clear();
+}
+
+std::string LockProfiler::report(size_t top_n) const
+{
+    std::lock_guard<std::mutex> lck(mtx_);
+
+    std::vector<const std::pair<const std::string, Stats>*> sorted;
+    for (const auto& s : stats_) sorted.push_back(&s);
+    std::sort(sorted.begin(), sorted.end(), [](auto a, auto b) {
+        return a->second.wait.sum > b->second.wait.sum;
+    });
+    if (sorted.size() > top_n) sorted.resize(top_n);
+
+    std::stringstream ss;
+    ss << "Lock contention report (times in ms; top sections by total "
+          "wait):\n";
+    ss << mrpt::format(
+        "%-40s %8s %10s %8s %8s %8s %8s %8s\n", "Section", "Count",
+        "Wait total", "Wait p50", "Wait p99", "Wait max", "Hold avg",
+        "Hold max");
+    for (const auto* p : sorted)
+    {
+        const auto& s = p->second;
+        ss << mrpt::format(
+            "%-40s %8lu %10.3f %8.3f %8.3f %8.3f %8.3f %8.3f\n",
+            p->first.c_str(), static_cast<unsigned long>(s.count),
+            1e3 * s.wait.sum, 1e3 * s.wait.quantile(0.5, s.count),
+            1e3 * s.wait.quantile(0.99, s.count), 1e3 * s.wait.max,
+            1e3 * s.hold.sum / std::max<uint64_t>(1, s.count),
+            1e3 * s.hold.max);
+
+        // The call site holding it the longest:
+        const auto it = std::max_element(
+            s.hold_by_site.begin(), s.hold_by_site.end(),
+            [](const auto& a, const auto& b) { return a.second < b.second; });
+        if (it != s.hold_by_site.end())
+            ss << mrpt::format(
+                "    top holder: %s (%.3f ms total)\n", it->first.c_str(),
+                1e3 * it->second);
+    }
+    return ss.str();
+}
@@ -0,0 +1,191 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   LoopClosureVerifier.cpp
+ * @brief  Pairwise consistency maximization (PCM) for loop closure batches
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+
+#include <mola-fe-lidar/LoopClosureVerifier.h>
+
+#include <mrpt/poses/Lie/SE.h>
+#include <mrpt/system/datetime.h>
+
+#include <algorithm>
+
+using namespace mola;
+
+void LoopClosureVerifier::add(const Candidate& c)
+{
+    candidates_.push_back(c);
+    if (candidates_.back().added_at == mrpt::Clock::time_point())
+        candidates_.back().added_at = mrpt::Clock::now();
+}
+
+double LoopClosureVerifier::oldestAge() const
+{
+    if (candidates_.empty()) return .0;
+
+    auto oldest = candidates_.front().added_at;
+    for (const auto& c : candidates_) oldest = std::min(oldest, c.added_at);
+
+    return mrpt::system::timeDifference(oldest, mrpt::Clock::now());
+}
+
+std::set<id_t> LoopClosureVerifier::involvedKFs() const
+{
+    std::set<id_t> ids;
+    for (const auto& c : candidates_)
+    {
+        ids.insert(c.from_id);
+        ids.insert(c.to_id);
+    }
+    return ids;
+}
+
+std::vector<LoopClosureVerifier::Candidate> LoopClosureVerifier::verify(
+    const std::map<id_t, mrpt::poses::CPose3D>& kf_poses)
+{
+    std::vector<Candidate> cands;
+    cands.swap(candidates_);
+
+    // Discard those we cannot evaluate:
+    cands.erase(
+        std::remove_if(
+            cands.begin(), cands.end(),
+            [&](const Candidate& c) {
+                return !kf_poses.count(c.from_id) || !kf_poses.count(c.to_id);
+            }),
+        cands.end());
+
+    const size_t N = cands.size();
+    if (N < params.min_clique_size) return {};
+
+    // Build the consistency graph:
+    std::vector<std::vector<bool>> adj(N, std::vector<bool>(N, false));
+    for (size_t i = 0; i < N; i++)
+    {
+        const auto& ci  = cands[i];
+        const auto& Pai = kf_poses.at(ci.from_id);
+        const auto& Pbi = kf_poses.at(ci.to_id);
+
+        for (size_t j = i + 1; j < N; j++)
+        {
+            const auto& cj  = cands[j];
+            const auto& Paj = kf_poses.at(cj.from_id);
+            const auto& Pbj = kf_poses.at(cj.to_id);
+
+            // Cycle: a_i -> b_i -> b_j -> a_j -> a_i
+            const mrpt::poses::CPose3D err = ci.rel_pose + (Pbj - Pbi) +
+                                             (-cj.rel_pose) + (Pai - Paj);
+
+            const double err_xyz = err.norm();
+            const double err_rot = mrpt::poses::Lie::SE<3>::log(err)
+                                       .blockCopy<3, 1>(3, 0)
+                                       .norm();
+
+            adj[i][j] = adj[j][i] =
+                (err_xyz <= params.max_error_xyz &&
+                 err_rot <= params.max_error_rot);
+        }
+    }
+
+    const auto clique = maximum_clique(adj);
+    if (clique.size() < params.min_clique_size) return {};
+
+    std::vector<Candidate> accepted;
+    accepted.reserve(clique.size());
+    for (const auto idx : clique) accepted.push_back(cands[idx]);
+
+    return accepted;
+}
+
+namespace
+{
+struct MaxCliqueSolver
+{
+    const std::vector<std::vector<bool>>& adj;
+    std::vector<size_t>                   best, current;
+
+    explicit MaxCliqueSolver(const std::vector<std::vector<bool>>& a) : adj(a)
+    {
+    }
+
+    // Greedy sequential coloring. On output, vertices are sorted by color,
+    // so colors[i] is an upper bound of the clique size within order[0:i].
+    void colorSort(
+        const std::vector<size_t>& P, std::vector<size_t>& order,
+        std::vector<size_t>& colors) const
+    {
+        std::vector<std::vector<size_t>> classes;
+        for (const auto v : P)
+        {
+            size_t k = 0;
+            for (; k < classes.size(); k++)
+            {
+                const auto& cl = classes[k];
+                if (std::none_of(cl.begin(), cl.end(), [&](size_t u) {
+                        return adj[v][u];
+                    }))
+                    break;
+            }
+            if (k == classes.size()) classes.emplace_back();
+            classes[k].push_back(v);
+        }
+        order.clear();
+        colors.clear();
+        for (size_t k = 0; k < classes.size(); k++)
+            for (const auto v : classes[k])
+            {
+                order.push_back(v);
+                colors.push_back(k + 1);
+            }
+    }
+
+    void expand(const std::vector<size_t>& P)
+    {
+        std::vector<size_t> order, colors;
+        colorSort(P, order, colors);
+
+        for (size_t i = order.size(); i-- > 0;)
+        {
+            // Bound: cannot beat the best one found so far:
+            if (current.size() + colors[i] <= best.size()) return;
+
+            const auto v = order[i];
+            current.push_back(v);
+
+            std::vector<size_t> newP;
+            for (size_t j = 0; j < i; j++)
+                if (adj[v][order[j]]) newP.push_back(order[j]);
+
+            if (newP.empty())
+            {
+                if (current.size() > best.size()) best = current;
+            }
+            else
+                expand(newP);
+
+            current.pop_back();
+        }
+    }
+};
+}  // namespace
+
+std::vector<size_t> mola::maximum_clique(
+    const std::vector<std::vector<bool>>& adj)
+{
+    MaxCliqueSolver solver(adj);
+
+    std::vector<size_t> P(adj.size());
+    for (size_t i = 0; i < P.size(); i++) P[i] = i;
+
+    solver.expand(P);
+
+    std::sort(solver.best.begin(), solver.best.end());
+    return solver.best;
+}
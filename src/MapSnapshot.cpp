@@ -0,0 +1,80 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   MapSnapshot.cpp
+ * @brief  On-disk snapshot of the KFs of a front-end map
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+
+#include <mola-fe-lidar/MapSnapshot.h>
+#include <mrpt/core/exceptions.h>
+#include <mrpt/io/CFileGZInputStream.h>
+#include <mrpt/io/CFileGZOutputStream.h>
+#include <mrpt/serialization/CArchive.h>
+#include <mrpt/serialization/stl_serialization.h>
+
+using namespace mola;
+
+static const std::string MAP_SNAPSHOT_MAGIC   = "mola-fe-lidar-map";
+static const uint8_t     MAP_SNAPSHOT_VERSION = 0;
+
+void MapSnapshot::save(const std::string& file) const
+{
+    MRPT_START
+
+    mrpt::io::CFileGZOutputStream f;
+    if (!f.open(file))
+        THROW_EXCEPTION_FMT("Cannot create file: `%s`", file.c_str());
+
+    auto arch = mrpt::serialization::archiveFrom(f);
+    arch << MAP_SNAPSHOT_MAGIC << MAP_SNAPSHOT_VERSION;
+    arch.WriteAs<uint64_t>(keyframes.size());
+
+    for (const auto& kf : keyframes)
+    {
+        ASSERT_(kf.pc);
+        arch.WriteAs<uint64_t>(kf.id);
+        arch << kf.session << kf.pose << *kf.pc;
+        arch << kf.descriptor.num_rings << kf.descriptor.num_sectors
+             << kf.descriptor.cells;
+    }
+
+    MRPT_END
+}
+
+void MapSnapshot::load(const std::string& file)
+{
+    MRPT_START
+
+    mrpt::io::CFileGZInputStream f;
+    if (!f.open(file))
+        THROW_EXCEPTION_FMT("Cannot open file: `%s`", file.c_str());
+
+    auto        arch = mrpt::serialization::archiveFrom(f);
+    std::string magic;
+    uint8_t     version;
+    arch >> magic >> version;
+    if (magic != MAP_SNAPSHOT_MAGIC)
+        THROW_EXCEPTION_FMT("Not a map snapshot file: `%s`", file.c_str());
+    if (version > MAP_SNAPSHOT_VERSION)
+        THROW_EXCEPTION_FMT(
+            "Unsupported map snapshot version %u in `%s`",
+            static_cast<unsigned>(version), file.c_str());
+
+    keyframes.clear();
+    keyframes.resize(arch.ReadAs<uint64_t>());
+    for (auto& kf : keyframes)
+    {
+        kf.id = arch.ReadAs<uint64_t>();
+        arch >> kf.session >> kf.pose;
+        kf.pc = arch.ReadObject<mp2p_icp::pointcloud_t>();
+        arch >> kf.descriptor.num_rings >> kf.descriptor.num_sectors >>
+            kf.descriptor.cells;
+    }
+
+    MRPT_END
+}
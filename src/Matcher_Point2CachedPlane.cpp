@@ -0,0 +1,88 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   Matcher_Point2CachedPlane.cpp
+ * @brief  Point-to-plane ICP matcher reusing the normals cached in KFs
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+
+#include "Matcher_Point2CachedPlane.h"
+#include "PointCloudNormals.h"
+
+#include <mrpt/core/bits_math.h>
+#include <mrpt/core/exceptions.h>
+
+#include <algorithm>
+
+using namespace mola;
+
+IMPLEMENTS_MRPT_OBJECT(Matcher_Point2CachedPlane, mp2p_icp::Matcher, mola)
+
+void Matcher_Point2CachedPlane::initialize(
+    const mrpt::containers::yaml& params)
+{
+    MRPT_START
+
+    distanceThreshold = params["distanceThreshold"].as<double>();
+    maxPointsPerLayer =
+        params.getOrDefault<unsigned int>("maxPointsPerLayer", 0);
+
+    ASSERT_GT_(distanceThreshold, .0);
+
+    MRPT_END
+}
+
+void Matcher_Point2CachedPlane::match(
+    const mp2p_icp::pointcloud_t& pcGlobal,
+    const mp2p_icp::pointcloud_t& pcLocal,
+    const mrpt::poses::CPose3D& localPose, mp2p_icp::Pairings& out) const
+{
+    MRPT_START
+
+    if (pcGlobal.planes.empty()) return;
+
+    const float max_dist_sqr = mrpt::square(distanceThreshold);
+
+    for (const auto& glLayer : pcGlobal.point_layers)
+    {
+        const auto itLocal = pcLocal.point_layers.find(glLayer.first);
+        if (itLocal == pcLocal.point_layers.end()) continue;
+        if (!glLayer.second || !itLocal->second) continue;
+
+        const auto& ptsGlobal = *glLayer.second;
+        const auto& ptsLocal  = *itLocal->second;
+        if (ptsGlobal.empty() || ptsLocal.empty()) continue;
+
+        const auto& lxs = ptsLocal.getPointsBufferRef_x();
+        const auto& lys = ptsLocal.getPointsBufferRef_y();
+        const auto& lzs = ptsLocal.getPointsBufferRef_z();
+
+        const size_t N     = ptsLocal.size();
+        const size_t decim = std::max<size_t>(
+            1, maxPointsPerLayer ? N / maxPointsPerLayer : 1);
+
+        for (size_t i = 0; i < N; i += decim)
+        {
+            double gx, gy, gz;
+            localPose.composePoint(lxs[i], lys[i], lzs[i], gx, gy, gz);
+
+            float cx, cy, cz, dist_sqr;
+            ptsGlobal.kdTreeClosestPoint3D(gx, gy, gz, cx, cy, cz, dist_sqr);
+            if (dist_sqr > max_dist_sqr) continue;
+
+            const auto* pl = find_plane_patch(pcGlobal.planes, cx, cy, cz);
+            if (!pl) continue;
+
+            mp2p_icp::point_plane_pair_t pair;
+            pair.pl_global = *pl;
+            pair.pt_local  = mrpt::math::TPoint3Df(lxs[i], lys[i], lzs[i]);
+            out.paired_pt2pl.push_back(pair);
+        }
+    }
+
+    MRPT_END
+}
@@ -0,0 +1,51 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   Matcher_Point2CachedPlane.h
+ * @brief  Point-to-plane ICP matcher reusing the normals cached in KFs
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+#pragma once
+
+#include <mp2p_icp/Matcher.h>
+
+namespace mola
+{
+/** Point-to-plane matcher which, unlike mp2p_icp::Matcher_Point2Plane, does
+ * not fit any plane: each "local" point is paired with its closest "global"
+ * point of the same layer, and the pairing is only kept if that point has a
+ * plane patch in `pcGlobal.planes`, as cached by
+ * LidarOdometry::estimateKFNormals() (`kf_compute_normals: true`).
+ *
+ * Global clouds without cached planes produce no pairings, so this matcher
+ * is meant to be combined with a point-to-point one.
+ *
+ * Parameters (YAML):
+ * - `distanceThreshold`: maximum distance to the closest point [m].
+ * - `maxPointsPerLayer`: decimate local layers down to this many points
+ *   (0: use all of them).
+ */
+class Matcher_Point2CachedPlane : public mp2p_icp::Matcher
+{
+    DEFINE_MRPT_OBJECT(Matcher_Point2CachedPlane, mola)
+
+   public:
+    Matcher_Point2CachedPlane() = default;
+
+    void initialize(const mrpt::containers::yaml& params) override;
+
+    void match(
+        const mp2p_icp::pointcloud_t& pcGlobal,
+        const mp2p_icp::pointcloud_t& pcLocal,
+        const mrpt::poses::CPose3D&   localPose,
+        mp2p_icp::Pairings&           out) const override;
+
+    double       distanceThreshold{0.5};
+    unsigned int maxPointsPerLayer{0};
+};
+
+}  // namespace mola
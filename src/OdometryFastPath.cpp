@@ -0,0 +1,73 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   OdometryFastPath.cpp
+ * @brief  Statically-dispatched odometry step for common configurations
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+
+#include "OdometryFastPath.h"
+
+#include <mola-lidar-segmentation/FilterEdgesPlanes.h>
+
+using namespace mola;
+
+OdometryFastPathBase::Ptr mola::create_odometry_fast_path(
+    const lidar_segmentation::LidarFilterBase::Ptr& filter,
+    const mrpt::containers::yaml&        icp_cfg,
+    const std::map<std::string, double>& layer_weights)
+{
+    MRPT_START
+
+    if (!icp_cfg.has("icp_class") || !icp_cfg.has("matchers") ||
+        !icp_cfg.has("quality"))
+        return {};
+
+    if (icp_cfg["icp_class"].as<std::string>() !=
+        "mp2p_icp::ICP_Horn_MultiCloud")
+        return {};
+
+    // Robust kernels and the scale outlier detector are not implemented in
+    // the fast path:
+    if (icp_cfg.has("params") &&
+        icp_cfg["params"].has("pairingsWeightParameters"))
+    {
+        const auto& wp = icp_cfg["params"]["pairingsWeightParameters"];
+        if (wp.getOrDefault<bool>("use_robust_kernel", false)) return {};
+        if (wp.getOrDefault<bool>("use_scale_outlier_detector", false))
+            return {};
+    }
+
+    const auto& matchers = icp_cfg["matchers"].asSequence();
+    if (matchers.size() != 1) return {};
+
+    const auto& m = matchers.at(0).asMap();
+    if (m.at("class").as<std::string>() !=
+        "mp2p_icp::Matcher_Points_DistanceThreshold")
+        return {};
+    const double threshold =
+        m.at("params").asMap().at("threshold").as<double>();
+
+    const auto& q = icp_cfg["quality"].asMap();
+    if (q.at("class").as<std::string>() !=
+        "mp2p_icp::QualityEvaluator_PairedRatio")
+        return {};
+
+    // Supported filters:
+    if (auto f = std::dynamic_pointer_cast<
+            lidar_segmentation::FilterEdgesPlanes>(filter);
+        f)
+    {
+        return std::make_shared<
+            OdometryFastPath<lidar_segmentation::FilterEdgesPlanes>>(
+            f, threshold, layer_weights);
+    }
+
+    return {};
+
+    MRPT_END
+}
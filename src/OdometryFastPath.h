@@ -0,0 +1,294 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   OdometryFastPath.h
+ * @brief  Statically-dispatched odometry step for common configurations
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+#pragma once
+
+#include <mola-lidar-segmentation/LidarFilterBase.h>
+#include <mp2p_icp/ICP.h>
+#include <mrpt/containers/yaml.h>
+#include <mrpt/math/CMatrixFixed.h>
+#include <mrpt/math/CQuaternion.h>
+#include <mrpt/obs/CObservation.h>
+#include <mrpt/poses/CPose3D.h>
+#include <mrpt/poses/CPose3DQuat.h>
+#include <mrpt/tfest/se3.h>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mola
+{
+/** Fast path for the per-scan odometry step (filter + ICP), and for
+ * NearbyAlign KF-to-KF alignments. Dispatch happens once per scan through
+ * this interface; everything below is resolved at compile time.
+ */
+class OdometryFastPathBase
+{
+   public:
+    using Ptr = std::shared_ptr<OdometryFastPathBase>;
+
+    virtual ~OdometryFastPathBase() = default;
+
+    virtual void filter(
+        const mrpt::obs::CObservation::Ptr& o, mp2p_icp::pointcloud_t& out) = 0;
+
+    virtual void align(
+        const mp2p_icp::pointcloud_t& pcs_from,
+        const mp2p_icp::pointcloud_t& pcs_to,
+        const mrpt::math::TPose3D&    init_guess,
+        const mp2p_icp::Parameters& p, mp2p_icp::Results& result) = 0;
+
+    /** Human-readable description of the specialization */
+    virtual std::string name() const = 0;
+};
+
+/** Horn's closed-form solution (quaternion method) for the pose of the
+ * "other" points wrt the "this" points, with one weight per pairing.
+ * \return false if there are less than 3 pairings or all weights are 0.
+ */
+inline bool weighted_horn(
+    const mrpt::tfest::TMatchingPairList& pairings,
+    const std::vector<double>& weights, mrpt::poses::CPose3DQuat& out)
+{
+    if (pairings.size() < 3 || weights.size() != pairings.size())
+        return false;
+
+    double W = 0, ct[3] = {0, 0, 0}, co[3] = {0, 0, 0};
+    for (size_t i = 0; i < pairings.size(); i++)
+    {
+        const auto&  pr = pairings[i];
+        const double w  = weights[i];
+        W += w;
+        ct[0] += w * pr.this_x;
+        ct[1] += w * pr.this_y;
+        ct[2] += w * pr.this_z;
+        co[0] += w * pr.other_x;
+        co[1] += w * pr.other_y;
+        co[2] += w * pr.other_z;
+    }
+    if (W <= 0) return false;
+    for (int k = 0; k < 3; k++)
+    {
+        ct[k] /= W;
+        co[k] /= W;
+    }
+
+    // Weighted cross-covariance S(a,b) = sum w * other_a * this_b:
+    mrpt::math::CMatrixDouble33 S;
+    S.setZero();
+    for (size_t i = 0; i < pairings.size(); i++)
+    {
+        const auto&  pr   = pairings[i];
+        const double w    = weights[i];
+        const double o[3] = {pr.other_x - co[0], pr.other_y - co[1],
+                             pr.other_z - co[2]};
+        const double t[3] = {pr.this_x - ct[0], pr.this_y - ct[1],
+                             pr.this_z - ct[2]};
+        for (int a = 0; a < 3; a++)
+            for (int b = 0; b < 3; b++) S(a, b) += w * o[a] * t[b];
+    }
+
+    mrpt::math::CMatrixDouble44 N;
+    N(0, 0) = S(0, 0) + S(1, 1) + S(2, 2);
+    N(0, 1) = N(1, 0) = S(1, 2) - S(2, 1);
+    N(0, 2) = N(2, 0) = S(2, 0) - S(0, 2);
+    N(0, 3) = N(3, 0) = S(0, 1) - S(1, 0);
+    N(1, 1) = S(0, 0) - S(1, 1) - S(2, 2);
+    N(1, 2) = N(2, 1) = S(0, 1) + S(1, 0);
+    N(1, 3) = N(3, 1) = S(2, 0) + S(0, 2);
+    N(2, 2) = -S(0, 0) + S(1, 1) - S(2, 2);
+    N(2, 3) = N(3, 2) = S(1, 2) + S(2, 1);
+    N(3, 3) = -S(0, 0) - S(1, 1) + S(2, 2);
+
+    // The optimal rotation is the eigenvector of the largest eigenvalue:
+    mrpt::math::CMatrixDouble44 eVecs;
+    std::vector<double>         eVals;
+    if (!N.eig_symmetric(eVecs, eVals, true /*sorted*/)) return false;
+
+    mrpt::math::CQuaternionDouble q(
+        eVecs(0, 3), eVecs(1, 3), eVecs(2, 3), eVecs(3, 3));
+    q.normalize();
+
+    mrpt::math::CMatrixDouble33 R;
+    q.rotationMatrixNoResize(R);
+
+    double t[3];
+    for (int a = 0; a < 3; a++)
+        t[a] = ct[a] - (R(a, 0) * co[0] + R(a, 1) * co[1] + R(a, 2) * co[2]);
+    out = mrpt::poses::CPose3DQuat(t[0], t[1], t[2], q);
+    return true;
+}
+
+/** Equivalent to `FILTER_T` followed by mp2p_icp::ICP_Horn_MultiCloud with
+ * a single Matcher_Points_DistanceThreshold and QualityEvaluator_PairedRatio,
+ * with all calls statically bound so the per-point loops get inlined.
+ * Neither the scale-based outlier detector of mp2p_icp nor robust kernels
+ * are implemented, so configurations enabling them are rejected by
+ * create_odometry_fast_path().
+ *
+ * Pairings of the layers in `layer_weights` are weighted in the Horn
+ * solution (those of other layers have weight 1).
+ *
+ */
+template <class FILTER_T>
+class OdometryFastPath : public OdometryFastPathBase
+{
+   public:
+    OdometryFastPath(
+        std::shared_ptr<FILTER_T> filter, double threshold,
+        std::map<std::string, double> layer_weights = {})
+        : filter_(std::move(filter)),
+          threshold_(threshold),
+          layer_weights_(std::move(layer_weights))
+    {
+    }
+
+    void filter(
+        const mrpt::obs::CObservation::Ptr& o,
+        mp2p_icp::pointcloud_t&             out) override
+    {
+        // Qualified call: no virtual dispatch.
+        filter_->FILTER_T::filter(o, out);
+    }
+
+    void align(
+        const mp2p_icp::pointcloud_t& pcs_from,
+        const mp2p_icp::pointcloud_t& pcs_to,
+        const mrpt::math::TPose3D&    init_guess,
+        const mp2p_icp::Parameters& p, mp2p_icp::Results& result) override
+    {
+        mrpt::poses::CPose3D pose(init_guess);
+
+        const float thres_sqr = static_cast<float>(threshold_ * threshold_);
+
+        mrpt::tfest::TMatchingPairList pairings;
+        std::vector<double>            weights;
+        size_t                         nConsidered = 0;
+
+        result.nIterations = 0;
+        result.quality     = 0;
+
+        for (unsigned int iter = 0; iter < p.maxIterations; iter++)
+        {
+            pairings.clear();
+            weights.clear();
+            nConsidered = 0;
+
+            const auto R = pose.getRotationMatrix();
+
+            const double r00 = R(0, 0), r01 = R(0, 1), r02 = R(0, 2),
+                         r10 = R(1, 0), r11 = R(1, 1), r12 = R(1, 2),
+                         r20 = R(2, 0), r21 = R(2, 1), r22 = R(2, 2);
+            const double tx = pose.x(), ty = pose.y(), tz = pose.z();
+
+            for (const auto& layer_to : pcs_to.point_layers)
+            {
+                const auto it_from =
+                    pcs_from.point_layers.find(layer_to.first);
+                if (it_from == pcs_from.point_layers.end()) continue;
+                if (!layer_to.second || !it_from->second) continue;
+
+                const auto& pts_to   = *layer_to.second;
+                const auto& pts_from = *it_from->second;
+                if (pts_to.empty() || pts_from.empty()) continue;
+
+                const auto   it_w = layer_weights_.find(layer_to.first);
+                const double w =
+                    it_w != layer_weights_.end() ? it_w->second : 1.0;
+
+                const auto& xs = pts_to.getPointsBufferRef_x();
+                const auto& ys = pts_to.getPointsBufferRef_y();
+                const auto& zs = pts_to.getPointsBufferRef_z();
+
+                const size_t N     = pts_to.size();
+                const size_t decim = std::max<size_t>(
+                    1, p.maxPairsPerLayer ? N / p.maxPairsPerLayer : 1);
+
+                for (size_t i = 0; i < N; i += decim)
+                {
+                    const double lx = xs[i], ly = ys[i], lz = zs[i];
+                    const float  gx =
+                        static_cast<float>(r00 * lx + r01 * ly + r02 * lz + tx);
+                    const float gy =
+                        static_cast<float>(r10 * lx + r11 * ly + r12 * lz + ty);
+                    const float gz =
+                        static_cast<float>(r20 * lx + r21 * ly + r22 * lz + tz);
+
+                    float        qx, qy, qz, dist_sqr;
+                    const size_t idx = pts_from.kdTreeClosestPoint3D(
+                        gx, gy, gz, qx, qy, qz, dist_sqr);
+                    nConsidered++;
+
+                    if (dist_sqr > thres_sqr) continue;
+
+                    pairings.emplace_back(
+                        static_cast<uint32_t>(idx), static_cast<uint32_t>(i),
+                        qx, qy, qz, xs[i], ys[i], zs[i]);
+                    weights.push_back(w);
+                }
+            }
+
+            result.nIterations = iter + 1;
+            if (pairings.size() < 3) break;
+
+            mrpt::poses::CPose3DQuat new_pose_q;
+            if (layer_weights_.empty())
+            {
+                double scale;
+                if (!mrpt::tfest::se3_l2(pairings, new_pose_q, scale, true))
+                    break;
+            }
+            else if (!weighted_horn(pairings, weights, new_pose_q))
+                break;
+
+            const mrpt::poses::CPose3D new_pose(new_pose_q);
+            const auto                 delta = new_pose - pose;
+
+            pose = new_pose;
+
+            const double step_rot = std::max(
+                {std::abs(delta.yaw()), std::abs(delta.pitch()),
+                 std::abs(delta.roll())});
+            if (delta.norm() < p.minAbsStep_trans &&
+                step_rot < p.minAbsStep_rot)
+                break;
+        }
+
+        result.optimal_tf.mean = pose;
+        result.quality =
+            nConsidered ? static_cast<double>(pairings.size()) / nConsidered
+                        : .0;
+    }
+
+    std::string name() const override
+    {
+        return "ICP_Horn_MultiCloud+Matcher_Points_DistanceThreshold";
+    }
+
+   private:
+    std::shared_ptr<FILTER_T>     filter_;
+    double                        threshold_;
+    std::map<std::string, double> layer_weights_;
+};
+
+/** Returns a fast path implementation if the given configuration (filter
+ * instance and an ICP settings YAML block) matches one of the specialized
+ * combinations, or nullptr otherwise. */
+OdometryFastPathBase::Ptr create_odometry_fast_path(
+    const lidar_segmentation::LidarFilterBase::Ptr& filter,
+    const mrpt::containers::yaml&        icp_cfg,
+    const std::map<std::string, double>& layer_weights = {});
+
+}  // namespace mola
@@ -0,0 +1,111 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   OdometryHypotheses.cpp
+ * @brief  Set of competing lidar odometry trajectories, for ambiguous scenes
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+
+#include <mola-fe-lidar/OdometryHypotheses.h>
+#include <mrpt/core/bits_math.h>
+#include <mrpt/core/exceptions.h>
+#include <mrpt/poses/Lie/SE.h>
+
+#include <algorithm>
+
+using namespace mola;
+
+void OdometryHypotheses::reset(const mrpt::poses::CPose3D& pose)
+{
+    hyps_.clear();
+    auto& h = hyps_.emplace_back();
+    h.pose  = pose;
+    h.id    = next_id_++;
+    best_   = 0;
+
+    ambiguous_steps_ = 0;
+}
+
+void OdometryHypotheses::collapse()
+{
+    if (hyps_.empty()) return;
+
+    const Hypothesis best = hyps_.at(best_);
+    hyps_.assign(1, best);
+    best_ = 0;
+
+    ambiguous_steps_ = 0;
+}
+
+double OdometryHypotheses::stepScore(const Candidate& c, const Parameters& p)
+{
+    const auto err = mrpt::poses::Lie::SE<3>::log(c.increment - c.prior);
+
+    double maha2 = 0;
+    for (int i = 0; i < 6; i++)
+    {
+        const double sigma = i < 3 ? p.prior_sigma_xyz : p.prior_sigma_rot;
+        maha2 += mrpt::square(err[i] / sigma);
+    }
+    return p.goodness_weight * c.goodness - 0.5 * maha2;
+}
+
+void OdometryHypotheses::update(
+    const std::vector<Candidate>& candidates, const Parameters& p)
+{
+    std::vector<Hypothesis> new_hyps;
+    new_hyps.reserve(candidates.size());
+
+    for (const auto& c : candidates)
+    {
+        ASSERT_LT_(c.parent, hyps_.size());
+        const auto& parent = hyps_[c.parent];
+
+        auto& h          = new_hyps.emplace_back();
+        h.pose           = parent.pose + c.increment;
+        h.last_increment = c.increment;
+        h.last_goodness  = c.goodness;
+        h.score          = p.score_decay * parent.score + stepScore(c, p);
+        // The first extension keeps the parent id, the rest are new:
+        const bool id_taken = std::any_of(
+            new_hyps.begin(), new_hyps.end() - 1,
+            [&](const Hypothesis& o) { return o.id == parent.id; });
+        h.id = id_taken ? next_id_++ : parent.id;
+    }
+    if (new_hyps.empty()) return;  // keep the current ones
+
+    std::sort(
+        new_hyps.begin(), new_hyps.end(),
+        [](const Hypothesis& a, const Hypothesis& b) {
+            return a.score > b.score;
+        });
+
+    // Merge (keep the best of each cluster), prune and cap:
+    hyps_.clear();
+    const double best_score = new_hyps.front().score;
+    for (const auto& h : new_hyps)
+    {
+        if (hyps_.size() >= p.max_hypotheses) break;
+        if (h.score < best_score - p.prune_margin) break;
+
+        const bool duplicated =
+            std::any_of(hyps_.begin(), hyps_.end(), [&](const Hypothesis& o) {
+                return o.pose.distanceTo(h.pose) < p.merge_distance;
+            });
+        if (!duplicated) hyps_.push_back(h);
+    }
+    best_ = 0;
+
+    // Scores are relative: keep them bounded.
+    for (auto& h : hyps_) h.score -= best_score;
+
+    // Do not stay ambiguous forever (e.g. in a perfectly uniform tunnel):
+    ambiguous_steps_ = ambiguous() ? ambiguous_steps_ + 1 : 0;
+    if (p.max_ambiguous_steps != 0 &&
+        ambiguous_steps_ >= p.max_ambiguous_steps)
+        collapse();
+}
@@ -0,0 +1,128 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   PlaceDescriptor.cpp
+ * @brief  Compact, yaw-invariant appearance descriptor of a KF point cloud
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+
+#include <mola-fe-lidar/PlaceDescriptor.h>
+#include <mrpt/core/exceptions.h>
+
+#include <cmath>
+#include <limits>
+
+using namespace mola;
+
+PlaceDescriptor PlaceDescriptor::FromPointCloud(
+    const mp2p_icp::pointcloud_t& pc, double max_range)
+{
+    PlaceDescriptor d;
+
+    const size_t NR = d.num_rings, NS = d.num_sectors;
+
+    // Heights are stored relative to the lowest point, so empty cells (0)
+    // are distinguishable from the floor level:
+    std::vector<float> max_z(NR * NS, -std::numeric_limits<float>::max());
+    float              min_z = std::numeric_limits<float>::max();
+
+    for (const auto& layer : pc.point_layers)
+    {
+        if (!layer.second) continue;
+        const auto& xs = layer.second->getPointsBufferRef_x();
+        const auto& ys = layer.second->getPointsBufferRef_y();
+        const auto& zs = layer.second->getPointsBufferRef_z();
+
+        for (size_t i = 0; i < xs.size(); i++)
+        {
+            const double r = std::hypot(xs[i], ys[i]);
+            if (r >= max_range) continue;
+
+            const double ang = std::atan2(ys[i], xs[i]) + M_PI;  // [0,2pi]
+            const auto   ir  = static_cast<size_t>(r / max_range * NR);
+            const auto   is  = std::min(
+                NS - 1, static_cast<size_t>(ang / (2 * M_PI) * NS));
+
+            auto& c = max_z[ir * NS + is];
+            if (zs[i] > c) c = zs[i];
+            if (zs[i] < min_z) min_z = zs[i];
+        }
+    }
+
+    d.cells.assign(NR * NS, .0f);
+    for (size_t i = 0; i < d.cells.size(); i++)
+        if (max_z[i] > -std::numeric_limits<float>::max())
+            d.cells[i] = max_z[i] - min_z;
+
+    return d;
+}
+
+std::vector<float> PlaceDescriptor::ringKey() const
+{
+    const size_t NR = num_rings, NS = num_sectors;
+
+    std::vector<float> key(NR, .0f);
+    if (empty()) return key;
+
+    for (size_t r = 0; r < NR; r++)
+    {
+        size_t n = 0;
+        for (size_t s = 0; s < NS; s++)
+            if (cells[r * NS + s] != 0) n++;
+        key[r] = static_cast<float>(n) / NS;
+    }
+    return key;
+}
+
+double PlaceDescriptor::distance(const PlaceDescriptor& o, double* yaw) const
+{
+    ASSERT_(!empty() && !o.empty());
+    ASSERT_EQUAL_(num_rings, o.num_rings);
+    ASSERT_EQUAL_(num_sectors, o.num_sectors);
+
+    const size_t NR = num_rings, NS = num_sectors;
+
+    double best = std::numeric_limits<double>::max();
+    size_t best_shift = 0;
+
+    for (size_t shift = 0; shift < NS; shift++)
+    {
+        // Mean cosine distance between sector columns (skipping empty ones):
+        double sum_dist = 0;
+        size_t n_cols   = 0;
+        for (size_t s = 0; s < NS; s++)
+        {
+            const size_t so = (s + shift) % NS;
+
+            double dot = 0, n1 = 0, n2 = 0;
+            for (size_t r = 0; r < NR; r++)
+            {
+                const double a = cells[r * NS + s];
+                const double b = o.cells[r * NS + so];
+                dot += a * b;
+                n1 += a * a;
+                n2 += b * b;
+            }
+            if (n1 == 0 || n2 == 0) continue;
+
+            sum_dist += 1.0 - dot / std::sqrt(n1 * n2);
+            n_cols++;
+        }
+        const double dist = n_cols ? sum_dist / n_cols : 1.0;
+        if (dist < best)
+        {
+            best       = dist;
+            best_shift = shift;
+        }
+    }
+
+    // Sector `s` in this descriptor matches `s+shift` in `o`: `o` is
+    // rotated by -shift sectors wrt this one.
+    if (yaw) *yaw = -2 * M_PI * static_cast<double>(best_shift) / NS;
+
+    return best;
+}
@@ -0,0 +1,196 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   PointCloudNormals.cpp
+ * @brief  Per-point local covariance and normal estimation
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+
+#include "PointCloudNormals.h"
+
+#include <mrpt/core/exceptions.h>
+#include <mrpt/math/CMatrixFixed.h>
+
+#include <algorithm>
+#include <future>
+
+using namespace mola;
+
+bool mola::fit_local_plane(
+    const mrpt::maps::CPointsMap& pts, const std::vector<size_t>& idxs,
+    LocalPlaneFit& out)
+{
+    const size_t n = idxs.size();
+    if (n < 3) return false;
+
+    const auto& xs = pts.getPointsBufferRef_x();
+    const auto& ys = pts.getPointsBufferRef_y();
+    const auto& zs = pts.getPointsBufferRef_z();
+
+    // Mean and 2nd order moments, in a single pass over the contiguous
+    // coordinate buffers:
+    double mx = 0, my = 0, mz = 0;
+    double sxx = 0, syy = 0, szz = 0, sxy = 0, sxz = 0, syz = 0;
+    for (const size_t k : idxs)
+    {
+        const double x = xs[k], y = ys[k], z = zs[k];
+        mx += x;
+        my += y;
+        mz += z;
+        sxx += x * x;
+        syy += y * y;
+        szz += z * z;
+        sxy += x * y;
+        sxz += x * z;
+        syz += y * z;
+    }
+    const double inv_n = 1.0 / n;
+    mx *= inv_n;
+    my *= inv_n;
+    mz *= inv_n;
+
+    mrpt::math::CMatrixDouble33 cov, eig_vecs;
+    cov(0, 0) = sxx * inv_n - mx * mx;
+    cov(1, 1) = syy * inv_n - my * my;
+    cov(2, 2) = szz * inv_n - mz * mz;
+    cov(0, 1) = cov(1, 0) = sxy * inv_n - mx * my;
+    cov(0, 2) = cov(2, 0) = sxz * inv_n - mx * mz;
+    cov(1, 2) = cov(2, 1) = syz * inv_n - my * mz;
+
+    // Sorted eigenvalues, in ascending order:
+    std::vector<double> eig_vals;
+    cov.eig_symmetric(eig_vecs, eig_vals);
+
+    out.mean   = mrpt::math::TPoint3D(mx, my, mz);
+    out.normal = mrpt::math::TVector3D(
+        eig_vecs(0, 0), eig_vecs(1, 0), eig_vecs(2, 0));
+    for (int i = 0; i < 3; i++) out.eig[i] = eig_vals[i];
+    return true;
+}
+
+static bool centroid_less(
+    const mrpt::math::TPoint3D& a, const mrpt::math::TPoint3D& b)
+{
+    if (a.x != b.x) return a.x < b.x;
+    if (a.y != b.y) return a.y < b.y;
+    return a.z < b.z;
+}
+
+void mola::sort_plane_patches(std::vector<mp2p_icp::plane_patch_t>& planes)
+{
+    std::sort(
+        planes.begin(), planes.end(),
+        [](const mp2p_icp::plane_patch_t& a, const mp2p_icp::plane_patch_t& b) {
+            return centroid_less(a.centroid, b.centroid);
+        });
+}
+
+const mp2p_icp::plane_patch_t* mola::find_plane_patch(
+    const std::vector<mp2p_icp::plane_patch_t>& sorted_planes, float x,
+    float y, float z)
+{
+    // Centroids are the (float) cloud points themselves, so they compare
+    // exactly equal once promoted to double:
+    const mrpt::math::TPoint3D pt(x, y, z);
+
+    const auto it = std::lower_bound(
+        sorted_planes.begin(), sorted_planes.end(), pt,
+        [](const mp2p_icp::plane_patch_t& a, const mrpt::math::TPoint3D& b) {
+            return centroid_less(a.centroid, b);
+        });
+    if (it == sorted_planes.end() || it->centroid != pt) return nullptr;
+    return &(*it);
+}
+
+static void normals_chunk(
+    const mrpt::maps::CPointsMap& pts, const NormalsEstimationParameters& p,
+    const size_t idx_start, const size_t idx_end,
+    std::vector<mp2p_icp::plane_patch_t>& out)
+{
+    const auto& xs = pts.getPointsBufferRef_x();
+    const auto& ys = pts.getPointsBufferRef_y();
+    const auto& zs = pts.getPointsBufferRef_z();
+
+    std::vector<size_t> nn_idx;
+    std::vector<float>  nn_dist_sqr;
+    nn_idx.reserve(p.knn);
+    nn_dist_sqr.reserve(p.knn);
+
+    LocalPlaneFit fit;
+
+    for (size_t i = idx_start; i < idx_end; i += p.decimation)
+    {
+        pts.kdTreeNClosestPoint3DIdx(
+            xs[i], ys[i], zs[i], p.knn, nn_idx, nn_dist_sqr);
+
+        if (!fit_local_plane(pts, nn_idx, fit)) continue;
+
+        if (fit.eig[1] <= 0 || fit.eig[0] > p.max_e0_e1 * fit.eig[1])
+            continue;  // Not planar
+
+        mp2p_icp::plane_patch_t pp;
+        pp.centroid = mrpt::math::TPoint3D(xs[i], ys[i], zs[i]);
+        pp.plane    = mrpt::math::TPlane(fit.mean, fit.normal);
+        out.push_back(pp);
+    }
+}
+
+void mola::estimate_point_normals(
+    const mrpt::maps::CPointsMap& pts, const NormalsEstimationParameters& p,
+    mrpt::WorkerThreadsPool&               pool,
+    std::vector<mp2p_icp::plane_patch_t>& out_planes)
+{
+    MRPT_START
+
+    ASSERT_GE_(p.knn, 3U);
+    ASSERT_GE_(p.decimation, 1U);
+
+    const size_t N = pts.size();
+    if (N < p.knn) return;
+
+    // Force building the KD-tree now, from this thread, so the workers only
+    // perform (const) queries on it:
+    {
+        float  dx, dy, dz, dist_sqr;
+        size_t dummy_idx = pts.kdTreeClosestPoint3D(
+            0, 0, 0, dx, dy, dz, dist_sqr);
+        (void)dummy_idx;
+    }
+
+    const size_t nChunks = std::max<size_t>(1, p.num_chunks);
+    // Chunk sizes are kept a multiple of the decimation, so the result does
+    // not depend on the number of chunks:
+    size_t chunk_len = (N + nChunks - 1) / nChunks;
+    chunk_len        = ((chunk_len + p.decimation - 1) / p.decimation) *
+                p.decimation;
+
+    std::vector<std::vector<mp2p_icp::plane_patch_t>> partial(nChunks);
+    std::vector<std::future<void>>                    futs;
+
+    for (size_t c = 0; c < nChunks; c++)
+    {
+        const size_t i0 = c * chunk_len;
+        const size_t i1 = std::min(N, i0 + chunk_len);
+        if (i0 >= i1) break;
+
+        futs.emplace_back(pool.enqueue(
+            [&pts, &p, i0, i1, &partial, c]() {
+                partial[c].reserve((i1 - i0) / p.decimation + 1);
+                normals_chunk(pts, p, i0, i1, partial[c]);
+            }));
+    }
+    for (auto& f : futs) f.get();
+
+    size_t total = 0;
+    for (const auto& v : partial) total += v.size();
+    out_planes.reserve(out_planes.size() + total);
+
+    for (const auto& v : partial)
+        out_planes.insert(out_planes.end(), v.begin(), v.end());
+
+    MRPT_END
+}
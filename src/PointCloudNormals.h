@@ -0,0 +1,87 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   PointCloudNormals.h
+ * @brief  Per-point local covariance and normal estimation
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+#pragma once
+
+#include <mp2p_icp/pointcloud.h>
+#include <mrpt/core/WorkerThreadsPool.h>
+#include <mrpt/maps/CPointsMap.h>
+#include <mrpt/math/TPoint3D.h>
+
+#include <vector>
+
+namespace mola
+{
+struct NormalsEstimationParameters
+{
+    /** Number of nearest neighbors used to build each local covariance */
+    unsigned int knn{10};
+
+    /** Only process one out of each N points */
+    unsigned int decimation{1};
+
+    /** A local covariance is considered "planar" (and hence, a normal is
+     * defined) if its smallest eigenvalue is below this ratio of the middle
+     * one: e0 < max_e0_e1 * e1 */
+    double max_e0_e1{0.1};
+
+    /** Number of chunks in which the cloud is split to run in parallel */
+    unsigned int num_chunks{4};
+};
+
+/** Result of fit_local_plane() */
+struct LocalPlaneFit
+{
+    /** Mean of the neighborhood */
+    mrpt::math::TPoint3D mean;
+
+    /** Unit normal: eigenvector of the smallest eigenvalue */
+    mrpt::math::TVector3D normal;
+
+    /** Eigenvalues of the covariance, in ascending order */
+    double eig[3] = {.0, .0, .0};
+};
+
+/** Fits a plane to the points of `pts` with indices `idxs` (at least 3) from
+ * their mean and covariance. Returns false if there are too few points. */
+bool fit_local_plane(
+    const mrpt::maps::CPointsMap& pts, const std::vector<size_t>& idxs,
+    LocalPlaneFit& out);
+
+/** Sorts plane patches by their centroid (x,y,z), as required by
+ * find_plane_patch() */
+void sort_plane_patches(std::vector<mp2p_icp::plane_patch_t>& planes);
+
+/** Binary search of the plane patch whose centroid is exactly the point
+ * (x,y,z) of a cloud, in a vector sorted with sort_plane_patches().
+ * Returns nullptr if that point has no cached plane. */
+const mp2p_icp::plane_patch_t* find_plane_patch(
+    const std::vector<mp2p_icp::plane_patch_t>& sorted_planes, float x,
+    float y, float z);
+
+/** Estimates the local covariance around each point in `pts` from its `knn`
+ * nearest neighbors, and appends one plane patch (centroid=the point itself,
+ * plane normal=eigenvector of the smallest eigenvalue) for each point whose
+ * neighborhood is planar enough.
+ *
+ * Plane patches are all a point-to-plane matcher needs, and also suffice for
+ * GICP-like matching, where local covariances are rebuilt from the normal as
+ * diag(eps,1,1) in the plane frame.
+ *
+ * The cloud is split in chunks which are processed in `pool`.
+ * This method must not be called from a task already running in `pool`.
+ */
+void estimate_point_normals(
+    const mrpt::maps::CPointsMap& pts, const NormalsEstimationParameters& p,
+    mrpt::WorkerThreadsPool&               pool,
+    std::vector<mp2p_icp::plane_patch_t>& out_planes);
+
+}  // namespace mola
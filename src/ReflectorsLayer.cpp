@@ -0,0 +1,83 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   ReflectorsLayer.cpp
+ * @brief  Extraction of high-intensity lidar returns as a point layer
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+
+#include "ReflectorsLayer.h"
+
+#include <mrpt/maps/CPointsMapXYZI.h>
+#include <mrpt/obs/CObservationPointCloud.h>
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+using namespace mola;
+
+mrpt::maps::CSimplePointsMap::Ptr mola::extract_reflectors(
+    const mrpt::obs::CObservation& o, const ReflectorsParameters& p)
+{
+    const auto* obs =
+        dynamic_cast<const mrpt::obs::CObservationPointCloud*>(&o);
+    if (!obs || !obs->pointcloud) return {};
+
+    const auto* pts =
+        dynamic_cast<const mrpt::maps::CPointsMapXYZI*>(obs->pointcloud.get());
+    if (!pts) return {};
+
+    const auto& xs = pts->getPointsBufferRef_x();
+    const auto& ys = pts->getPointsBufferRef_y();
+    const auto& zs = pts->getPointsBufferRef_z();
+
+    // (intensity, index) of the candidates:
+    const double max_r2 = p.max_range * p.max_range;
+    std::vector<std::pair<float, size_t>> cands;
+    for (size_t i = 0; i < pts->size(); i++)
+    {
+        const float in = pts->getPointIntensity(i);
+        if (in < p.min_intensity) continue;
+        if (xs[i] * xs[i] + ys[i] * ys[i] + zs[i] * zs[i] > max_r2) continue;
+        cands.emplace_back(in, i);
+    }
+
+    // Brightest first, so they win their voxels:
+    std::sort(cands.begin(), cands.end(), [](const auto& a, const auto& b) {
+        return a.first > b.first;
+    });
+
+    auto out = mrpt::maps::CSimplePointsMap::Create();
+    out->reserve(std::min<size_t>(cands.size(), p.max_points));
+
+    std::unordered_set<uint64_t> voxels;
+    for (const auto& c : cands)
+    {
+        if (out->size() >= p.max_points) break;
+
+        // To the vehicle frame:
+        double gx, gy, gz;
+        obs->sensorPose.composePoint(
+            xs[c.second], ys[c.second], zs[c.second], gx, gy, gz);
+
+        // 21 bits per axis:
+        const auto k = [&p](double v) {
+            return static_cast<uint64_t>(
+                       static_cast<int64_t>(std::floor(v / p.voxel_size))) &
+                   0x1FFFFF;
+        };
+        if (!voxels.insert((k(gx) << 42) | (k(gy) << 21) | k(gz)).second)
+            continue;
+
+        out->insertPointFast(gx, gy, gz);
+    }
+    out->mark_as_modified();
+    return out;
+}
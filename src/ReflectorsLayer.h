@@ -0,0 +1,45 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   ReflectorsLayer.h
+ * @brief  Extraction of high-intensity lidar returns as a point layer
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+#pragma once
+
+#include <mrpt/maps/CSimplePointsMap.h>
+#include <mrpt/obs/CObservation.h>
+
+namespace mola
+{
+struct ReflectorsParameters
+{
+    /** Minimum intensity of a return, in the units of the sensor driver */
+    double min_intensity{0.6};
+
+    /** Farther returns are ignored [m] */
+    double max_range{60.0};
+
+    /** At most one point per voxel of this size [m] */
+    double voxel_size{0.2};
+
+    /** The brightest points are kept if there are more than this */
+    unsigned int max_points{1000};
+};
+
+/** Returns the strongest returns (retro-reflective lane markings, traffic
+ * signs, plates...) of a point cloud observation with intensities
+ * (CObservationPointCloud with a CPointsMapXYZI), in the vehicle frame.
+ * These are stable, salient and few, so they are cheap to match and add
+ * constraints in places with little geometric structure.
+ *
+ * Returns nullptr if the observation has no intensity channel.
+ */
+mrpt::maps::CSimplePointsMap::Ptr extract_reflectors(
+    const mrpt::obs::CObservation& o, const ReflectorsParameters& p);
+
+}  // namespace mola
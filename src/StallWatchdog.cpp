@@ -0,0 +1,160 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   StallWatchdog.cpp
+ * @brief  Progress heartbeats and stall detection for worker thread tasks
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+
+#include <mola-fe-lidar/StallWatchdog.h>
+#include <mrpt/core/format.h>
+
+#include <sstream>
+
+using namespace mola;
+
+namespace
+{
+// The task running in this thread, and the watchdog it belongs to:
+thread_local StallWatchdog*           current_wd = nullptr;
+thread_local StallWatchdog::task_id_t current_id = 0;
+
+double seconds_between(
+    const StallWatchdog::clock::time_point& a,
+    const StallWatchdog::clock::time_point& b)
+{
+    return std::chrono::duration<double>(b - a).count();
+}
+}  // namespace
+
+void StallWatchdog::setThreshold(const std::string& pool, double seconds)
+{
+    std::lock_guard<std::mutex> lck(mtx_);
+    thresholds_[pool] = seconds;
+}
+
+StallWatchdog::Scope::Scope(
+    StallWatchdog& wd, const std::string& pool, std::string name)
+    : wd_(wd), prev_id_(current_id), prev_wd_(current_wd)
+{
+    const auto now = clock::now();
+    {
+        std::lock_guard<std::mutex> lck(wd_.mtx_);
+        id_ = wd_.next_id_++;
+
+        auto& t     = wd_.tasks_[id_];
+        t.pool      = pool;
+        t.name      = std::move(name);
+        t.started   = now;
+        t.last_beat = now;
+        t.stage     = "start";
+        t.trace.resize(TRACE_LENGTH);
+    }
+    current_wd = &wd_;
+    current_id = id_;
+}
+
+StallWatchdog::Scope::~Scope()
+{
+    {
+        std::lock_guard<std::mutex> lck(wd_.mtx_);
+        wd_.tasks_.erase(id_);
+    }
+    current_wd = prev_wd_;
+    current_id = prev_id_;
+}
+
+void StallWatchdog::beat(const char* stage)
+{
+    if (current_wd != this) return;
+
+    const auto                  now = clock::now();
+    std::lock_guard<std::mutex> lck(mtx_);
+
+    auto it = tasks_.find(current_id);
+    if (it == tasks_.end()) return;
+
+    auto& t     = it->second;
+    t.last_beat = now;
+    t.stage     = stage;
+
+    auto& e      = t.trace[t.trace_next];
+    e.stamp      = now;
+    e.stage      = stage;
+    t.trace_next = (t.trace_next + 1) % TRACE_LENGTH;
+}
+
+std::vector<StallWatchdog::Stall> StallWatchdog::checkForStalls()
+{
+    const auto                  now = clock::now();
+    std::lock_guard<std::mutex> lck(mtx_);
+
+    std::vector<Stall> stalls;
+    for (auto& kv : tasks_)
+    {
+        auto& t = kv.second;
+        if (t.reported) continue;
+
+        const auto it_thres = thresholds_.find(t.pool);
+        if (it_thres == thresholds_.end()) continue;
+
+        const double silent = seconds_between(t.last_beat, now);
+        if (silent < it_thres->second) continue;
+
+        t.reported = true;
+        stalls.push_back({t, silent});
+    }
+    return stalls;
+}
+
+std::string StallWatchdog::dump(const Stall& s)
+{
+    const auto& t = s.task;
+
+    std::stringstream ss;
+    ss << mrpt::format(
+        "Stalled task `%s` in pool `%s`: no progress for %.02f s, running "
+        "for %.02f s, current stage: `%s`. Trace (oldest first):\n",
+        t.name.c_str(), t.pool.c_str(), s.silent_for,
+        s.silent_for + seconds_between(t.started, t.last_beat),
+        t.stage.c_str());
+
+    for (size_t i = 0; i < t.trace.size(); i++)
+    {
+        const auto& e = t.trace[(t.trace_next + i) % t.trace.size()];
+        if (e.stage.empty()) continue;
+        ss << mrpt::format(
+            "  +%8.03f s: %s\n", seconds_between(t.started, e.stamp),
+            e.stage.c_str());
+    }
+    return ss.str();
+}
+
+size_t StallWatchdog::runningTasks() const
+{
+    std::lock_guard<std::mutex> lck(mtx_);
+    return tasks_.size();
+}
+
+size_t StallWatchdog::stalledTasks(const std::string& pool) const
+{
+    const auto                  now = clock::now();
+    std::lock_guard<std::mutex> lck(mtx_);
+
+    const auto it_thres = thresholds_.find(pool);
+    if (it_thres == thresholds_.end()) return 0;
+
+    size_t n = 0;
+    for (const auto& kv : tasks_)
+    {
+        const auto& t = kv.second;
+        if (t.pool == pool &&
+            seconds_between(t.last_beat, now) >= it_thres->second)
+            n++;
+    }
+    return n;
+}
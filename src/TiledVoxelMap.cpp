@@ -0,0 +1,249 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   TiledVoxelMap.cpp
+ * @brief  Incrementally-built global voxel map, split in 2D tiles
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+
+#include <mola-fe-lidar/TiledVoxelMap.h>
+#include <mrpt/poses/Lie/SE.h>
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+using namespace mola;
+
+namespace
+{
+struct VoxelAccum
+{
+    double   x{0}, y{0}, z{0};
+    uint32_t n{0};
+};
+using voxels_t = std::unordered_map<uint64_t, VoxelAccum>;
+
+int32_t cell_index(double v, double cell_size)
+{
+    return static_cast<int32_t>(std::floor(v / cell_size));
+}
+
+void add_to_voxel(voxels_t& voxels, double voxel, double x, double y, double z)
+{
+    // 21 bits per axis: +-1048576 voxels
+    const auto k = [voxel](double v) {
+        return static_cast<uint64_t>(cell_index(v, voxel)) & 0x1FFFFF;
+    };
+    auto& a = voxels[(k(x) << 42) | (k(y) << 21) | k(z)];
+    a.x += x;
+    a.y += y;
+    a.z += z;
+    a.n++;
+}
+
+void voxels_to_points(const voxels_t& voxels, mrpt::maps::CSimplePointsMap& out)
+{
+    out.clear();
+    out.reserve(voxels.size());
+    for (const auto& kv : voxels)
+    {
+        const auto& a = kv.second;
+        out.insertPointFast(a.x / a.n, a.y / a.n, a.z / a.n);
+    }
+    out.mark_as_modified();
+}
+}  // namespace
+
+void TiledVoxelMap::insertKeyFrame(
+    id_t id, const mrpt::poses::CPose3D& pose,
+    const mrpt::maps::CPointsMap& local_cloud, const Parameters& p)
+{
+    voxels_t    voxels;
+    const auto& xs = local_cloud.getPointsBufferRef_x();
+    const auto& ys = local_cloud.getPointsBufferRef_y();
+    const auto& zs = local_cloud.getPointsBufferRef_z();
+    for (size_t i = 0; i < local_cloud.size(); i++)
+        add_to_voxel(voxels, p.voxel_size, xs[i], ys[i], zs[i]);
+
+    std::lock_guard<std::mutex> lck(mtx_);
+
+    auto& kf = kfs_[id];
+    kf.pose  = pose;
+    voxels_to_points(voxels, kf.local);
+    assignTiles(id, kf, p);
+}
+
+bool TiledVoxelMap::updateKeyFramePose(
+    id_t id, const mrpt::poses::CPose3D& pose, const Parameters& p)
+{
+    std::lock_guard<std::mutex> lck(mtx_);
+
+    auto it = kfs_.find(id);
+    if (it == kfs_.end()) return false;
+    auto& kf = it->second;
+
+    // Compare against the pose the tiles were built with, so small changes
+    // do not accumulate unnoticed:
+    const auto   delta = pose - kf.pose;
+    const double rot =
+        mrpt::poses::Lie::SE<3>::log(delta).blockCopy<3, 1>(3, 0).norm();
+    if (delta.norm() < p.pose_tolerance_xyz && rot < p.pose_tolerance_rot)
+        return false;
+
+    kf.pose = pose;
+    assignTiles(id, kf, p);
+    return true;
+}
+
+void TiledVoxelMap::assignTiles(id_t id, KeyFrame& kf, const Parameters& p)
+{
+    std::set<tile_key_t> new_tiles;
+
+    const auto& xs = kf.local.getPointsBufferRef_x();
+    const auto& ys = kf.local.getPointsBufferRef_y();
+    const auto& zs = kf.local.getPointsBufferRef_z();
+    for (size_t i = 0; i < kf.local.size(); i++)
+    {
+        double gx, gy, gz;
+        kf.pose.composePoint(xs[i], ys[i], zs[i], gx, gy, gz);
+        new_tiles.emplace(
+            cell_index(gx, p.tile_size), cell_index(gy, p.tile_size));
+    }
+
+    for (const auto& k : kf.tiles)
+    {
+        if (new_tiles.count(k)) continue;
+        auto& t = tiles_[k];
+        t.kfs.erase(id);
+        t.dirty = true;
+    }
+    for (const auto& k : new_tiles)
+    {
+        auto& t = tiles_[k];
+        t.kfs.insert(id);
+        t.dirty = true;
+    }
+    kf.tiles = std::move(new_tiles);
+}
+
+TiledVoxelMap::TileSnapshot::ConstPtr TiledVoxelMap::rebuildTile(
+    const tile_key_t& key, const Tile& t, const Parameters& p)
+{
+    auto s     = std::make_shared<TileSnapshot>();
+    s->key     = key;
+    s->version = next_version_++;
+    s->min_x   = key.first * p.tile_size;
+    s->min_y   = key.second * p.tile_size;
+    s->max_x   = s->min_x + p.tile_size;
+    s->max_y   = s->min_y + p.tile_size;
+    s->voxels  = mrpt::maps::CSimplePointsMap::Create();
+
+    voxels_t voxels;
+    for (const auto id : t.kfs)
+    {
+        const auto& kf = kfs_.at(id);
+        const auto& xs = kf.local.getPointsBufferRef_x();
+        const auto& ys = kf.local.getPointsBufferRef_y();
+        const auto& zs = kf.local.getPointsBufferRef_z();
+        for (size_t i = 0; i < kf.local.size(); i++)
+        {
+            double gx, gy, gz;
+            kf.pose.composePoint(xs[i], ys[i], zs[i], gx, gy, gz);
+            if (cell_index(gx, p.tile_size) != key.first ||
+                cell_index(gy, p.tile_size) != key.second)
+                continue;
+            add_to_voxel(voxels, p.voxel_size, gx, gy, gz);
+        }
+    }
+    voxels_to_points(voxels, *s->voxels);
+    return s;
+}
+
+std::vector<TiledVoxelMap::TileSnapshot::ConstPtr>
+    TiledVoxelMap::flushChangedTiles(const Parameters& p)
+{
+    std::lock_guard<std::mutex> lck(mtx_);
+
+    std::vector<TileSnapshot::ConstPtr> changed;
+    for (auto it = tiles_.begin(); it != tiles_.end();)
+    {
+        auto& t = it->second;
+        if (!t.dirty)
+        {
+            ++it;
+            continue;
+        }
+        // An empty snapshot tells subscribers to remove the tile:
+        changed.push_back(rebuildTile(it->first, t, p));
+        t.snapshot = changed.back();
+        t.dirty    = false;
+
+        if (t.kfs.empty())
+            it = tiles_.erase(it);
+        else
+            ++it;
+    }
+    return changed;
+}
+
+std::vector<TiledVoxelMap::TileSnapshot::ConstPtr> TiledVoxelMap::allTiles()
+    const
+{
+    std::lock_guard<std::mutex> lck(mtx_);
+
+    std::vector<TileSnapshot::ConstPtr> ret;
+    for (const auto& kv : tiles_)
+        if (kv.second.snapshot) ret.push_back(kv.second.snapshot);
+    return ret;
+}
+
+std::vector<id_t> TiledVoxelMap::keyFrames() const
+{
+    std::lock_guard<std::mutex> lck(mtx_);
+
+    std::vector<id_t> ret;
+    ret.reserve(kfs_.size());
+    for (const auto& kv : kfs_) ret.push_back(kv.first);
+    return ret;
+}
+
+std::vector<id_t> TiledVoxelMap::keyFramesFrom(
+    id_t first, size_t max_count) const
+{
+    std::lock_guard<std::mutex> lck(mtx_);
+
+    std::vector<id_t> ret;
+    ret.reserve(std::min(max_count, kfs_.size()));
+
+    auto it = kfs_.lower_bound(first);
+    while (ret.size() < std::min(max_count, kfs_.size()))
+    {
+        if (it == kfs_.end()) it = kfs_.begin();
+        ret.push_back(it->first);
+        ++it;
+    }
+    return ret;
+}
+
+size_t TiledVoxelMap::memoryBytes() const
+{
+    std::lock_guard<std::mutex> lck(mtx_);
+
+    size_t points = 0;
+    for (const auto& kv : kfs_) points += kv.second.local.size();
+    for (const auto& kv : tiles_)
+        if (kv.second.snapshot) points += kv.second.snapshot->voxels->size();
+    return points * 3 * sizeof(float);
+}
+
+void TiledVoxelMap::clear()
+{
+    std::lock_guard<std::mutex> lck(mtx_);
+    kfs_.clear();
+    tiles_.clear();
+}
@@ -0,0 +1,102 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   TwistKalmanFilter.cpp
+ * @brief  Kalman filter over the SE(3) twist, fed with ICP increments
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+
+#include <mola-fe-lidar/TwistKalmanFilter.h>
+#include <mrpt/core/bits_math.h>
+#include <mrpt/poses/Lie/SE.h>
+
+using namespace mola;
+
+void TwistKalmanFilter::predict(double dt, const Parameters& p)
+{
+    if (initialized_ && dt > p.max_dt)
+    {
+        reset();
+        return;
+    }
+    if (!initialized_ || !valid_dt(dt, p)) return;
+
+    // Random walk on the twist:
+    for (int i = 0; i < 6; i++)
+    {
+        const double sigma = i < 3 ? p.accel_sigma_xyz : p.accel_sigma_rot;
+        var_[i] += mrpt::square(sigma * dt);
+    }
+}
+
+mrpt::poses::CPose3D TwistKalmanFilter::predictRelativePose(
+    double dt, const Parameters& p) const
+{
+    if (!initialized_ || !valid_dt(dt, p)) return {};
+
+    mrpt::poses::Lie::SE<3>::tangent_vector v;
+    for (int i = 0; i < 6; i++) v[i] = x_[i] * dt;
+    return mrpt::poses::Lie::SE<3>::exp(v);
+}
+
+bool TwistKalmanFilter::correct(
+    const mrpt::poses::CPose3D& rel_pose, double dt, const Parameters& p)
+{
+    if (!valid_dt(dt, p)) return false;
+
+    const auto log_pose = mrpt::poses::Lie::SE<3>::log(rel_pose);
+
+    std::array<double, 6> z, r;
+    for (int i = 0; i < 6; i++)
+    {
+        const double sigma = i < 3 ? p.meas_sigma_xyz : p.meas_sigma_rot;
+
+        z[i] = log_pose[i] / dt;
+        r[i] = mrpt::square(sigma / dt);
+    }
+
+    if (!initialized_)
+    {
+        x_                   = z;
+        var_                 = r;
+        initialized_         = true;
+        consecutive_rejects_ = 0;
+        last_maha2_          = .0;
+        return true;
+    }
+
+    // Gating:
+    double maha2 = 0;
+    for (int i = 0; i < 6; i++)
+        maha2 += mrpt::square(z[i] - x_[i]) / (var_[i] + r[i]);
+    last_maha2_ = maha2;
+
+    if (maha2 > p.gate_chi2)
+    {
+        if (++consecutive_rejects_ <= p.max_consecutive_rejects) return false;
+
+        // Persistent disagreement: this is a real change of motion.
+        x_                   = z;
+        var_                 = r;
+        consecutive_rejects_ = 0;
+        return true;
+    }
+    consecutive_rejects_ = 0;
+
+    for (int i = 0; i < 6; i++)
+    {
+        const double K = var_[i] / (var_[i] + r[i]);
+        x_[i] += K * (z[i] - x_[i]);
+        var_[i] *= (1.0 - K);
+    }
+    return true;
+}
+
+mrpt::math::TTwist3D TwistKalmanFilter::twist() const
+{
+    return {x_[0], x_[1], x_[2], x_[3], x_[4], x_[5]};
+}
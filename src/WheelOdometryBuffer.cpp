@@ -0,0 +1,90 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   WheelOdometryBuffer.cpp
+ * @brief  Time-indexed buffer of wheel odometry readings, with interpolation
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+
+#include <mola-fe-lidar/WheelOdometryBuffer.h>
+#include <mrpt/poses/Lie/SE.h>
+#include <mrpt/system/datetime.h>
+
+using namespace mola;
+
+void WheelOdometryBuffer::add(
+    const mrpt::Clock::time_point& t, const mrpt::poses::CPose3D& pose,
+    const Parameters& p)
+{
+    std::lock_guard<std::mutex> lck(mtx_);
+    readings_[t] = pose;
+
+    // Forget old readings:
+    const auto newest = readings_.rbegin()->first;
+    while (readings_.size() > 2 &&
+           mrpt::system::timeDifference(readings_.begin()->first, newest) >
+               p.max_age)
+        readings_.erase(readings_.begin());
+}
+
+std::optional<mrpt::poses::CPose3D> WheelOdometryBuffer::poseAt(
+    const mrpt::Clock::time_point& t, const Parameters& p) const
+{
+    using mrpt::system::timeDifference;
+
+    std::lock_guard<std::mutex> lck(mtx_);
+    if (readings_.size() < 2) return {};
+
+    // Pick the two readings to interpolate (or extrapolate) from:
+    auto it1 = readings_.lower_bound(t);
+    if (it1 == readings_.begin())
+    {
+        if (it1->first != t) return {};  // before the oldest reading
+        return it1->second;
+    }
+    if (it1 == readings_.end())
+    {
+        // After the newest reading:
+        it1 = std::prev(readings_.end());
+        if (timeDifference(it1->first, t) > p.max_extrapolation) return {};
+    }
+    const auto it0 = std::prev(it1);
+
+    const double gap = timeDifference(it0->first, it1->first);
+    if (gap <= 0 || gap > p.max_gap) return {};
+
+    const double frac = timeDifference(it0->first, t) / gap;
+
+    // SE(3) interpolation: p0 (+) frac * log(p1 (-) p0)
+    const auto delta = mrpt::poses::Lie::SE<3>::log(it1->second - it0->second);
+    mrpt::poses::Lie::SE<3>::tangent_vector v;
+    for (int i = 0; i < 6; i++) v[i] = frac * delta[i];
+
+    return it0->second + mrpt::poses::Lie::SE<3>::exp(v);
+}
+
+std::optional<mrpt::poses::CPose3D> WheelOdometryBuffer::relativeMotion(
+    const mrpt::Clock::time_point& t0, const mrpt::Clock::time_point& t1,
+    const Parameters& p) const
+{
+    const auto p0 = poseAt(t0, p);
+    const auto p1 = poseAt(t1, p);
+    if (!p0 || !p1) return {};
+    return *p1 - *p0;
+}
+
+void WheelOdometryBuffer::clear()
+{
+    std::lock_guard<std::mutex> lck(mtx_);
+    readings_.clear();
+}
+
+size_t WheelOdometryBuffer::size() const
+{
+    std::lock_guard<std::mutex> lck(mtx_);
+    return readings_.size();
+}
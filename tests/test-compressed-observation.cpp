@@ -0,0 +1,152 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   test-compressed-observation.cpp
+ * @brief  Unit tests for CompressedObservation
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+
+#include <mola-fe-lidar/CompressedObservation.h>
+#include <mrpt/core/exceptions.h>
+#include <mrpt/io/CMemoryStream.h>
+#include <mrpt/maps/CPointsMapXYZI.h>
+#include <mrpt/maps/CSimplePointsMap.h>
+#include <mrpt/obs/CObservationPointCloud.h>
+#include <mrpt/random.h>
+#include <mrpt/serialization/CArchive.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+using namespace mola;
+
+namespace
+{
+mrpt::obs::CObservationPointCloud::Ptr make_scan(bool with_intensity)
+{
+    auto& rng = mrpt::random::getRandomGenerator();
+    rng.randomize(1234);
+
+    mrpt::maps::CPointsMap::Ptr pc;
+    if (with_intensity)
+        pc = mrpt::maps::CPointsMapXYZI::Create();
+    else
+        pc = mrpt::maps::CSimplePointsMap::Create();
+
+    for (size_t i = 0; i < 5000; i++)
+    {
+        pc->insertPoint(
+            rng.drawUniform(-50.0, 50.0), rng.drawUniform(-50.0, 50.0),
+            rng.drawUniform(-2.0, 10.0));
+        if (with_intensity)
+            dynamic_cast<mrpt::maps::CPointsMapXYZI&>(*pc).setPointIntensity(
+                i, rng.drawUniform(0.0, 1.0));
+    }
+
+    auto obs         = mrpt::obs::CObservationPointCloud::Create();
+    obs->pointcloud  = pc;
+    obs->sensorLabel = "lidar";
+    obs->timestamp   = mrpt::Clock::now();
+    return obs;
+}
+
+// Through its serialization, as when spilled to disk and loaded back:
+mrpt::obs::CObservationPointCloud::Ptr round_trip(
+    const mrpt::obs::CObservation& o, double quantization)
+{
+    const auto c = CompressedObservation::Compress(o, quantization);
+
+    mrpt::io::CMemoryStream buf;
+    auto                    arch = mrpt::serialization::archiveFrom(buf);
+    arch << *c;
+    buf.Seek(0);
+    const auto c2 = arch.ReadObject<CompressedObservation>();
+    ASSERT_(c2);
+
+    auto ret = std::dynamic_pointer_cast<mrpt::obs::CObservationPointCloud>(
+        c2->decompress());
+    ASSERT_(ret);
+    ASSERT_(ret->pointcloud);
+    ASSERT_EQUAL_(ret->sensorLabel, o.sensorLabel);
+    ASSERT_(ret->timestamp == o.timestamp);
+    return ret;
+}
+
+// Max. coordinate error, and checks size and intensities (never quantized)
+float compare_clouds(
+    const mrpt::maps::CPointsMap& a, const mrpt::maps::CPointsMap& b)
+{
+    ASSERT_EQUAL_(a.size(), b.size());
+
+    const auto* ai = dynamic_cast<const mrpt::maps::CPointsMapXYZI*>(&a);
+    const auto* bi = dynamic_cast<const mrpt::maps::CPointsMapXYZI*>(&b);
+    ASSERT_EQUAL_(ai != nullptr, bi != nullptr);
+
+    float max_err = 0;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        float ax, ay, az, bx, by, bz;
+        a.getPoint(i, ax, ay, az);
+        b.getPoint(i, bx, by, bz);
+        for (const float err :
+             {std::abs(ax - bx), std::abs(ay - by), std::abs(az - bz)})
+            max_err = std::max(max_err, err);
+
+        if (ai)
+            ASSERT_EQUAL_(ai->getPointIntensity(i), bi->getPointIntensity(i));
+    }
+    return max_err;
+}
+
+void test_lossless()
+{
+    for (const bool with_intensity : {false, true})
+    {
+        const auto o = make_scan(with_intensity);
+        const auto r = round_trip(*o, .0);
+
+        ASSERT_EQUAL_(compare_clouds(*o->pointcloud, *r->pointcloud), 0.0f);
+    }
+}
+
+void test_quantized_error_bound()
+{
+    for (const double q : {0.002, 0.01, 0.05})
+    {
+        for (const bool with_intensity : {false, true})
+        {
+            const auto o = make_scan(with_intensity);
+            const auto r = round_trip(*o, q);
+
+            // Half the step, plus float rounding of coordinates up to 50 m:
+            const float max_err =
+                compare_clouds(*o->pointcloud, *r->pointcloud);
+            ASSERT_LE_(max_err, 0.5 * q + 1e-5);
+        }
+    }
+}
+
+}  // namespace
+
+int main()
+{
+    try
+    {
+        test_lossless();
+        test_quantized_error_bound();
+
+        std::cout << "All tests passed.\n";
+        return EXIT_SUCCESS;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << mrpt::exception_to_str(e) << "\n";
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,165 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   test-loop-closure-verifier.cpp
+ * @brief  Unit tests for LoopClosureVerifier and maximum_clique()
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+
+#include <mola-fe-lidar/LoopClosureVerifier.h>
+#include <mrpt/core/exceptions.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <vector>
+
+using namespace mola;
+
+namespace
+{
+using adjacency_t = std::vector<std::vector<bool>>;
+
+adjacency_t make_graph(
+    size_t n, const std::vector<std::pair<size_t, size_t>>& edges)
+{
+    adjacency_t adj(n, std::vector<bool>(n, false));
+    for (const auto& e : edges)
+        adj[e.first][e.second] = adj[e.second][e.first] = true;
+    return adj;
+}
+
+void test_maximum_clique()
+{
+    // Empty graph:
+    ASSERT_(maximum_clique({}).empty());
+
+    // No edges: any single vertex is a maximum clique.
+    ASSERT_EQUAL_(maximum_clique(make_graph(4, {})).size(), 1U);
+
+    // A 4-clique {1,2,4,5}, a triangle {0,1,3} and some loose edges. The
+    // greedy choice (highest degree first) is not enough here:
+    const auto adj = make_graph(
+        7, {{1, 2},
+            {1, 4},
+            {1, 5},
+            {2, 4},
+            {2, 5},
+            {4, 5},
+            {0, 1},
+            {0, 3},
+            {1, 3},
+            {3, 6},
+            {0, 6}});
+
+    const auto clique = maximum_clique(adj);
+    ASSERT_(clique == std::vector<size_t>({1, 2, 4, 5}));
+}
+
+// KFs along a straight line, 10 m apart, as estimated by odometry:
+std::map<id_t, mrpt::poses::CPose3D> make_kf_poses()
+{
+    std::map<id_t, mrpt::poses::CPose3D> poses;
+    for (id_t i = 0; i < 6; i++)
+        poses[i] = mrpt::poses::CPose3D(10.0 * i, 0, 0, 0, 0, 0);
+    return poses;
+}
+
+LoopClosureVerifier::Candidate make_candidate(
+    id_t from, id_t to, const std::map<id_t, mrpt::poses::CPose3D>& poses,
+    const mrpt::poses::CPose3D& error = {})
+{
+    LoopClosureVerifier::Candidate c;
+    c.from_id  = from;
+    c.to_id    = to;
+    c.rel_pose = (poses.at(to) - poses.at(from)) + error;
+    return c;
+}
+
+void test_verify_rejects_inconsistent()
+{
+    using mrpt::poses::CPose3D;
+
+    const auto poses = make_kf_poses();
+
+    LoopClosureVerifier lcv;
+    lcv.params.max_error_xyz   = 1.0;
+    lcv.params.max_error_rot   = mrpt::DEG2RAD(5.0);
+    lcv.params.min_clique_size = 2;
+
+    // Consistent with odometry (up to a small error), one of them twice:
+    lcv.add(make_candidate(0, 3, poses));
+    lcv.add(make_candidate(0, 3, poses));
+    lcv.add(make_candidate(1, 4, poses));
+    lcv.add(make_candidate(2, 5, poses, CPose3D(0.3, 0, 0, 0, 0, 0)));
+
+    // Outliers: wrong translation, wrong rotation.
+    lcv.add(make_candidate(0, 4, poses, CPose3D(3.0, 0, 0, 0, 0, 0)));
+    lcv.add(make_candidate(
+        1, 5, poses, CPose3D(0, 0, 0, mrpt::DEG2RAD(20.0), 0, 0)));
+
+    // Involves a KF without a pose estimate:
+    auto unknown_kf  = make_candidate(0, 3, poses);
+    unknown_kf.to_id = 99;
+    lcv.add(unknown_kf);
+
+    ASSERT_EQUAL_(lcv.size(), 7U);
+    const auto accepted = lcv.verify(poses);
+    ASSERT_(lcv.empty());
+
+    std::vector<std::pair<id_t, id_t>> ids;
+    for (const auto& c : accepted) ids.emplace_back(c.from_id, c.to_id);
+    std::sort(ids.begin(), ids.end());
+
+    const std::vector<std::pair<id_t, id_t>> expected = {
+        {0, 3}, {0, 3}, {1, 4}, {2, 5}};
+    ASSERT_(ids == expected);
+}
+
+void test_verify_min_clique_size()
+{
+    const auto poses = make_kf_poses();
+
+    LoopClosureVerifier lcv;
+    lcv.params.min_clique_size = 2;
+
+    // Two closures, mutually inconsistent: no set of 2 can be accepted.
+    lcv.add(make_candidate(0, 3, poses));
+    lcv.add(make_candidate(
+        1, 4, poses, mrpt::poses::CPose3D(5.0, 0, 0, 0, 0, 0)));
+    ASSERT_(lcv.verify(poses).empty());
+    ASSERT_(lcv.empty());
+
+    // A single closure never reaches the minimum size:
+    lcv.add(make_candidate(0, 3, poses));
+    ASSERT_(lcv.verify(poses).empty());
+
+    lcv.params.min_clique_size = 1;
+    lcv.add(make_candidate(0, 3, poses));
+    ASSERT_EQUAL_(lcv.verify(poses).size(), 1U);
+}
+
+}  // namespace
+
+int main()
+{
+    try
+    {
+        test_maximum_clique();
+        test_verify_rejects_inconsistent();
+        test_verify_min_clique_size();
+
+        std::cout << "All tests passed.\n";
+        return EXIT_SUCCESS;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << mrpt::exception_to_str(e) << "\n";
+        return EXIT_FAILURE;
+    }
+}
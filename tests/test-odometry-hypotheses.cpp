@@ -0,0 +1,99 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   test-odometry-hypotheses.cpp
+ * @brief  Unit tests for OdometryHypotheses
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+
+#include <mola-fe-lidar/OdometryHypotheses.h>
+#include <mrpt/core/exceptions.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace mola;
+
+namespace
+{
+using Candidate = OdometryHypotheses::Candidate;
+
+Candidate make_candidate(size_t parent, const mrpt::poses::CPose3D& inc)
+{
+    Candidate c;
+    c.parent    = parent;
+    c.increment = inc;
+    c.prior     = inc;
+    c.goodness  = 0.9;
+    return c;
+}
+
+// Two hypotheses 2 m apart along a perfectly uniform tunnel: all their
+// extensions match equally well, so they are never pruned nor merged.
+// Returns the number of alive hypotheses after each step.
+std::vector<size_t> run_uniform_tunnel(
+    const OdometryHypotheses::Parameters& p, size_t num_steps)
+{
+    const mrpt::poses::CPose3D step(1.0, 0, 0, 0, 0, 0);
+    const mrpt::poses::CPose3D step_alt(3.0, 0, 0, 0, 0, 0);
+
+    OdometryHypotheses mh;
+    mh.reset(mrpt::poses::CPose3D());
+
+    // Ambiguous alignment: spawn a second hypothesis.
+    mh.update({make_candidate(0, step), make_candidate(0, step_alt)}, p);
+
+    std::vector<size_t> alive = {mh.size()};
+    for (size_t i = 1; i < num_steps; i++)
+    {
+        std::vector<Candidate> cands;
+        for (size_t h = 0; h < mh.size(); h++)
+            cands.push_back(make_candidate(h, step));
+        mh.update(cands, p);
+        alive.push_back(mh.size());
+    }
+    return alive;
+}
+
+void test_collapse_after_max_ambiguous_steps()
+{
+    OdometryHypotheses::Parameters p;
+    p.max_ambiguous_steps = 5;
+
+    const auto alive = run_uniform_tunnel(p, 8);
+
+    for (size_t i = 0; i < 4; i++) ASSERT_EQUAL_(alive.at(i), 2U);
+    for (size_t i = 4; i < alive.size(); i++) ASSERT_EQUAL_(alive.at(i), 1U);
+}
+
+void test_no_collapse_if_disabled()
+{
+    OdometryHypotheses::Parameters p;
+    p.max_ambiguous_steps = 0;
+
+    for (const auto n : run_uniform_tunnel(p, 50)) ASSERT_EQUAL_(n, 2U);
+}
+
+}  // namespace
+
+int main()
+{
+    try
+    {
+        test_collapse_after_max_ambiguous_steps();
+        test_no_collapse_if_disabled();
+
+        std::cout << "All tests passed.\n";
+        return EXIT_SUCCESS;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << mrpt::exception_to_str(e) << "\n";
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,118 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   test-twist-kalman-filter.cpp
+ * @brief  Unit tests for TwistKalmanFilter
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+
+#include <mola-fe-lidar/TwistKalmanFilter.h>
+#include <mrpt/core/exceptions.h>
+
+#include <cstdlib>
+#include <iostream>
+
+using namespace mola;
+
+namespace
+{
+// Pure forward motion of `dx` meters:
+mrpt::poses::CPose3D forward(double dx)
+{
+    return mrpt::poses::CPose3D(dx, 0, 0, 0, 0, 0);
+}
+
+void test_invalid_dt()
+{
+    const TwistKalmanFilter::Parameters p;
+    TwistKalmanFilter                   kf;
+
+    // Not initialized from invalid time steps:
+    ASSERT_(!kf.correct(forward(1.0), 0.0, p));
+    ASSERT_(!kf.correct(forward(1.0), -0.1, p));
+    ASSERT_(!kf.correct(forward(1.0), p.max_dt + 0.1, p));
+    ASSERT_(!kf.initialized());
+
+    ASSERT_(kf.correct(forward(1.0), 0.1, p));
+    ASSERT_(kf.initialized());
+    ASSERT_NEAR_(kf.twist().vx, 10.0, 1e-6);
+
+    // Ignored, without touching the estimate:
+    kf.predict(0.0, p);
+    kf.predict(-0.1, p);
+    ASSERT_(!kf.correct(forward(5.0), 0.0, p));
+    ASSERT_(!kf.correct(forward(5.0), -0.1, p));
+    ASSERT_(kf.initialized());
+    ASSERT_NEAR_(kf.twist().vx, 10.0, 1e-6);
+
+    ASSERT_NEAR_(kf.predictRelativePose(0.0, p).norm(), .0, 1e-9);
+    ASSERT_NEAR_(kf.predictRelativePose(-0.1, p).norm(), .0, 1e-9);
+    ASSERT_NEAR_(kf.predictRelativePose(0.2, p).x(), 2.0, 1e-6);
+
+    // A gap longer than max_dt resets the filter:
+    kf.predict(p.max_dt + 0.1, p);
+    ASSERT_(!kf.initialized());
+    ASSERT_NEAR_(kf.predictRelativePose(0.1, p).norm(), .0, 1e-9);
+}
+
+void test_gating()
+{
+    TwistKalmanFilter::Parameters p;
+    p.max_consecutive_rejects = 3;
+
+    const double      dt = 0.1;
+    TwistKalmanFilter kf;
+
+    // Constant speed: 10 m/s.
+    for (int i = 0; i < 5; i++)
+    {
+        kf.predict(dt, p);
+        ASSERT_(kf.correct(forward(1.0), dt, p));
+    }
+    ASSERT_NEAR_(kf.twist().vx, 10.0, 1e-6);
+
+    // A single outlier (30 m/s) is rejected, and does not modify the
+    // estimate:
+    kf.predict(dt, p);
+    ASSERT_(!kf.correct(forward(3.0), dt, p));
+    ASSERT_GT_(kf.lastMahalanobis2(), p.gate_chi2);
+    ASSERT_NEAR_(kf.twist().vx, 10.0, 1e-6);
+
+    // Back to normal: accepted, and the rejection count starts over.
+    kf.predict(dt, p);
+    ASSERT_(kf.correct(forward(1.0), dt, p));
+
+    // A persistent change of speed: rejected `max_consecutive_rejects`
+    // times, then adopted as is.
+    for (unsigned int i = 0; i < p.max_consecutive_rejects; i++)
+    {
+        kf.predict(dt, p);
+        ASSERT_(!kf.correct(forward(3.0), dt, p));
+    }
+    kf.predict(dt, p);
+    ASSERT_(kf.correct(forward(3.0), dt, p));
+    ASSERT_NEAR_(kf.twist().vx, 30.0, 1e-6);
+}
+
+}  // namespace
+
+int main()
+{
+    try
+    {
+        test_invalid_dt();
+        test_gating();
+
+        std::cout << "All tests passed.\n";
+        return EXIT_SUCCESS;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << mrpt::exception_to_str(e) << "\n";
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,127 @@
+/* -------------------------------------------------------------------------
+ *   A Modular Optimization framework for Localization and mApping  (MOLA)
+ * Copyright (C) 2018-2019 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+/**
+ * @file   test-wheel-odometry-buffer.cpp
+ * @brief  Unit tests for WheelOdometryBuffer
+ * @author Jose Luis Blanco Claraco
+ * @date   Oct 18, 2026
+ */
+
+#include <mola-fe-lidar/WheelOdometryBuffer.h>
+#include <mrpt/core/bits_math.h>
+#include <mrpt/core/exceptions.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+using namespace mola;
+
+namespace
+{
+const mrpt::Clock::time_point t0 = mrpt::Clock::fromDouble(1000.0);
+
+mrpt::Clock::time_point at(double dt)
+{
+    return t0 + std::chrono::microseconds(static_cast<int64_t>(dt * 1e6));
+}
+
+void test_interpolation()
+{
+    using mrpt::poses::CPose3D;
+
+    WheelOdometryBuffer::Parameters p;
+    p.max_extrapolation = 0.05;
+    p.max_gap           = 0.5;
+
+    WheelOdometryBuffer buf;
+    ASSERT_(!buf.poseAt(at(0.0), p));  // Empty
+
+    buf.add(at(0.0), CPose3D(0, 0, 0, 0, 0, 0), p);
+    ASSERT_(!buf.poseAt(at(0.0), p));  // A single reading
+
+    buf.add(at(0.1), CPose3D(1.0, 0, 0, 0, 0, 0), p);
+    buf.add(at(0.2), CPose3D(1.0, 0, 0, mrpt::DEG2RAD(90.0), 0, 0), p);
+    ASSERT_EQUAL_(buf.size(), 3U);
+
+    // Exact timestamps:
+    ASSERT_NEAR_(buf.poseAt(at(0.0), p)->x(), 0.0, 1e-6);
+    ASSERT_NEAR_(buf.poseAt(at(0.1), p)->x(), 1.0, 1e-6);
+
+    // Pure translation:
+    {
+        const auto q = buf.poseAt(at(0.025), p);
+        ASSERT_(q.has_value());
+        ASSERT_NEAR_(q->x(), 0.25, 1e-6);
+        ASSERT_NEAR_(q->y(), 0.0, 1e-6);
+        ASSERT_NEAR_(q->yaw(), 0.0, 1e-6);
+    }
+    // Pure rotation, in the right interval:
+    {
+        const auto q = buf.poseAt(at(0.15), p);
+        ASSERT_(q.has_value());
+        ASSERT_NEAR_(q->x(), 1.0, 1e-6);
+        ASSERT_NEAR_(q->yaw(), mrpt::DEG2RAD(45.0), 1e-6);
+    }
+
+    // Relative motion across both intervals:
+    {
+        const auto d = buf.relativeMotion(at(0.05), at(0.15), p);
+        ASSERT_(d.has_value());
+        ASSERT_NEAR_(d->x(), 0.5, 1e-6);
+        ASSERT_NEAR_(d->yaw(), mrpt::DEG2RAD(45.0), 1e-6);
+    }
+
+    // Before the oldest reading:
+    ASSERT_(!buf.poseAt(at(-0.01), p));
+    ASSERT_(!buf.relativeMotion(at(-0.01), at(0.1), p));
+
+    // Short extrapolation after the newest one, along the last interval:
+    {
+        const auto q = buf.poseAt(at(0.22), p);
+        ASSERT_(q.has_value());
+        ASSERT_NEAR_(q->yaw(), mrpt::DEG2RAD(108.0), 1e-6);
+    }
+    ASSERT_(!buf.poseAt(at(0.2 + 2 * p.max_extrapolation), p));
+}
+
+void test_max_gap()
+{
+    using mrpt::poses::CPose3D;
+
+    WheelOdometryBuffer::Parameters p;
+    p.max_gap = 0.5;
+
+    WheelOdometryBuffer buf;
+    buf.add(at(0.0), CPose3D(0, 0, 0, 0, 0, 0), p);
+    buf.add(at(1.0), CPose3D(1.0, 0, 0, 0, 0, 0), p);
+
+    // Readings too far apart to be interpolated:
+    ASSERT_(!buf.poseAt(at(0.5), p));
+
+    buf.add(at(1.2), CPose3D(1.2, 0, 0, 0, 0, 0), p);
+    ASSERT_NEAR_(buf.poseAt(at(1.1), p)->x(), 1.1, 1e-6);
+}
+
+}  // namespace
+
+int main()
+{
+    try
+    {
+        test_interpolation();
+        test_max_gap();
+
+        std::cout << "All tests passed.\n";
+        return EXIT_SUCCESS;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << mrpt::exception_to_str(e) << "\n";
+        return EXIT_FAILURE;
+    }
+}